@@ -1,16 +1,114 @@
 #include "AI.hpp"
+#include "Metrics.hpp"
+#include "Trace.hpp"
 #include "Zobrist.hpp"
 #include <algorithm>
 #include <limits>
 
 static inline Cell other(Cell c) { return c == Cell::X ? Cell::O : Cell::X; }
 
-Move AI::greedy(Board &b)
+namespace
+{
+    constexpr int WIN_BOUND = 800000;      // scores beyond are forced wins (900000 - 10 * plies)
+    constexpr int ORDER_GIVES_WIN = 500000; // ordering: the opponent can win right after this move
+    constexpr std::uint64_t NULL_MOVE_KEY = 0x9E3779B97F4A7C15ull;
+
+    // Empty cells that would complete a `need`-line through (x, y) if `who` stood there;
+    // distinct, at most `cap`.
+    int completions(const Board &b, int x, int y, Cell who, int need, Move *out, int cap)
+    {
+        static const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+        int n = 0;
+        for (auto &d : dirs)
+            for (int s = 1 - need; s <= 0; ++s)
+            {
+                int own = 0, empty = 0;
+                Move e{};
+                for (int k = 0; k < need; ++k)
+                {
+                    int cx = x + (s + k) * d[0], cy = y + (s + k) * d[1];
+                    Cell c = cx == x && cy == y ? who : b.at(cx, cy);
+                    if (c == who)
+                        ++own;
+                    else if (c == Cell::Empty && ++empty == 1)
+                        e = Move(cx, cy);
+                    else
+                        break;
+                }
+                if (own != need - 1 || empty != 1)
+                    continue;
+                bool dup = false;
+                for (int i = 0; i < n; ++i)
+                    dup = dup || out[i] == e;
+                if (!dup && n < cap)
+                    out[n++] = e;
+            }
+        return n;
+    }
+}
+
+void SearchArena::prepare(const Board &b, int depth, int radius)
+{
+    // search adds at most depth + 1 stones (the last one during move ordering),
+    // each within `radius` of the previous bbox
+    std::size_t cap = b.max_candidates(depth + 1, radius);
+    int grow = radius * (depth + 2);
+    if (b.empty())
+        marks.cover(-grow, -grow, grow, grow);
+    else
+        marks.cover(b.min_x() - grow, b.min_y() - grow, b.max_x() + grow, b.max_y() + grow);
+    for (int p = 0; p <= depth + 1 && p <= MAX_PLY + 1; ++p)
+    {
+        if (moves[p].size() < cap)
+            moves[p].resize(cap);
+        if (p <= MAX_PLY && scored[p].size() < cap)
+            scored[p].resize(cap);
+    }
+}
+
+void AI::set_tt_entries(size_t n)
+{
+    size_t p = 1;
+    while (p * 2 <= n)
+        p *= 2;
+    ttMaxSize = p;
+    ttView.reset();
+    tt.clear();
+    tt.shrink_to_fit();
+}
+
+void AI::clear_tt()
+{
+    if (ttView)
+        ttView.reset(); // the next search allocates an owned table
+    else
+        tt.assign(tt.size(), TTEntry{});
+}
+
+void AI::adopt_tt(std::shared_ptr<TTEntry> table, size_t n)
 {
+    tt.clear();
+    tt.shrink_to_fit();
+    ttView = std::move(table);
+    ttMaxSize = n;
+}
+
+TTEntry &AI::tt_slot(std::uint64_t h)
+{
+    if (ttView)
+        return ttView.get()[h & (ttMaxSize - 1)];
+    if (tt.size() != ttMaxSize)
+        tt.assign(ttMaxSize, TTEntry{});
+    return tt[h & (ttMaxSize - 1)];
+}
 
-    auto cand = b.candidates(2);
-    for (auto m : cand)
+Move AI::greedy(Board &b)
+{
+    Move *cand = arena.moves[0].data();
+    std::size_t n = b.candidates(cand, arena.moves[0].size(), arena.marks, 2);
+    for (std::size_t i = 0; i < n; ++i)
     {
+        Move m = cand[i];
         if (!b.is_empty(m.x, m.y))
             continue;
         b.place(m.x, m.y, Cell::O);
@@ -19,8 +117,9 @@ Move AI::greedy(Board &b)
         if (win)
             return m;
     }
-    for (auto m : cand)
+    for (std::size_t i = 0; i < n; ++i)
     {
+        Move m = cand[i];
         if (!b.is_empty(m.x, m.y))
             continue;
         b.place(m.x, m.y, Cell::X);
@@ -30,11 +129,12 @@ Move AI::greedy(Board &b)
             return m;
     }
     int bestScore = std::numeric_limits<int>::min();
-    Move best = cand.empty() ? Move{0, 0} : cand.front();
-    for (auto m : cand)
+    Move best = n == 0 ? Move{0, 0} : cand[0];
+    for (std::size_t i = 0; i < n; ++i)
     {
+        Move m = cand[i];
         b.place(m.x, m.y, Cell::O);
-        int sc = b.evaluate(4);
+        int sc = eval(b, 4);
         b.undo(m.x, m.y);
         if (sc > bestScore)
         {
@@ -45,22 +145,21 @@ Move AI::greedy(Board &b)
     return best;
 }
 
-int AI::negamax(Board &b, int depth, int alpha, int beta, Cell toMove, int need, Timer *deadline, bool *outOfTime, Move *pv)
+int AI::negamax(Board &b, int depth, int ply, int alpha, int beta, Cell toMove, int need, Timer *deadline, bool *outOfTime, Move *pv, bool allowNull)
 {
-    if (deadline && deadline->elapsed_ms() >= 0 && deadline->elapsed_ms() > 0 && outOfTime)
+    ++nodeCount;
+    if (outOfTime && ((stopFlag && stopFlag->load(std::memory_order_relaxed)) ||
+                      (deadline && deadline->elapsed_ms() > timeBudgetMs)))
     {
-        if (deadline->elapsed_ms() > 0 && deadline->elapsed_ms() > timeBudgetMs)
-        {
-            *outOfTime = true;
-            return 0;
-        }
+        *outOfTime = true;
+        return 0;
     }
-    auto h = b.hash();
-    auto it = tt.find(h);
-    if (it != tt.end())
+    const int alphaOrig = alpha;
+    auto h = b.hash() ^ sideKey;
+    TTEntry &slot = tt_slot(h);
     {
-        const TTEntry &e = it->second;
-        if (e.depth >= depth)
+        const TTEntry &e = slot;
+        if (e.key == h && e.depth >= depth)
         {
             if (e.flag == TTEntry::EXACT)
             {
@@ -81,63 +180,98 @@ int AI::negamax(Board &b, int depth, int alpha, int beta, Cell toMove, int need,
         }
     }
 
-    auto cand = b.candidates(2);
-    for (auto m : cand)
+    // candidates are never empty on an infinite board, so leaves skip generating them
+    if (depth == 0 && qs.enabled && ply <= SearchArena::MAX_PLY)
+    {
+        int budget = qs.maxNodes;
+        return qsearch(b, ply, 0, alpha, beta, toMove, need, budget);
+    }
+    if (depth == 0 || ply > SearchArena::MAX_PLY)
     {
-        // if previous move created win, detect early in recursion depth check after applying a move below
-        (void)m;
+        int e = eval(b, need);
+        return (toMove == Cell::O) ? e : -e; // negamax POV: score for player to move
     }
+    Move *cand = arena.moves[ply].data();
+    std::size_t n = gen_moves(b, ply, need);
 
-    if (depth == 0 || cand.empty())
+    bool threatened = false; // the opponent completes a line next move unless we block
+    if ((prune.lmr || (ply > 0 && prune.nullMove)) && depth >= std::min(prune.nullMinDepth, prune.lmrMinDepth))
+        for (std::size_t i = 0; i < n && !threatened; ++i)
+        {
+            b.place(cand[i].x, cand[i].y, other(toMove));
+            threatened = b.is_win_from(cand[i].x, cand[i].y, other(toMove), need);
+            b.undo(cand[i].x, cand[i].y);
+        }
+    if (ply > 0 && allowNull && prune.nullMove && depth >= prune.nullMinDepth && !threatened && beta < WIN_BOUND)
     {
-        int eval = b.evaluate(need);
-        return (toMove == Cell::O) ? eval : -eval; // negamax POV: score for player to move
+        sideKey ^= NULL_MOVE_KEY;
+        int score = -negamax(b, std::max(0, depth - 1 - prune.nullR), ply + 1, -beta, -beta + 1, other(toMove), need,
+                             deadline, outOfTime, nullptr, false);
+        sideKey ^= NULL_MOVE_KEY;
+        if (outOfTime && *outOfTime)
+            return 0;
+        if (score >= beta)
+            return score >= WIN_BOUND ? beta : score; // a win found without our move proves nothing
     }
 
     // move ordering: try winning moves first, then blocks, then heuristic sort
-    std::vector<std::pair<int, Move>> scored;
-    scored.reserve(cand.size());
-    for (auto m : cand)
+    ScoredMove *scored = arena.scored[ply].data();
+    for (std::size_t i = 0; i < n; ++i)
     {
+        Move m = cand[i];
         int s = 0;
+        bool givesWin = false;
         b.place(m.x, m.y, toMove);
         if (b.is_win_from(m.x, m.y, toMove, need))
             s = 10000000;
         else
         {
-            auto cc = b.candidates(2);
-            for (auto m2 : cc)
+            Move *cc = arena.moves[ply + 1].data();
+            std::size_t nc = gen_moves(b, ply + 1, need);
+            for (std::size_t j = 0; j < nc; ++j)
             {
+                Move m2 = cc[j];
                 b.place(m2.x, m2.y, other(toMove));
                 if (b.is_win_from(m2.x, m2.y, other(toMove), need))
                 {
-                    s = 500000;
+                    s = ORDER_GIVES_WIN;
+                    givesWin = true;
                     b.undo(m2.x, m2.y);
                     break;
                 }
                 b.undo(m2.x, m2.y);
             }
-            s += b.evaluate(need);
+            s += eval(b, need);
         }
         b.undo(m.x, m.y);
-        scored.emplace_back(s, m);
+        scored[i] = {s, m, givesWin};
     }
-    std::sort(scored.begin(), scored.end(), [](auto &a, auto &b)
-              { return a.first > b.first; });
+    std::sort(scored, scored + n, [](auto &a, auto &b)
+              { return a.score > b.score; });
 
     Move bestMove{};
     int bestScore = std::numeric_limits<int>::min();
 
-    for (auto &sm : scored)
+    for (std::size_t i = 0; i < n; ++i)
     {
-        Move m = sm.second;
+        Move m = scored[i].move;
         b.place(m.x, m.y, toMove);
         if (b.is_win_from(m.x, m.y, toMove, need))
         {
             b.undo(m.x, m.y);
             return 900000 - (10 * (maxDepth - depth));
         }
-        int score = -negamax(b, depth - 1, -beta, -alpha, other(toMove), need, deadline, outOfTime, pv);
+        int score;
+        if (prune.lmr && i >= static_cast<std::size_t>(prune.lmrFullMoves) && depth >= prune.lmrMinDepth && !threatened &&
+            !scored[i].givesWin)
+        {
+            ++reductionCount;
+            score = -negamax(b, depth - 1 - prune.lmrReduction, ply + 1, -alpha - 1, -alpha, other(toMove), need, deadline, outOfTime, pv);
+            if (score > alpha && !(outOfTime && *outOfTime))
+                score = -negamax(b, depth - 1, ply + 1, -beta, -alpha, other(toMove), need, deadline, outOfTime, pv);
+        }
+        else
+            score = -negamax(b, depth - 1, ply + 1, -beta, -alpha, other(toMove), need, deadline, outOfTime, pv);
         b.undo(m.x, m.y);
         if (outOfTime && *outOfTime)
             return 0;
@@ -152,43 +286,143 @@ int AI::negamax(Board &b, int depth, int alpha, int beta, Cell toMove, int need,
     }
 
     TTEntry entry;
+    entry.key = h;
     entry.depth = depth;
     entry.score = bestScore;
     entry.best = bestMove;
-    if (bestScore <= alpha)
+    if (bestScore <= alphaOrig)
         entry.flag = TTEntry::UPPER;
     else if (bestScore >= beta)
         entry.flag = TTEntry::LOWER;
     else
         entry.flag = TTEntry::EXACT;
-    if (tt.size() > ttMaxSize)
+    // depth-preferred replacement within a slot
+    if (slot.key != h || slot.depth <= depth)
+        slot = entry;
+
+    if (pv)
+        *pv = bestMove;
+    return bestScore;
+}
+
+int AI::qsearch(Board &b, int ply, int qply, int alpha, int beta, Cell toMove, int need, int &budget)
+{
+    ++nodeCount;
+    --budget;
+    const Cell opp = other(toMove);
+    const int win = 900000 - 10 * (maxDepth + qply);
+    Move *cand = arena.moves[ply].data();
+    std::size_t n = gen_moves(b, ply, need);
+
+    // a completion of ours wins; two of theirs cannot both be blocked
+    int blocks = 0;
+    Move block{};
+    for (std::size_t i = 0; i < n; ++i)
     {
-        size_t n = tt.size() / 2;
-        for (auto it2 = tt.begin(); it2 != tt.end() && n > 0;)
+        Move m = cand[i];
+        b.place(m.x, m.y, toMove);
+        bool won = b.is_win_from(m.x, m.y, toMove, need);
+        b.undo(m.x, m.y);
+        if (won)
+            return win;
+        b.place(m.x, m.y, opp);
+        if (b.is_win_from(m.x, m.y, opp, need))
         {
-            it2 = tt.erase(it2);
-            --n;
+            ++blocks;
+            block = m;
         }
+        b.undo(m.x, m.y);
     }
-    tt[h] = entry;
+    if (blocks >= 2)
+        return -(win - 10);
 
-    if (pv)
-        *pv = bestMove;
-    return bestScore;
+    int e = eval(b, need);
+    int stand = toMove == Cell::O ? e : -e;
+    if (budget <= 0 || qply >= qs.maxPly || ply >= SearchArena::MAX_PLY)
+        return stand;
+    if (blocks == 1)
+    {
+        b.place(block.x, block.y, toMove);
+        int score = -qsearch(b, ply + 1, qply + 1, -beta, -alpha, opp, need, budget);
+        b.undo(block.x, block.y);
+        return score;
+    }
+
+    // a cell giving us two completions wins unless they block with a threat of their
+    // own; count it as won without searching the reply
+    Move sq[8];
+    for (std::size_t i = 0; i < n; ++i)
+        if (completions(b, cand[i].x, cand[i].y, toMove, need, sq, 8) >= 2)
+            return win - 20;
+
+    // forcing moves: answers to the opponent's forks (the fork cell and the cells it
+    // would threaten) first, then our single threats
+    ScoredMove *list = arena.scored[ply].data();
+    std::size_t k = 0;
+    auto add = [&](int prio, Move m)
+    {
+        for (std::size_t j = 0; j < k; ++j)
+            if (list[j].move == m)
+                return;
+        list[k++] = {prio, m, false};
+    };
+    bool forked = false;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        int c = completions(b, cand[i].x, cand[i].y, opp, need, sq, 8);
+        if (c < 2)
+            continue;
+        forked = true;
+        add(2, cand[i]);
+        for (int j = 0; j < c; ++j)
+            if (k < n && b.is_empty(sq[j].x, sq[j].y))
+                add(1, sq[j]);
+    }
+    for (std::size_t i = 0; i < n && k < n; ++i)
+        if (completions(b, cand[i].x, cand[i].y, toMove, need, sq, 8))
+            add(0, cand[i]);
+    std::stable_sort(list, list + k, [](auto &a, auto &c)
+                     { return a.score > c.score; });
+
+    // standing pat is only safe when the opponent has no fork
+    int best = std::numeric_limits<int>::min() + 1;
+    if (!forked)
+    {
+        if (stand >= beta)
+            return stand;
+        alpha = std::max(alpha, stand);
+        best = stand;
+    }
+    for (std::size_t i = 0; i < k && budget > 0; ++i)
+    {
+        Move m = list[i].move;
+        b.place(m.x, m.y, toMove);
+        int score = -qsearch(b, ply + 1, qply + 1, -beta, -alpha, opp, need, budget);
+        b.undo(m.x, m.y);
+        best = std::max(best, score);
+        alpha = std::max(alpha, score);
+        if (alpha >= beta)
+            break;
+    }
+    return best == std::numeric_limits<int>::min() + 1 ? stand : best;
 }
 
 Move AI::alphabeta_root(Board &b, int depth)
 {
-    auto cand = b.candidates(2);
-    if (cand.empty())
+    TTT_TRACE_SCOPE("AI::alphabeta_root");
+    Timer t;
+    bool stopped = false;
+    Move *cand = arena.moves[0].data();
+    std::size_t n = gen_moves(b, 0, 4);
+    if (n == 0)
         return Move{0, 0};
     int alpha = std::numeric_limits<int>::min() + 100000;
     int beta = std::numeric_limits<int>::max() - 100000;
 
-    Move best = cand.front();
+    Move best = cand[0];
     int bestScore = std::numeric_limits<int>::min();
     // order: try greedy wins first
-    std::sort(cand.begin(), cand.end(), [&](const Move &a, const Move &c)
+    std::sort(cand, cand + n, [&](const Move &a, const Move &c)
               {
         // heuristic compare by proximity to center of bbox
         int cx=(b.min_x()+b.max_x())/2, cy=(b.min_y()+b.max_y())/2;
@@ -196,8 +430,9 @@ Move AI::alphabeta_root(Board &b, int depth)
         auto dc = std::max(std::abs(c.x-cx), std::abs(c.y-cy));
         return da<dc; });
 
-    for (auto m : cand)
+    for (std::size_t i = 0; i < n; ++i)
     {
+        Move m = cand[i];
         if (!b.is_empty(m.x, m.y))
             continue;
         b.place(m.x, m.y, Cell::O);
@@ -207,8 +442,10 @@ Move AI::alphabeta_root(Board &b, int depth)
             b.undo(m.x, m.y);
             return m;
         }
-        score = -negamax(b, depth - 1, -beta, -alpha, Cell::X, 4);
+        score = -negamax(b, depth - 1, 1, -beta, -alpha, Cell::X, 4, nullptr, stopFlag ? &stopped : nullptr);
         b.undo(m.x, m.y);
+        if (stopped)
+            break;
         if (score > bestScore)
         {
             bestScore = score;
@@ -218,6 +455,8 @@ Move AI::alphabeta_root(Board &b, int depth)
         if (alpha >= beta)
             break;
     }
+    if (!stopped)
+        report(b, depth, bestScore, best, t);
     return best;
 }
 
@@ -226,25 +465,106 @@ Move AI::iterative_deepening(Board &b)
     Timer t;
     Move best = greedy(b);
     bool outOfTime = false;
+    doneDepth = 0;
     for (int d = 1; d <= maxDepth; ++d)
     {
         outOfTime = false;
         Move pv{};
         int alpha = std::numeric_limits<int>::min() + 100000;
         int beta = std::numeric_limits<int>::max() - 100000;
-        int score = negamax(b, d, alpha, beta, Cell::O, 4, &t, &outOfTime, &pv);
+        TTT_TRACE_SCOPE("AI::negamax iteration");
+        int score = negamax(b, d, 0, alpha, beta, Cell::O, 4, &t, &outOfTime, &pv);
         if (outOfTime)
             break;
         if (pv.x != 0 || pv.y != 0)
             best = pv; // update best line
+        doneDepth = d;
+        report(b, d, score, best, t);
     }
     return best;
 }
 
+void AI::report(Board &b, int depth, int score, Move best, const Timer &t)
+{
+    if (!onInfo)
+        return;
+    SearchInfo info;
+    info.depth = depth;
+    info.nodes = nodeCount;
+    info.timeMs = t.elapsed_ms();
+    info.score = score;
+    info.pv = pvBuf;
+    // the root is not always in the TT (alphabeta_root), so start from the chosen move
+    pvBuf[0] = best;
+    b.place(best.x, best.y, Cell::O);
+    info.pvLength = 1 + tt_walk(b, pvBuf + 1, depth - 1, Cell::X);
+    b.undo(best.x, best.y);
+    onInfo(info);
+}
+
+int AI::pv_line(Board &b, Move *out, int maxLen)
+{
+    return tt_walk(b, out, maxLen, Cell::O);
+}
+
+int AI::tt_walk(Board &b, Move *out, int maxLen, Cell toMove)
+{
+    const TTEntry *table = tt_data();
+    if (!table)
+        return 0;
+    if (maxLen > SearchArena::MAX_PLY)
+        maxLen = SearchArena::MAX_PLY;
+    int n = 0;
+    while (n < maxLen)
+    {
+        const TTEntry &e = table[b.hash() & (ttMaxSize - 1)];
+        if (e.key != b.hash() || e.depth <= 0 || !b.is_empty(e.best.x, e.best.y))
+            break;
+        out[n++] = e.best;
+        b.place(e.best.x, e.best.y, toMove);
+        bool win = b.is_win_from(e.best.x, e.best.y, toMove, 4);
+        toMove = other(toMove);
+        if (win)
+            break;
+    }
+    for (int i = n - 1; i >= 0; --i)
+        b.undo(out[i].x, out[i].y);
+    return n;
+}
+
 Move AI::choose_move(Board &b)
 {
+    TTT_TRACE_SCOPE("AI::choose_move");
+    metrics::CallTimer timer(mode == GREEDY_1PLY ? "greedy_1ply" : (mode == ALPHABETA ? "alphabeta" : "id_deepen"),
+                             mode == GREEDY_1PLY ? 1 : maxDepth, b.size());
     if (b.empty())
         return Move{0, 0};
+    nodeCount = reductionCount = 0;
+    doneDepth = timer.depth;
+    arena.prepare(b, mode == GREEDY_1PLY ? 1 : maxDepth + (qs.enabled ? qs.maxPly : 0), std::max(zone.radius, 2));
+    // the accumulator and the region index follow every place/undo of the search
+    PatternAccumulator *prev = b.attached();
+    RegionIndex *prevRegions = b.regions_attached();
+    if (usePattern)
+    {
+        patAcc.reset(b);
+        b.attach(&patAcc);
+    }
+    if (useRegions)
+    {
+        regions.reset(b);
+        b.attach_regions(&regions);
+    }
+    Move m = search(b);
+    b.attach(prev);
+    b.attach_regions(prevRegions);
+    timer.depth = doneDepth;
+    timer.nodes = static_cast<std::uint64_t>(nodeCount);
+    return m;
+}
+
+Move AI::search(Board &b)
+{
     switch (mode)
     {
     case GREEDY_1PLY:
@@ -1,11 +1,17 @@
 #pragma once
 #include "Board.hpp"
-#include <unordered_map>
+#include "Eval.hpp"
+#include "Regions.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <vector>
 
 struct TTEntry
 {
-    int depth{};
+    std::uint64_t key{};
+    int depth{-1};
     int score{};
     enum Flag : uint8_t
     {
@@ -16,6 +22,67 @@ struct TTEntry
     Move best{};
 };
 
+// A candidate with its ordering score; givesWin: the opponent completes a line right
+// after it, whatever the score says.
+struct ScoredMove
+{
+    int score;
+    Move move;
+    bool givesWin;
+};
+
+// Ply-indexed scratch buffers reused by every search node; sized once per root call,
+// so the search itself never touches the heap.
+struct SearchArena
+{
+    static constexpr int MAX_PLY = 64;
+    std::vector<Move> moves[MAX_PLY + 2];
+    std::vector<ScoredMove> scored[MAX_PLY + 1];
+    CandidateMarks marks;
+
+    void prepare(const Board &b, int depth, int radius = 2);
+};
+
+// Forward pruning in negamax. Null move: at depth >= nullMinDepth, unless the opponent
+// completes a line with its next stone, the side to move passes and the position is
+// searched nullR plies shallower with a null window; a fail-high cuts the node. Late-move
+// reductions: in an unthreatened node, moves after the first lmrFullMoves that neither
+// win nor allow an immediate win are searched lmrReduction plies shallower with a null
+// window, and again at full depth if they beat alpha.
+struct Pruning
+{
+    bool nullMove{true};
+    int nullR{2};
+    int nullMinDepth{3};
+    bool lmr{true};
+    int lmrFullMoves{3};
+    int lmrMinDepth{3};
+    int lmrReduction{1};
+};
+
+// Threat extension at the horizon: instead of evaluating a depth-0 node, keep playing
+// forcing moves until neither side has one: complete a line, block the opponent's only
+// completion, make a three that threatens one, or answer a cell where the opponent
+// would get two completions at once. At most maxPly plies and maxNodes nodes per leaf;
+// past either the static evaluation stands.
+struct Quiescence
+{
+    bool enabled{true};
+    int maxPly{6};
+    int maxNodes{32};
+};
+
+// Progress report after each completed iteration (or once for a fixed-depth search).
+struct SearchInfo
+{
+    int depth{};
+    long long nodes{};
+    int timeMs{};
+    int score{}; // from the side to move (O)
+    const Move *pv{};
+    int pvLength{};
+};
+
 class AI
 {
 public:
@@ -27,25 +94,92 @@ public:
     };
 
     void set_mode(Mode m) { mode = m; }
-    void set_depth(int d) { maxDepth = d < 1 ? 1 : d; }
+    void set_depth(int d) { maxDepth = d < 1 ? 1 : (d > SearchArena::MAX_PLY ? SearchArena::MAX_PLY : d); }
     int get_depth() const { return maxDepth; }
     Mode get_mode() const { return mode; }
 
     void set_time_budget(int ms) { timeBudgetMs = ms; }
+    void set_pruning(const Pruning &p) { prune = p; }
+    const Pruning &pruning() const { return prune; }
+    void set_quiescence(const Quiescence &q) { qs = q; }
+    const Quiescence &quiescence() const { return qs; }
+    // moves the search considers in long games; cap 0 searches every candidate
+    void set_zone(const CandidateZone &z) { zone = z; }
+    const CandidateZone &candidate_zone() const { return zone; }
+    // TT capacity in entries, rounded down to a power of two; drops the current contents
+    void set_tt_entries(size_t n);
+    void clear_tt();
+    // the table as it is (nullptr before the first search), tt_size() entries
+    const TTEntry *tt_data() const { return ttView ? ttView.get() : (tt.empty() ? nullptr : tt.data()); }
+    size_t tt_size() const { return ttView ? ttMaxSize : tt.size(); }
+    // search in a table kept alive by `table` (a mapped snapshot, see Snapshot.hpp) instead
+    // of an owned one; n is a power of two. set_tt_entries and clear_tt drop it.
+    void adopt_tt(std::shared_ptr<TTEntry> table, size_t n);
+
+    // Search polls `stop` and returns the best move found so far once it is set.
+    void set_stop_flag(const std::atomic<bool> *stop) { stopFlag = stop; }
+    void set_info_callback(std::function<void(const SearchInfo &)> cb) { onInfo = std::move(cb); }
+    long long nodes() const { return nodeCount; }
+    // moves the last search reduced by LMR
+    long long reductions() const { return reductionCount; }
+
+    // evaluation: Board::evaluate (nullptr, default) or the pattern net with these weights
+    void set_pattern_eval(const pattern_eval::Weights *w)
+    {
+        usePattern = w != nullptr;
+        if (w)
+            patAcc.set_weights(*w);
+    }
+    bool uses_pattern_eval() const { return usePattern; }
+    // keep a RegionIndex on the board during the search: the classic evaluation and the
+    // candidates come from per-cluster caches (same values, other candidate order)
+    void set_regions(bool on) { useRegions = on; }
+    bool uses_regions() const { return useRegions; }
 
     Move choose_move(Board &b);
+    // principal variation from the TT, starting with O to move; returns its length
+    int pv_line(Board &b, Move *out, int maxLen);
 
 private:
     Mode mode{ALPHABETA};
     int maxDepth{4};
     int timeBudgetMs{800};
+    Pruning prune;
+    Quiescence qs;
+    CandidateZone zone;
+
+    // Transposition table: fixed-size, indexed by the low bits of the Zobrist key.
+    // Owned in `tt` (allocated by the first search) or adopted in `ttView`.
+    std::vector<TTEntry> tt;
+    std::shared_ptr<TTEntry> ttView;
+    // xor-ed into TT keys while inside a null-move subtree: the stones alone do not tell
+    // whose turn it is there
+    std::uint64_t sideKey{0};
+    size_t ttMaxSize = size_t(1) << 19; // entries, power of two
+
+    SearchArena arena;
+    Move pvBuf[SearchArena::MAX_PLY];
+
+    const std::atomic<bool> *stopFlag{nullptr};
+    std::function<void(const SearchInfo &)> onInfo;
+    long long nodeCount{0};
+    long long reductionCount{0};
+    int doneDepth{0}; // deepest completed iteration, for the latency metrics
 
-    // Transposition table
-    std::unordered_map<std::uint64_t, TTEntry> tt;
-    size_t ttMaxSize = 300000;
+    bool usePattern{false};
+    PatternAccumulator patAcc; // attached to the board during choose_move
+    bool useRegions{false};
+    RegionIndex regions; // attached to the board during choose_move
 
+    TTEntry &tt_slot(std::uint64_t h);
+    int eval(const Board &b, int need) const { return usePattern ? patAcc.evaluate() : b.evaluate(need); }
+    std::size_t gen_moves(const Board &b, int ply, int need) { return b.zone_candidates(arena.moves[ply].data(), arena.moves[ply].size(), arena.marks, zone, need); }
+    Move search(Board &b);
     Move greedy(Board &b);
-    int negamax(Board &b, int depth, int alpha, int beta, Cell toMove, int need, Timer *deadline = nullptr, bool *outOfTime = nullptr, Move *pv = nullptr);
+    int negamax(Board &b, int depth, int ply, int alpha, int beta, Cell toMove, int need, Timer *deadline = nullptr, bool *outOfTime = nullptr, Move *pv = nullptr, bool allowNull = true);
+    int qsearch(Board &b, int ply, int qply, int alpha, int beta, Cell toMove, int need, int &budget);
     Move alphabeta_root(Board &b, int depth);
     Move iterative_deepening(Board &b);
+    void report(Board &b, int depth, int score, Move best, const Timer &t);
+    int tt_walk(Board &b, Move *out, int maxLen, Cell toMove);
 };
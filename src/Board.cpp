@@ -1,7 +1,11 @@
 #include "Board.hpp"
 #include "Zobrist.hpp"
+#include "Eval.hpp"
+#include "Regions.hpp"
+#include "Trace.hpp"
 #include <algorithm>
 #include <array>
+#include <cstddef>
 
 static bool between(int a, int b, int c) { return a <= b && b <= c; }
 
@@ -9,14 +13,13 @@ Board::Board() {}
 
 bool Board::is_empty(int x, int y) const
 {
-    auto it = cells.find(Coord{x, y});
-    return it == cells.end();
+    return !cells.contains(x, y);
 }
 
 Cell Board::at(int x, int y) const
 {
-    auto it = cells.find(Coord{x, y});
-    return (it == cells.end()) ? Cell::Empty : it->second;
+    const Cell *c = cells.find(x, y);
+    return c ? *c : Cell::Empty;
 }
 
 void Board::toggle_hash(int x, int y, Cell who)
@@ -26,10 +29,10 @@ void Board::toggle_hash(int x, int y, Cell who)
 
 bool Board::place(int x, int y, Cell who)
 {
-    auto key = Coord{x, y};
-    if (cells.find(key) != cells.end())
+    if (cells.contains(x, y))
         return false;
-    cells.emplace(key, who);
+    hist.push_back(UndoRecord{x, y, who, minX, maxX, minY, maxY, zkey});
+    cells.insert(x, y, who);
     if (cells.size() == 1)
     {
         minX = maxX = x;
@@ -43,41 +46,87 @@ bool Board::place(int x, int y, Cell who)
         maxY = std::max(maxY, y);
     }
     toggle_hash(x, y, who);
+    if (accum)
+        accum->on_change(*this, x, y, who, true);
+    if (regions)
+        regions->on_place(*this);
     return true;
 }
 
 void Board::undo(int x, int y)
 {
-    auto it = cells.find(Coord{x, y});
-    if (it == cells.end())
+    const Cell *c = cells.find(x, y);
+    if (!c)
         return;
-    Cell who = it->second;
-    toggle_hash(x, y, who);
-    cells.erase(it);
-    if (cells.empty())
+    if (accum)
+        accum->on_change(*this, x, y, *c, false);
+    cells.erase(x, y);
+    const UndoRecord &top = hist.back();
+    if (top.x == x && top.y == y)
     {
-        minX = maxX = minY = maxY = 0;
+        minX = top.minX;
+        maxX = top.maxX;
+        minY = top.minY;
+        maxY = top.maxY;
+        zkey = top.zkey;
+        hist.pop_back();
+        if (regions)
+            regions->on_undo(*this);
         return;
     }
-    if (x == minX || x == maxX || y == minY || y == maxY)
+    for (std::size_t i = hist.size() - 1; i-- > 0;)
+        if (hist[i].x == x && hist[i].y == y)
+        {
+            undo_out_of_order(i);
+            if (regions)
+                regions->reset(*this);
+            return;
+        }
+}
+
+// Removing a stone below the top of the history: drop its record and replay the
+// later ones so their saved bbox/hash no longer include it. O(moves since), rare.
+void Board::undo_out_of_order(std::size_t idx)
+{
+    UndoRecord gone = hist[idx];
+    std::uint64_t k = ZobristHash::instance().key_for(Coord{gone.x, gone.y}, gone.who);
+    hist.erase(hist.begin() + (std::ptrdiff_t)idx);
+    int bx0 = gone.minX, bx1 = gone.maxX, by0 = gone.minY, by1 = gone.maxY;
+    bool any = idx > 0;
+    for (std::size_t i = idx; i < hist.size(); ++i)
     {
-        // recompute bbox lazily
-        minX = std::numeric_limits<int>::max();
-        minY = std::numeric_limits<int>::max();
-        maxX = std::numeric_limits<int>::min();
-        maxY = std::numeric_limits<int>::min();
-        for (auto &kv : cells)
+        UndoRecord &r = hist[i];
+        r.minX = bx0;
+        r.maxX = bx1;
+        r.minY = by0;
+        r.maxY = by1;
+        r.zkey ^= k;
+        if (!any)
+        {
+            bx0 = bx1 = r.x;
+            by0 = by1 = r.y;
+            any = true;
+        }
+        else
         {
-            minX = std::min(minX, kv.first.x);
-            maxX = std::max(maxX, kv.first.x);
-            minY = std::min(minY, kv.first.y);
-            maxY = std::max(maxY, kv.first.y);
+            bx0 = std::min(bx0, r.x);
+            bx1 = std::max(bx1, r.x);
+            by0 = std::min(by0, r.y);
+            by1 = std::max(by1, r.y);
         }
     }
+    if (cells.empty())
+        bx0 = bx1 = by0 = by1 = 0;
+    minX = bx0;
+    maxX = bx1;
+    minY = by0;
+    maxY = by1;
+    zkey ^= k;
 }
 
 bool Board::is_win_from(int x, int y, Cell who, int need) const
 {
+    TTT_TRACE_SCOPE("Board::is_win_from");
     if (at(x, y) != who)
         return false;
     static const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
@@ -105,34 +154,129 @@ bool Board::is_win_from(int x, int y, Cell who, int need) const
     return false;
 }
 
+void CandidateMarks::cover(int minX, int minY, int maxX, int maxY)
+{
+    if (w > 0 && contains(minX, minY) && contains(maxX, maxY))
+        return;
+    x0 = minX;
+    y0 = minY;
+    w = maxX - minX + 1;
+    h = maxY - minY + 1;
+    stamp.assign((std::size_t)w * h, 0);
+    epoch = 0;
+}
+
+void CandidateMarks::next_epoch()
+{
+    if (++epoch == 0)
+    {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        epoch = 1;
+    }
+}
+
 std::vector<Move> Board::candidates(int radius) const
 {
-    std::vector<Move> out;
-    out.reserve(cells.size() * 8);
+    CandidateMarks marks;
+    std::vector<Move> out(max_candidates(0, radius));
+    out.resize(candidates(out.data(), out.size(), marks, radius));
+    return out;
+}
+
+std::size_t Board::max_candidates(int extra, int radius) const
+{
+    std::size_t side = 2 * (std::size_t)radius + 1;
+    return (cells.size() + extra) * (side * side - 1) + 1;
+}
+
+std::size_t Board::candidates(Move *out, std::size_t cap, CandidateMarks &marks, int radius) const
+{
+    TTT_TRACE_SCOPE("Board::candidates");
+    std::size_t n = 0;
     if (cells.empty())
     {
-        out.emplace_back(0, 0);
-        return out;
+        if (cap > 0)
+            out[n++] = Move(0, 0);
+        return n;
     }
-    std::unordered_map<Coord, bool, CoordHasher> seen;
-    for (auto &kv : cells)
-    {
-        int x = kv.first.x, y = kv.first.y;
+    marks.cover(minX - radius, minY - radius, maxX + radius, maxY + radius);
+    if (regions && radius >= 1 && radius <= RegionIndex::LINK)
+        return regions->candidates(*this, out, cap, marks, radius);
+    marks.next_epoch();
+    cells.for_each([&](int x, int y, Cell)
+                   {
         for (int dx = -radius; dx <= radius; ++dx)
         {
             for (int dy = -radius; dy <= radius; ++dy)
             {
                 int nx = x + dx, ny = y + dy;
-                Coord c{nx, ny};
-                if (cells.find(c) == cells.end() && !seen.count(c))
+                if (!cells.contains(nx, ny) && marks.mark(nx, ny) && n < cap)
+                    out[n++] = Move(nx, ny);
+            }
+        } });
+    return n;
+}
+
+std::size_t Board::zone_candidates(Move *out, std::size_t cap, CandidateMarks &marks, const CandidateZone &zone, int need) const
+{
+    TTT_TRACE_SCOPE("Board::zone_candidates");
+    int r = std::max(zone.radius, 1);
+    if (zone.cap <= 0 || cells.size() < (std::size_t)zone.fromStones || hist.empty())
+        return candidates(out, cap, marks, r);
+    marks.cover(minX - r, minY - r, maxX + r, maxY + r);
+    marks.next_epoch();
+    std::size_t n = 0;
+
+    // threat cells: the empty cell just past a run, when filling it (joining any run
+    // beyond) completes a line or leaves need-1 with both ends open
+    static const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+    auto run = [&](int x, int y, int dx, int dy, Cell who)
+    {
+        int k = 0;
+        while (at(x + (k + 1) * dx, y + (k + 1) * dy) == who)
+            ++k;
+        return k;
+    };
+    cells.for_each([&](int x, int y, Cell who)
+                   {
+        for (auto &d : dirs)
+        {
+            if (at(x - d[0], y - d[1]) == who)
+                continue; // not the first stone of its run
+            int len = 1 + run(x, y, d[0], d[1], who);
+            for (int s = -1; s <= 1; s += 2)
+            {
+                // the gap past this end, the run beyond it, and the far ends of the join
+                int gx = s > 0 ? x + len * d[0] : x - d[0], gy = s > 0 ? y + len * d[1] : y - d[1];
+                if (cells.contains(gx, gy))
+                    continue;
+                int beyond = run(gx, gy, s * d[0], s * d[1], who);
+                int total = len + 1 + beyond;
+                bool hot = total >= need;
+                if (!hot && total == need - 1)
                 {
-                    seen[c] = true;
-                    out.emplace_back(nx, ny);
+                    int nearX = s > 0 ? x - d[0] : x + len * d[0], nearY = s > 0 ? y - d[1] : y + len * d[1];
+                    int farX = gx + s * (beyond + 1) * d[0], farY = gy + s * (beyond + 1) * d[1];
+                    hot = !cells.contains(nearX, nearY) && !cells.contains(farX, farY);
                 }
+                if (hot && marks.mark(gx, gy) && n < cap)
+                    out[n++] = Move(gx, gy);
             }
-        }
-    }
-    return out;
+        } });
+
+    // the local zone, nearest ring first, newest stone first within a ring
+    std::size_t limit = std::min(cap, n + (std::size_t)zone.cap);
+    std::size_t from = hist.size() > (std::size_t)std::max(zone.recent, 1) ? hist.size() - std::max(zone.recent, 1) : 0;
+    for (int ring = 1; ring <= r && n < limit; ++ring)
+        for (std::size_t i = hist.size(); i-- > from && n < limit;)
+            for (int dx = -ring; dx <= ring && n < limit; ++dx)
+                for (int dy = -ring; dy <= ring && n < limit; dy += (dx == -ring || dx == ring) ? 1 : 2 * ring)
+                {
+                    int nx = hist[i].x + dx, ny = hist[i].y + dy;
+                    if (!cells.contains(nx, ny) && marks.mark(nx, ny))
+                        out[n++] = Move(nx, ny);
+                }
+    return n;
 }
 
 int Board::line_score_from(int x, int y, int dx, int dy, Cell who, int need) const
@@ -184,12 +328,13 @@ int Board::line_score_from(int x, int y, int dx, int dy, Cell who, int need) con
 
 int Board::evaluate(int need) const
 {
+    TTT_TRACE_SCOPE("Board::evaluate");
+    if (regions)
+        return regions->evaluate(*this, need);
     int scoreO = 0, scoreX = 0;
     static const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
-    for (auto &kv : cells)
-    {
-        int x = kv.first.x, y = kv.first.y;
-        Cell c = kv.second;
+    cells.for_each([&](int x, int y, Cell c)
+                   {
         for (auto &d : dirs)
         {
             int s = line_score_from(x, y, d[0], d[1], c, need);
@@ -197,7 +342,6 @@ int Board::evaluate(int need) const
                 scoreO += s;
             else
                 scoreX += s;
-        }
-    }
+        } });
     return scoreO - scoreX;
 }
@@ -1,8 +1,8 @@
 #pragma once
-#include <unordered_map>
 #include <vector>
 #include <limits>
 #include "Coord.hpp"
+#include "FlatMap.hpp"
 #include "Utils.hpp"
 
 enum class Cell : uint8_t
@@ -22,6 +22,52 @@ struct Move
 };
 
 class ZobristHash;
+class PatternAccumulator;
+class RegionIndex;
+
+// One placed stone plus the board state it replaced; undo pops it in O(1)
+struct UndoRecord
+{
+    int x{}, y{};
+    Cell who{Cell::Empty};
+    int minX{}, maxX{}, minY{}, maxY{};
+    std::uint64_t zkey{};
+};
+
+// Caller-owned dedup scratch for Board::candidates: a stamp grid over a rectangle.
+// Covering a rectangle allocates only when it outgrows the grid; marking never does.
+struct CandidateMarks
+{
+    std::vector<std::uint32_t> stamp;
+    std::uint32_t epoch{0};
+    int x0{0}, y0{0}, w{0}, h{0};
+
+    void cover(int minX, int minY, int maxX, int maxY);
+    bool contains(int x, int y) const { return x >= x0 && y >= y0 && x < x0 + w && y < y0 + h; }
+    void next_epoch();
+    // true the first time (x, y) is marked in the current epoch
+    bool mark(int x, int y)
+    {
+        std::uint32_t &s = stamp[(std::size_t)(y - y0) * w + (x - x0)];
+        if (s == epoch)
+            return false;
+        s = epoch;
+        return true;
+    }
+};
+
+// Locality-limited candidates for long games (Board::zone_candidates). Below fromStones
+// stones, or with cap 0, they are just candidates(radius). Beyond, every empty cell that
+// completes a line or makes an open (need-1)-run for either side is kept, then cells
+// within radius of the last `recent` stones, nearest ring first and newest stone first
+// within a ring, up to `cap` of them. Branching then stays flat as the board grows.
+struct CandidateZone
+{
+    int radius{2};
+    int recent{6};
+    int cap{24};
+    int fromStones{40};
+};
 
 class Board
 {
@@ -37,6 +83,15 @@ public:
 
     // generate candidate moves near existing pieces
     std::vector<Move> candidates(int radius = 2) const;
+    // same moves in the same order, written to out[0..cap); returns the count.
+    // Allocation-free once marks covers bbox +- radius.
+    std::size_t candidates(Move *out, std::size_t cap, CandidateMarks &marks, int radius = 2) const;
+    // locality-limited candidates (see CandidateZone), threat cells first; a subset of
+    // candidates(max(radius, 1)), so max_candidates with that radius bounds them
+    std::size_t zone_candidates(Move *out, std::size_t cap, CandidateMarks &marks, const CandidateZone &zone, int need = 4) const;
+    // upper bound on candidates(radius) after `extra` more stones
+    std::size_t max_candidates(int extra, int radius = 2) const;
+    std::size_t size() const { return cells.size(); }
 
     // box of occupied cells
     int min_x() const { return minX; }
@@ -44,19 +99,38 @@ public:
     int min_y() const { return minY; }
     int max_y() const { return maxY; }
     bool empty() const { return cells.empty(); }
+    // heap bytes held by the stone table and the history
+    std::size_t memory_bytes() const { return cells.memory_bytes() + hist.capacity() * sizeof(UndoRecord); }
 
     // evaluation helper (heuristic static evaluation for 'O' - 'X')
     int evaluate(int need = 4) const;
 
+    // placed stones in order, each with the bbox/hash before it
+    const std::vector<UndoRecord> &history() const { return hist; }
+
+    // keep `acc` in sync with every place/undo (nullptr detaches); the caller resets it
+    void attach(PatternAccumulator *acc) { accum = acc; }
+    PatternAccumulator *attached() const { return accum; }
+    // keep `r` in sync with every place/undo and answer evaluate/candidates from its
+    // per-region caches (nullptr detaches); the caller resets it
+    void attach_regions(RegionIndex *r) { regions = r; }
+    RegionIndex *regions_attached() const { return regions; }
+
     // zobrist key for TT
     std::uint64_t hash() const { return zkey; }
     void toggle_hash(int x, int y, Cell who); // used by place/undo
 
 private:
-    std::unordered_map<Coord, Cell, CoordHasher> cells;
+    FlatMap<Cell> cells;
     int minX{0}, maxX{0}, minY{0}, maxY{0};
     std::uint64_t zkey{0};
+    std::vector<UndoRecord> hist;
+    PatternAccumulator *accum{nullptr};
+    RegionIndex *regions{nullptr};
     friend class ZobristHash;
+    friend class RegionIndex;
+
+    void undo_out_of_order(std::size_t idx);
 
     int line_score_from(int x, int y, int dx, int dy, Cell who, int need) const;
 };
@@ -0,0 +1,44 @@
+#pragma once
+#include <utility>
+#include <vector>
+
+// Fixed positions shared by the search regression oracles (tests/test_oracle*.cpp) and
+// the micro-benchmarks. Moves are in order with X first. Plain coordinates only, so
+// both the Board engine and Game.hpp (which has its own Cell) can include this.
+//
+// Appending a position is fine; changing one invalidates the recorded oracle values.
+namespace corpus
+{
+    struct Position
+    {
+        const char *name;
+        std::vector<std::pair<int, int>> moves;
+    };
+
+    inline const std::vector<Position> &positions()
+    {
+        static const std::vector<Position> all = {
+            {"first", {{0, 0}}},
+            {"opening", {{0, 0}, {1, 1}, {1, 0}, {0, 1}}},
+            {"open_three", {{0, 0}, {0, 5}, {1, 0}, {5, 5}, {2, 0}}},
+            {"diagonal", {{0, 0}, {1, 0}, {1, 1}, {2, 1}, {2, 2}, {0, 2}}},
+            {"cluster", {{0, 0}, {1, 1}, {1, 0}, {2, 0}, {0, 1}, {0, 2}, {-1, 1}, {2, 2}, {1, 2}, {-1, 2}}},
+            {"fork", {{0, 0}, {5, 5}, {1, 0}, {5, 6}, {0, 1}, {6, 5}, {1, 1}}},
+            {"two_fronts", {{0, 0}, {1, 1}, {1, 0}, {30, 30}, {31, 31}, {30, 31}, {-1, 1}}},
+            {"far_away", {{-1000000, 500}, {-999999, 501}, {-999999, 500}, {-1000001, 500}, {-999998, 499}}},
+            {"middlegame", {{0, 0}, {1, 0}, {0, 1}, {1, 1}, {2, 2}, {-1, -1}, {2, 0}, {0, 2}, {3, 1}, {1, 2}, {2, 1}, {2, 3}, {-1, 1}, {3, 0}}},
+        };
+        return all;
+    }
+
+    // A late-game board for the candidate-zone benchmarks: side x side stones 3 apart,
+    // row by row, two stones short of any line. The last row holds the recent moves.
+    inline std::vector<std::pair<int, int>> long_game(int side)
+    {
+        std::vector<std::pair<int, int>> moves;
+        for (int y = 0; y < side; ++y)
+            for (int x = 0; x < side; ++x)
+                moves.push_back({3 * x, 3 * y});
+        return moves;
+    }
+}
@@ -0,0 +1,251 @@
+#include "Eval.hpp"
+#include "Lanes.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace pattern_eval
+{
+    namespace
+    {
+        constexpr int DIRS[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+        constexpr int POW3[WINDOW] = {1, 3, 9, 27};
+        const char *HEADER = "ttt4-pattern-eval";
+
+        // ---- output layer: sum(clamp(acc, 0, CLIP) * w2) ----
+        using OutFn = std::int32_t (*)(const std::int16_t *acc, const std::int16_t *w2);
+
+        [[maybe_unused]] std::int32_t output_scalar(const std::int16_t *acc, const std::int16_t *w2)
+        {
+            std::int32_t s = 0;
+            for (int h = 0; h < HIDDEN; ++h)
+                s += std::min<std::int32_t>(std::max<std::int32_t>(acc[h], 0), CLIP) * w2[h];
+            return s;
+        }
+
+#ifdef TTT_LANES_X86
+        std::int32_t output_sse2(const std::int16_t *acc, const std::int16_t *w2)
+        {
+            const __m128i zero = _mm_setzero_si128(), clip = _mm_set1_epi16(CLIP);
+            __m128i sum = _mm_setzero_si128();
+            for (int h = 0; h < HIDDEN; h += 8)
+            {
+                __m128i a = _mm_load_si128(reinterpret_cast<const __m128i *>(acc + h));
+                a = _mm_min_epi16(_mm_max_epi16(a, zero), clip);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(a, _mm_load_si128(reinterpret_cast<const __m128i *>(w2 + h))));
+            }
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtsi128_si32(sum);
+        }
+
+        TTT_TARGET_AVX2 std::int32_t output_avx2(const std::int16_t *acc, const std::int16_t *w2)
+        {
+            const __m256i zero = _mm256_setzero_si256(), clip = _mm256_set1_epi16(CLIP);
+            __m256i sum = _mm256_setzero_si256();
+            for (int h = 0; h < HIDDEN; h += 16)
+            {
+                __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc + h));
+                a = _mm256_min_epi16(_mm256_max_epi16(a, zero), clip);
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, _mm256_load_si256(reinterpret_cast<const __m256i *>(w2 + h))));
+            }
+            __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtsi128_si32(s);
+        }
+#endif
+
+        OutFn output_kernel()
+        {
+            static const OutFn f = []
+            {
+#ifdef TTT_LANES_X86
+                return lanes::cpu_has_avx2() ? output_avx2 : output_sse2;
+#else
+                return output_scalar;
+#endif
+            }();
+            return f;
+        }
+
+        // shape of a pure window (stones of one colour only) as a neuron offset, -1 if none
+        int shape_of(int mask)
+        {
+            switch (mask)
+            {
+            case 0b0001: case 0b0010: case 0b0100: case 0b1000:
+                return 0; // single stone
+            case 0b0011: case 0b0110: case 0b1100:
+                return 1; // two adjacent
+            case 0b0101: case 0b1010:
+                return 2; // two with one gap
+            case 0b1001:
+                return 3; // two at the ends
+            case 0b0111: case 0b1110:
+                return 4; // three in a run
+            case 0b1011: case 0b1101:
+                return 5; // three split
+            case 0b1111:
+                return 6;
+            default:
+                return -1;
+            }
+        }
+
+        Weights make_defaults()
+        {
+            static const std::int16_t score[SHAPES] = {15, 120, 120, 120, 1200, 1200, 16000};
+            Weights w;
+            for (int p = 0; p < PATTERNS; ++p)
+            {
+                int o = 0, x = 0;
+                for (int k = 0, v = p; k < WINDOW; ++k, v /= 3)
+                {
+                    o |= (v % 3 == int(Cell::O)) << k;
+                    x |= (v % 3 == int(Cell::X)) << k;
+                }
+                if (o && !x)
+                    w.w1[p][shape_of(o)] = 1;
+                if (x && !o)
+                    w.w1[p][SHAPES + shape_of(x)] = 1;
+            }
+            for (int k = 0; k < SHAPES; ++k)
+            {
+                w.w2[k] = score[k];
+                w.w2[SHAPES + k] = static_cast<std::int16_t>(-score[k]);
+            }
+            return w;
+        }
+    }
+
+    const Weights *startup_weights()
+    {
+        static const Weights *w = []() -> const Weights *
+        {
+            const char *path = std::getenv("TTT_EVAL_WEIGHTS");
+            if (!path || !*path)
+                return nullptr;
+            static Weights loaded;
+            if (!loaded.load(path))
+            {
+                std::fprintf(stderr, "TTT_EVAL_WEIGHTS: cannot load %s, using Board::evaluate\n", path);
+                return nullptr;
+            }
+            return &loaded;
+        }();
+        return w;
+    }
+
+    const Weights &Weights::defaults()
+    {
+        static const Weights w = make_defaults();
+        return w;
+    }
+
+    bool Weights::load(const std::string &path)
+    {
+        std::ifstream in(path);
+        std::string magic;
+        int version = 0, patterns = 0, hidden = 0;
+        if (!(in >> magic >> version >> patterns >> hidden) || magic != HEADER || version != 1 ||
+            patterns != PATTERNS || hidden != HIDDEN)
+            return false;
+        Weights t;
+        auto read = [&](std::int16_t &dst, int bound)
+        {
+            long v;
+            if (!(in >> v) || v < -bound || v > bound)
+                return false;
+            dst = static_cast<std::int16_t>(v);
+            return true;
+        };
+        for (auto &row : t.w1)
+            for (auto &v : row)
+                if (!read(v, MAX_W1))
+                    return false;
+        for (auto &v : t.b1)
+            if (!read(v, 32767))
+                return false;
+        for (auto &v : t.w2)
+            if (!read(v, MAX_W2))
+                return false;
+        if (!(in >> t.b2))
+            return false;
+        std::fill(t.w1[0], t.w1[0] + HIDDEN, std::int16_t(0)); // the empty window is not a feature
+        *this = t;
+        return true;
+    }
+
+    bool Weights::save(const std::string &path) const
+    {
+        std::ofstream out(path);
+        out << HEADER << " 1 " << PATTERNS << ' ' << HIDDEN << '\n';
+        for (auto &row : w1)
+        {
+            for (int h = 0; h < HIDDEN; ++h)
+                out << row[h] << (h + 1 < HIDDEN ? ' ' : '\n');
+        }
+        for (int h = 0; h < HIDDEN; ++h)
+            out << b1[h] << (h + 1 < HIDDEN ? ' ' : '\n');
+        for (int h = 0; h < HIDDEN; ++h)
+            out << w2[h] << (h + 1 < HIDDEN ? ' ' : '\n');
+        out << b2 << '\n';
+        return static_cast<bool>(out);
+    }
+}
+
+using namespace pattern_eval;
+
+void PatternAccumulator::reset(const Board &b)
+{
+    std::copy(w->b1, w->b1 + HIDDEN, acc);
+    // every window with a stone, counted once: from its first occupied cell
+    for (const UndoRecord &r : b.history())
+        for (auto &d : DIRS)
+            for (int s = 0; s < WINDOW; ++s)
+            {
+                Cell c[WINDOW];
+                int first = -1;
+                for (int k = 0; k < WINDOW; ++k)
+                {
+                    c[k] = b.at(r.x + (k - s) * d[0], r.y + (k - s) * d[1]);
+                    if (first < 0 && c[k] != Cell::Empty)
+                        first = k;
+                }
+                if (first != s)
+                    continue;
+                const std::int16_t *row = w->w1[pattern_of(c)];
+                for (int h = 0; h < HIDDEN; ++h)
+                    acc[h] = static_cast<std::int16_t>(acc[h] + row[h]);
+            }
+}
+
+void PatternAccumulator::on_change(const Board &b, int x, int y, Cell who, bool added)
+{
+    for (auto &d : DIRS)
+    {
+        // the line through (x, y): cells -3..3, all windows through the centre lie in it
+        Cell line[2 * WINDOW - 1];
+        for (int k = 0; k < 2 * WINDOW - 1; ++k)
+            line[k] = k == WINDOW - 1 ? who : b.at(x + (k - WINDOW + 1) * d[0], y + (k - WINDOW + 1) * d[1]);
+        for (int s = 0; s < WINDOW; ++s)
+        {
+            // window starts s cells before the centre, which sits at index s in it
+            const Cell *c = line + WINDOW - 1 - s;
+            int with = pattern_of(c);
+            int without = with - int(who) * POW3[s];
+            const std::int16_t *plus = w->w1[added ? with : without];
+            const std::int16_t *minus = w->w1[added ? without : with];
+            for (int h = 0; h < HIDDEN; ++h)
+                acc[h] = static_cast<std::int16_t>(acc[h] + plus[h] - minus[h]);
+        }
+    }
+}
+
+int PatternAccumulator::evaluate() const
+{
+    std::int64_t v = static_cast<std::int64_t>(output_kernel()(acc, w->w2)) + w->b2;
+    return static_cast<int>(std::clamp<std::int64_t>(v, -SCORE_LIMIT, SCORE_LIMIT));
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "Board.hpp"
+#include <cstdint>
+#include <string>
+
+// Learned pattern evaluator, NNUE-style.
+//
+// Input features are the 4-cell windows of the board: each window on any of the 4 line
+// directions has one of 3^4 = 81 patterns (cell values 0 empty, 1 X, 2 O, first cell
+// least significant), and the feature vector is the count of windows per pattern
+// (the all-empty pattern is ignored). The first layer is kept as an int16 accumulator
+// that place/undo update for the 16 windows through the changed cell; the output is
+// ClippedReLU(acc) . w2 + b2, scored for O like Board::evaluate.
+namespace pattern_eval
+{
+    constexpr int WINDOW = 4;
+    constexpr int PATTERNS = 81;
+    constexpr int HIDDEN = 32;
+    // ClippedReLU ceiling: a counting neuron stays exact up to 4095 windows (the default
+    // one-stone neuron saturated after ~8 lone stones at 127)
+    constexpr int CLIP = 4095;
+    // |w2| bound; HIDDEN * CLIP * MAX_W2 < 2^31, so the int32 output sum cannot overflow
+    constexpr int MAX_W2 = 16383;
+    // |w1| bound; keeps the int16 accumulator exact for boards up to ~2000 windows
+    constexpr int MAX_W1 = 16;
+    constexpr int SCORE_LIMIT = 800000; // below the search's mate scores
+    // default first layer: neurons 0..6 count pure O windows by shape (1 stone, 2 adjacent,
+    // 2 with a gap, 2 at the ends, 3 in a run, 3 split, 4), 7..13 the same for X
+    constexpr int SHAPES = 7;
+
+    struct Weights
+    {
+        alignas(32) std::int16_t w1[PATTERNS][HIDDEN]{};
+        alignas(32) std::int16_t b1[HIDDEN]{};
+        alignas(32) std::int16_t w2[HIDDEN]{};
+        std::int32_t b2{0};
+
+        // text file: "ttt4-pattern-eval 1 81 32", then w1 row by row, b1, w2, b2
+        bool load(const std::string &path);
+        bool save(const std::string &path) const;
+
+        // hand-made net that reproduces the window scores of Game.hpp:
+        // per side, pure windows with 1/2/3/4 stones score 15/120/1200/16000
+        static const Weights &defaults();
+    };
+
+    // weights named by the TTT_EVAL_WEIGHTS environment variable, loaded once;
+    // nullptr when unset or unreadable (callers keep Board::evaluate)
+    const Weights *startup_weights();
+
+    // pattern index of a window from its 4 cells
+    inline int pattern_of(const Cell c[WINDOW])
+    {
+        return int(c[0]) + 3 * int(c[1]) + 9 * int(c[2]) + 27 * int(c[3]);
+    }
+}
+
+class PatternAccumulator
+{
+public:
+    explicit PatternAccumulator(const pattern_eval::Weights &w = pattern_eval::Weights::defaults()) : w(&w) {}
+
+    void set_weights(const pattern_eval::Weights &weights) { w = &weights; }
+    const pattern_eval::Weights &weights() const { return *w; }
+
+    // rebuild from scratch, O(stones)
+    void reset(const Board &b);
+    // stone at (x, y) is on the board; `added` tells whether it was just placed or is about to go
+    void on_change(const Board &b, int x, int y, Cell who, bool added);
+    // score for O
+    int evaluate() const;
+
+    const std::int16_t *values() const { return acc; }
+
+private:
+    const pattern_eval::Weights *w;
+    alignas(32) std::int16_t acc[pattern_eval::HIDDEN]{};
+};
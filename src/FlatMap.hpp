@@ -0,0 +1,157 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Open-addressing map from board coordinates to a small value, Robin Hood probing.
+//
+// Slots are three parallel arrays: the packed (x, y) key, the probe distance + 1 (0 marks
+// an empty slot) and the value. A Cell slot takes 10 bytes, so a stone costs 11-23 bytes
+// depending on fill; an unordered_map node plus its bucket pointer is about 48.
+// The table doubles at 7/8 load and never shrinks, so place/undo cycles stop allocating
+// once it has grown. Erase shifts the following run back; there are no tombstones.
+// With the mixed hash below, probe distances stay far below the 255 a byte can hold.
+template <class V>
+class FlatMap
+{
+public:
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    std::size_t capacity() const { return keys.size(); }
+    // heap bytes held by the table
+    std::size_t memory_bytes() const
+    {
+        return keys.capacity() * sizeof(std::uint64_t) + dist.capacity() + vals.capacity() * sizeof(V);
+    }
+
+    void clear()
+    {
+        std::fill(dist.begin(), dist.end(), std::uint8_t(0));
+        count = 0;
+    }
+    // room for n entries without growing
+    void reserve(std::size_t n)
+    {
+        while (n * 8 > keys.size() * 7)
+            grow();
+    }
+
+    const V *find(int x, int y) const
+    {
+        if (count == 0)
+            return nullptr;
+        std::uint64_t k = pack(x, y);
+        std::size_t i = home(k);
+        for (std::uint8_t d = 1; dist[i] >= d; ++d, i = (i + 1) & mask)
+            if (keys[i] == k)
+                return &vals[i];
+        return nullptr;
+    }
+    V *find(int x, int y) { return const_cast<V *>(static_cast<const FlatMap *>(this)->find(x, y)); }
+    bool contains(int x, int y) const { return find(x, y) != nullptr; }
+
+    // false, and no change, if (x, y) is already present
+    bool insert(int x, int y, V v)
+    {
+        if ((count + 1) * 8 > keys.size() * 7)
+            grow();
+        std::uint64_t k = pack(x, y);
+        std::size_t i = home(k);
+        std::uint8_t d = 1;
+        for (; dist[i] >= d; ++d, i = (i + 1) & mask)
+            if (keys[i] == k)
+                return false;
+        place(i, k, v, d);
+        ++count;
+        return true;
+    }
+
+    bool erase(int x, int y)
+    {
+        if (count == 0)
+            return false;
+        std::uint64_t k = pack(x, y);
+        std::size_t i = home(k);
+        for (std::uint8_t d = 1; dist[i] >= d; ++d, i = (i + 1) & mask)
+            if (keys[i] == k)
+            {
+                // pull the rest of the run one slot closer to home
+                for (std::size_t j = (i + 1) & mask; dist[j] > 1; i = j, j = (j + 1) & mask)
+                {
+                    keys[i] = keys[j];
+                    vals[i] = vals[j];
+                    dist[i] = static_cast<std::uint8_t>(dist[j] - 1);
+                }
+                dist[i] = 0;
+                --count;
+                return true;
+            }
+        return false;
+    }
+
+    // fn(x, y, value) for every entry, in slot order
+    template <class F>
+    void for_each(F &&fn) const
+    {
+        for (std::size_t i = 0; i < keys.size(); ++i)
+            if (dist[i])
+                fn(static_cast<int>(static_cast<std::int32_t>(keys[i] >> 32)),
+                   static_cast<int>(static_cast<std::int32_t>(keys[i] & 0xffffffffu)), vals[i]);
+    }
+
+private:
+    std::vector<std::uint64_t> keys;
+    std::vector<std::uint8_t> dist;
+    std::vector<V> vals;
+    std::size_t count = 0, mask = 0;
+
+    static std::uint64_t pack(int x, int y)
+    {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+    }
+    std::size_t home(std::uint64_t k) const
+    {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        return static_cast<std::size_t>(k) & mask;
+    }
+
+    // Robin Hood: whoever is further from home keeps the slot
+    void place(std::size_t i, std::uint64_t k, V v, std::uint8_t d)
+    {
+        for (;; ++d, i = (i + 1) & mask)
+        {
+            if (dist[i] == 0)
+            {
+                keys[i] = k;
+                vals[i] = v;
+                dist[i] = d;
+                return;
+            }
+            if (dist[i] < d)
+            {
+                std::swap(keys[i], k);
+                std::swap(vals[i], v);
+                std::swap(dist[i], d);
+            }
+        }
+    }
+
+    void grow()
+    {
+        std::size_t cap = keys.empty() ? 16 : keys.size() * 2;
+        std::vector<std::uint64_t> oldKeys = std::move(keys);
+        std::vector<std::uint8_t> oldDist = std::move(dist);
+        std::vector<V> oldVals = std::move(vals);
+        keys.assign(cap, 0);
+        dist.assign(cap, 0);
+        vals.assign(cap, V{});
+        mask = cap - 1;
+        for (std::size_t i = 0; i < oldKeys.size(); ++i)
+            if (oldDist[i])
+                place(home(oldKeys[i]), oldKeys[i], oldVals[i], 1);
+    }
+};
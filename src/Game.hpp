@@ -8,6 +8,13 @@
 #include <utility>
 #include <string>
 #include <random>
+#include <cmath>
+#include "Lanes.hpp"
+#include "Utils.hpp"
+#include "GameRecord.hpp"
+#include "Metrics.hpp"
+#include "Trace.hpp"
+#include "FlatMap.hpp"
 
 enum class Cell : uint8_t
 {
@@ -36,6 +43,13 @@ struct IBoard
     virtual bool exists(int x, int y) const = 0;
     virtual Bounds bounds() const = 0;
     virtual size_t count() const = 0;
+    // последние не больше n камней, новые первыми; 0 — доска не помнит порядок ходов
+    virtual size_t recent(Pos *out, size_t n) const
+    {
+        (void)out;
+        (void)n;
+        return 0;
+    }
     virtual ~IBoard() = default;
 };
 
@@ -49,7 +63,7 @@ struct PairHash
 
 struct MapBoard : IBoard
 {
-    std::unordered_map<std::pair<int, int>, Cell, PairHash> cells; // PairHash хеш функция
+    FlatMap<Cell> cells; // открытая адресация: ~10 байт на ячейку таблицы вместо узла на камень
     int minx = std::numeric_limits<int>::max();
     int miny = std::numeric_limits<int>::max();
     int maxx = std::numeric_limits<int>::min();
@@ -58,38 +72,46 @@ struct MapBoard : IBoard
 
     Cell get(int x, int y) const override
     {
-        auto it = cells.find({x, y});
-        if (it == cells.end())
-            return Cell::Empty;
-        return it->second;
+        const Cell *c = cells.find(x, y);
+        return c ? *c : Cell::Empty;
     }
+    // Поставленные камни по порядку и bbox до каждого: снятие последнего — O(1),
+    // границы всегда точные (и после undo)
+    struct Placed
+    {
+        int x, y;
+        int minx, miny, maxx, maxy;
+    };
+    std::vector<Placed> history;
+
     void set(int x, int y, Cell c) override
     {
-        auto key = std::make_pair(x, y);
-        auto it = cells.find(key);
-        Cell prev = (it == cells.end() ? Cell::Empty : it->second);
+        Cell *it = cells.find(x, y);
         if (c == Cell::Empty)
         {
-            if (it != cells.end())
+            if (!it)
+                return;
+            cells.erase(x, y);
+            --nonEmpty;
+            if (!history.empty() && history.back().x == x && history.back().y == y)
             {
-                cells.erase(it);
-                if (prev != Cell::Empty && nonEmpty > 0)
-                    --nonEmpty;
+                const Placed &h = history.back();
+                minx = h.minx;
+                miny = h.miny;
+                maxx = h.maxx;
+                maxy = h.maxy;
+                history.pop_back();
             }
+            else
+                forget(x, y);
         }
+        else if (it)
+            *it = c; // смена цвета — границы те же
         else
         {
-            if (it == cells.end())
-            {
-                cells.emplace(key, c);
-                ++nonEmpty;
-            }
-            else
-            {
-                if (prev == Cell::Empty)
-                    ++nonEmpty;
-                it->second = c;
-            }
+            cells.insert(x, y, c);
+            ++nonEmpty;
+            history.push_back({x, y, minx, miny, maxx, maxy});
             if (x < minx)
                 minx = x;
             if (x > maxx)
@@ -100,10 +122,40 @@ struct MapBoard : IBoard
                 maxy = y;
         }
     }
+
+    // камень снят не в порядке LIFO: убираем его запись и пересчитываем bbox более поздних
+    void forget(int x, int y)
+    {
+        size_t i = history.size();
+        while (i > 0 && !(history[i - 1].x == x && history[i - 1].y == y))
+            --i;
+        if (i == 0)
+            return;
+        --i;
+        Placed gone = history[i];
+        history.erase(history.begin() + static_cast<std::ptrdiff_t>(i));
+        int x0 = gone.minx, y0 = gone.miny, x1 = gone.maxx, y1 = gone.maxy;
+        for (; i < history.size(); ++i)
+        {
+            Placed &h = history[i];
+            h.minx = x0;
+            h.miny = y0;
+            h.maxx = x1;
+            h.maxy = y1;
+            x0 = std::min(x0, h.x);
+            y0 = std::min(y0, h.y);
+            x1 = std::max(x1, h.x);
+            y1 = std::max(y1, h.y);
+        }
+        minx = x0;
+        miny = y0;
+        maxx = x1;
+        maxy = y1;
+    }
     bool exists(int x, int y) const override
     {
-        auto it = cells.find({x, y});
-        return it != cells.end() && it->second != Cell::Empty;
+        const Cell *c = cells.find(x, y);
+        return c && *c != Cell::Empty;
     }
     Bounds bounds() const override
     {
@@ -112,6 +164,16 @@ struct MapBoard : IBoard
         return {minx, miny, maxx, maxy};
     }
     size_t count() const override { return nonEmpty; }
+    size_t recent(Pos *out, size_t n) const override
+    {
+        size_t k = 0;
+        for (size_t i = history.size(); i-- > 0 && k < n;)
+            out[k++] = {history[i].x, history[i].y};
+        return k;
+    }
+
+    // память таблицы камней и истории
+    size_t memoryBytes() const { return cells.memory_bytes() + history.capacity() * sizeof(Placed); }
 };
 
 inline bool checkWinFrom(const IBoard &b, int x, int y, Cell who)
@@ -139,11 +201,18 @@ inline bool checkWinFrom(const IBoard &b, int x, int y, Cell who)
     return false;
 }
 
-inline std::vector<Pos> genCandidates(const IBoard &b, int margin = 2, int neighRadius = 2)
+// Кандидаты пишутся в буфер вызывающего out[0..cap); возвращается их число.
+// Ёмкости genCandidatesCap(b, margin) всегда хватает.
+inline size_t genCandidates(const IBoard &b, Pos *out, size_t cap, int margin = 2, int neighRadius = 2)
 {
+    TTT_TRACE_SCOPE("genCandidates");
     Bounds bb = b.bounds();
     if (bb.minx > bb.maxx)
-        return {{0, 0}};
+    {
+        if (cap > 0)
+            out[0] = {0, 0};
+        return cap > 0 ? 1 : 0;
+    }
     bb.minx -= margin;
     bb.miny -= margin;
     bb.maxx += margin;
@@ -159,16 +228,120 @@ inline std::vector<Pos> genCandidates(const IBoard &b, int margin = 2, int neigh
                 }
         return false;
     };
-    std::vector<Pos> out;
+    size_t n = 0;
     for (int y = bb.miny; y <= bb.maxy; ++y)
         for (int x = bb.minx; x <= bb.maxx; ++x)
-            if (b.get(x, y) == Cell::Empty && hasNeighbor(x, y))
-                out.push_back({x, y});
-    if (out.empty())
-        out.push_back({0, 0});
+            if (n < cap && b.get(x, y) == Cell::Empty && hasNeighbor(x, y))
+                out[n++] = {x, y};
+    if (n == 0 && cap > 0)
+        out[n++] = {0, 0};
+    return n;
+}
+// верхняя граница числа кандидатов, если к доске добавить ещё extra камней
+inline size_t genCandidatesCap(const IBoard &b, int extra = 0, int margin = 2)
+{
+    Bounds bb = b.bounds();
+    if (bb.minx > bb.maxx)
+        bb = {0, 0, 0, 0};
+    size_t grow = 2 * static_cast<size_t>(margin) * (extra + 1);
+    return (bb.maxx - bb.minx + 1 + grow) * (bb.maxy - bb.miny + 1 + grow);
+}
+inline std::vector<Pos> genCandidates(const IBoard &b, int margin = 2, int neighRadius = 2)
+{
+    std::vector<Pos> out(genCandidatesCap(b, 0, margin));
+    out.resize(genCandidates(b, out.data(), out.size(), margin, neighRadius));
     return out;
 }
 
+// Зона кандидатов для длинных партий (как CandidateZone у Board): от fromStones камней
+// negamax смотрит не весь bbox, а клетки-угрозы (достраивают линию или открытую
+// CONNECT-1 у любой стороны) плюс не больше cap клеток в радиусе radius от последних
+// recent камней — ближнее кольцо первым. cap 0 или доска без истории — genCandidates.
+struct NegamaxZone
+{
+    int radius = 2;
+    int recent = 6;
+    int cap = 24;
+    int fromStones = 40;
+};
+inline size_t genZoneCandidates(const IBoard &b, Pos *out, size_t cap, const NegamaxZone &z)
+{
+    TTT_TRACE_SCOPE("genZoneCandidates");
+    static constexpr size_t MAX_RECENT = 64;
+    Pos rec[MAX_RECENT];
+    size_t nr = 0;
+    if (z.cap > 0 && b.count() >= (size_t)z.fromStones)
+        nr = b.recent(rec, std::min<size_t>(std::max(z.recent, 1), MAX_RECENT));
+    if (nr == 0)
+        return genCandidates(b, out, cap);
+    size_t n = 0;
+    auto add = [&](Pos p)
+    {
+        for (size_t i = 0; i < n; ++i)
+            if (out[i] == p)
+                return;
+        if (n < cap)
+            out[n++] = p;
+    };
+
+    // клетки-угрозы: пустая клетка за концом ряда, если, заполнив её (и присоединив ряд
+    // за ней), сторона достраивает линию или получает CONNECT-1 с обоими открытыми концами
+    static const int DX[4] = {1, 0, 1, 1};
+    static const int DY[4] = {0, 1, 1, -1};
+    auto run = [&](int x, int y, int dx, int dy, Cell who)
+    {
+        int k = 0;
+        while (b.get(x + (k + 1) * dx, y + (k + 1) * dy) == who)
+            ++k;
+        return k;
+    };
+    Bounds bb = b.bounds();
+    for (int y = bb.miny; y <= bb.maxy; ++y)
+        for (int x = bb.minx; x <= bb.maxx; ++x)
+        {
+            Cell who = b.get(x, y);
+            if (who == Cell::Empty)
+                continue;
+            for (int d = 0; d < 4; ++d)
+            {
+                if (b.get(x - DX[d], y - DY[d]) == who)
+                    continue; // не первый камень ряда
+                int len = 1 + run(x, y, DX[d], DY[d], who);
+                for (int s = -1; s <= 1; s += 2)
+                {
+                    Pos g = s > 0 ? Pos{x + len * DX[d], y + len * DY[d]} : Pos{x - DX[d], y - DY[d]};
+                    if (b.get(g.x, g.y) != Cell::Empty)
+                        continue;
+                    int beyond = run(g.x, g.y, s * DX[d], s * DY[d], who);
+                    int total = len + 1 + beyond;
+                    bool hot = total >= CONNECT;
+                    if (!hot && total == CONNECT - 1)
+                    {
+                        Pos nearEnd = s > 0 ? Pos{x - DX[d], y - DY[d]} : Pos{x + len * DX[d], y + len * DY[d]};
+                        Pos farEnd{g.x + s * (beyond + 1) * DX[d], g.y + s * (beyond + 1) * DY[d]};
+                        hot = b.get(nearEnd.x, nearEnd.y) == Cell::Empty && b.get(farEnd.x, farEnd.y) == Cell::Empty;
+                    }
+                    if (hot)
+                        add(g);
+                }
+            }
+        }
+
+    // локальная зона: ближнее кольцо первым, внутри кольца — новые камни первыми
+    size_t limit = std::min(cap, n + (size_t)z.cap);
+    int r = std::max(z.radius, 1);
+    for (int ring = 1; ring <= r && n < limit; ++ring)
+        for (size_t i = 0; i < nr && n < limit; ++i)
+            for (int dx = -ring; dx <= ring && n < limit; ++dx)
+                for (int dy = -ring; dy <= ring && n < limit; dy += (dx == -ring || dx == ring) ? 1 : 2 * ring)
+                {
+                    Pos p{rec[i].x + dx, rec[i].y + dy};
+                    if (b.get(p.x, p.y) == Cell::Empty)
+                        add(p);
+                }
+    return n;
+}
+
 inline int windowScore(int my, int empty)
 {
     if (my == 4)
@@ -183,6 +356,7 @@ inline int windowScore(int my, int empty)
 }
 inline int evaluate(const IBoard &b, Cell me)
 {
+    TTT_TRACE_SCOPE("evaluate");
     if (me == Cell::Empty)
         return 0;
     Cell opp = (me == Cell::O) ? Cell::X : Cell::O;
@@ -350,6 +524,7 @@ struct TempPlace1
 };
 inline Pos ai_greedy(IBoard &b, Cell me)
 {
+    metrics::CallTimer timer("ai_greedy", 1, b.count());
     Cell opp = (me == Cell::O) ? Cell::X : Cell::O;
 
     // 1) Немедленная победа
@@ -392,36 +567,247 @@ struct TempPlace2
     }
     ~TempPlace2() { b->set(p.x, p.y, prev); }
 };
-inline int negamax(IBoard &b, int depth, int alpha, int beta, Cell toMove, Pos lastMove, Cell me)
+// Отсечения вперёд в negamax. Нулевой ход: на глубине >= nullMinDepth, если соперник не
+// грозит выиграть следующим ходом, сторона «пропускает» ход и ищет на depth-1-nullR с
+// нулевым окном; результат >= beta отсекает узел. LMR: тихие ходы (не выигрыш, узел без
+// угрозы) после первых lmrFullMoves ищутся на lmrReduction мельче с нулевым окном и
+// перепроверяются на полной глубине, если превысили alpha.
+struct NegamaxPruning
+{
+    bool nullMove = true;
+    int nullR = 2;
+    int nullMinDepth = 3;
+    bool lmr = true;
+    int lmrFullMoves = 3;
+    int lmrMinDepth = 3;
+    int lmrReduction = 1;
+};
+// Продление угроз на горизонте: вместо оценки узла глубины 0 играются только форсированные
+// ходы — выигрыш, закрытие единственной угрозы соперника, своя угроза (тройка с пустой
+// клеткой) и ответ на «вилку» соперника, пока позиция не успокоится. Не дальше maxPly
+// полуходов и maxNodes узлов на лист; дальше — статическая оценка.
+struct NegamaxQuiescence
+{
+    bool enabled = true;
+    int maxPly = 6;
+    int maxNodes = 32;
+};
+// Буферы поиска по уровням (ply): размечаются один раз на корне, узлы negamax не аллоцируют
+struct NegamaxArena
 {
-    if (lastMove.x != std::numeric_limits<int>::min())
+    static constexpr int MAX_PLY = 64;
+    std::vector<Pos> cand[MAX_PLY + 1];
+    std::vector<std::pair<int, Pos>> ordered[MAX_PLY + 1];
+    // счётчик узлов; в progress уходит пачками по PROGRESS_BATCH, чтобы не трогать атомик в каждом узле
+    static constexpr uint64_t PROGRESS_BATCH = 1024;
+    uint64_t nodes = 0;
+    metrics::SearchProgress *progress = nullptr;
+    NegamaxPruning prune;
+    NegamaxQuiescence quiesce;
+    NegamaxZone zone;
+
+    void prepare(const IBoard &b, int depth)
     {
-        Cell opp = (toMove == Cell::O) ? Cell::X : Cell::O;
-        if (checkWinFrom(b, lastMove.x, lastMove.y, opp))
-            return (toMove == me ? -INF_SCORE : INF_SCORE);
+        if (quiesce.enabled)
+            depth += quiesce.maxPly;
+        size_t cap = genCandidatesCap(b, depth);
+        for (int p = 0; p <= depth && p <= MAX_PLY; ++p)
+        {
+            if (cand[p].size() < cap)
+                cand[p].resize(cap);
+            if (ordered[p].size() < cap)
+                ordered[p].resize(cap);
+        }
     }
-    if (depth == 0)
-        return evaluate(b, me);
-    auto cand = genCandidates(b);
-    if (cand.empty())
+};
+// Пустые клетки, которые достроят линию через (x, y), если who поставит туда камень;
+// без повторов, не больше cap.
+inline int lineCompletions(const IBoard &b, int x, int y, Cell who, Pos *out, int cap)
+{
+    static const int DX[4] = {1, 0, 1, 1};
+    static const int DY[4] = {0, 1, 1, -1};
+    int n = 0;
+    for (int d = 0; d < 4; ++d)
+        for (int s = 1 - CONNECT; s <= 0; ++s)
+        {
+            int own = 0, empty = 0;
+            Pos e{};
+            for (int k = 0; k < CONNECT; ++k)
+            {
+                int cx = x + (s + k) * DX[d], cy = y + (s + k) * DY[d];
+                Cell c = (cx == x && cy == y) ? who : b.get(cx, cy);
+                if (c == who)
+                    ++own;
+                else if (c == Cell::Empty && ++empty == 1)
+                    e = {cx, cy};
+                else
+                    break;
+            }
+            if (own != CONNECT - 1 || empty != 1)
+                continue;
+            bool dup = false;
+            for (int i = 0; i < n; ++i)
+                dup = dup || out[i] == e;
+            if (!dup && n < cap)
+                out[n++] = e;
+        }
+    return n;
+}
+inline int quiesce(IBoard &b, int ply, int qply, int alpha, int beta, Cell toMove, Cell me, NegamaxArena &arena, int &budget)
+{
+    if (++arena.nodes % NegamaxArena::PROGRESS_BATCH == 0 && arena.progress)
+        arena.progress->add_nodes(NegamaxArena::PROGRESS_BATCH);
+    --budget;
+    Cell opp = (toMove == Cell::O) ? Cell::X : Cell::O;
+    Pos *cand = arena.cand[ply].data();
+    size_t n = genZoneCandidates(b, cand, arena.cand[ply].size(), arena.zone);
+
+    // свой выигрыш — победа; две угрозы соперника не закрыть
+    int blocks = 0;
+    Pos block{};
+    for (size_t i = 0; i < n; ++i)
+    {
+        {
+            TempPlace2 t(&b, cand[i], toMove);
+            if (checkWinFrom(b, cand[i].x, cand[i].y, toMove))
+                return INF_SCORE;
+        }
+        TempPlace2 t(&b, cand[i], opp);
+        if (checkWinFrom(b, cand[i].x, cand[i].y, opp))
+        {
+            ++blocks;
+            block = cand[i];
+        }
+    }
+    if (blocks >= 2)
+        return -INF_SCORE;
+
+    int e = evaluate(b, me);
+    int stand = toMove == me ? e : -e;
+    if (budget <= 0 || qply >= arena.quiesce.maxPly || ply >= NegamaxArena::MAX_PLY)
+        return stand;
+    if (blocks == 1)
+    {
+        TempPlace2 t(&b, block, toMove);
+        return -quiesce(b, ply + 1, qply + 1, -beta, -alpha, opp, me, arena, budget);
+    }
+
+    // своя «вилка» (две угрозы сразу) выигрывает, ответ соперника не перебираем
+    Pos sq[8];
+    for (size_t i = 0; i < n; ++i)
+        if (lineCompletions(b, cand[i].x, cand[i].y, toMove, sq, 8) >= 2)
+            return INF_SCORE;
+
+    // форсированные ходы: ответы на вилки соперника (сама клетка и её угрозы), затем свои угрозы
+    std::pair<int, Pos> *list = arena.ordered[ply].data();
+    size_t k = 0;
+    auto add = [&](int prio, Pos p)
+    {
+        for (size_t j = 0; j < k; ++j)
+            if (list[j].second == p)
+                return;
+        list[k++] = {prio, p};
+    };
+    bool forked = false;
+    for (size_t i = 0; i < n; ++i)
+    {
+        int c = lineCompletions(b, cand[i].x, cand[i].y, opp, sq, 8);
+        if (c < 2)
+            continue;
+        forked = true;
+        add(2, cand[i]);
+        for (int j = 0; j < c; ++j)
+            if (k < n && b.get(sq[j].x, sq[j].y) == Cell::Empty)
+                add(1, sq[j]);
+    }
+    for (size_t i = 0; i < n && k < n; ++i)
+        if (lineCompletions(b, cand[i].x, cand[i].y, toMove, sq, 8))
+            add(0, cand[i]);
+    std::stable_sort(list, list + k, [](auto &a, auto &c)
+                     { return a.first > c.first; });
+
+    // стоять на месте можно, только если у соперника нет вилки
+    int best = -INF_SCORE;
+    bool searched = false;
+    if (!forked)
+    {
+        if (stand >= beta)
+            return stand;
+        alpha = std::max(alpha, stand);
+        best = stand;
+        searched = true;
+    }
+    for (size_t i = 0; i < k && budget > 0; ++i)
+    {
+        TempPlace2 t(&b, list[i].second, toMove);
+        int val = -quiesce(b, ply + 1, qply + 1, -beta, -alpha, opp, me, arena, budget);
+        searched = true;
+        best = std::max(best, val);
+        alpha = std::max(alpha, val);
+        if (alpha >= beta)
+            break;
+    }
+    return searched ? best : stand;
+}
+// Оценка — с точки зрения toMove; `me` задаёт только, чью оценку считать на листе.
+inline int negamax(IBoard &b, int depth, int alpha, int beta, Cell toMove, Pos lastMove, Cell me, NegamaxArena &arena, int ply = 0, bool allowNull = true)
+{
+    if (++arena.nodes % NegamaxArena::PROGRESS_BATCH == 0 && arena.progress)
+        arena.progress->add_nodes(NegamaxArena::PROGRESS_BATCH);
+    Cell next = (toMove == Cell::O) ? Cell::X : Cell::O;
+    if (lastMove.x != std::numeric_limits<int>::min() && checkWinFrom(b, lastMove.x, lastMove.y, next))
+        return -INF_SCORE; // предыдущий ход соперника выиграл
+    if (depth == 0 && arena.quiesce.enabled && ply <= NegamaxArena::MAX_PLY)
+    {
+        int budget = arena.quiesce.maxNodes;
+        return quiesce(b, ply, 0, alpha, beta, toMove, me, arena, budget);
+    }
+    if (depth == 0 || ply > NegamaxArena::MAX_PLY)
+        return toMove == me ? evaluate(b, me) : -evaluate(b, me);
+    Pos *cand = arena.cand[ply].data();
+    size_t n = genZoneCandidates(b, cand, arena.cand[ply].size(), arena.zone);
+    if (n == 0)
         return 0;
 
-    std::vector<std::pair<int, Pos>> ordered;
-    ordered.reserve(cand.size());
-    for (auto p : cand)
+    const NegamaxPruning &pr = arena.prune;
+    bool threatened = false; // соперник выигрывает следующим ходом, если не закрыть
+    if (ply > 0 && (pr.nullMove || pr.lmr) && depth >= std::min(pr.nullMinDepth, pr.lmrMinDepth))
+        for (size_t i = 0; i < n && !threatened; ++i)
+        {
+            TempPlace2 t(&b, cand[i], next);
+            threatened = checkWinFrom(b, cand[i].x, cand[i].y, next);
+        }
+    if (ply > 0 && allowNull && pr.nullMove && depth >= pr.nullMinDepth && !threatened && beta < INF_SCORE / 2)
     {
-        TempPlace2 t(&b, p, toMove);
-        ordered.push_back({evaluate(b, me), p});
+        int r = std::max(0, depth - 1 - pr.nullR);
+        int val = -negamax(b, r, -beta, -beta + 1, next, {std::numeric_limits<int>::min(), 0}, me, arena, ply + 1, false);
+        if (val >= beta)
+            return val >= INF_SCORE / 2 ? beta : val; // выигрыш без хода не доказан
     }
-    std::sort(ordered.begin(), ordered.end(), [](auto &a, auto &b)
+
+    std::pair<int, Pos> *ordered = arena.ordered[ply].data();
+    for (size_t i = 0; i < n; ++i)
+    {
+        TempPlace2 t(&b, cand[i], toMove);
+        int e = evaluate(b, me);
+        ordered[i] = {checkWinFrom(b, cand[i].x, cand[i].y, toMove) ? INF_SCORE : (toMove == me ? e : -e), cand[i]};
+    }
+    std::sort(ordered, ordered + n, [](auto &a, auto &b)
               { return a.first > b.first; });
     int best = -INF_SCORE;
-    Cell next = (toMove == Cell::O) ? Cell::X : Cell::O;
-    for (auto &sp : ordered)
+    for (size_t i = 0; i < n; ++i)
     {
-        Pos p = sp.second;
+        Pos p = ordered[i].second;
         TempPlace2 t(&b, p, toMove);
-        int val = -negamax(b, depth - 1, -beta, -alpha, next, p, me);
+        int val;
+        if (pr.lmr && i >= (size_t)pr.lmrFullMoves && depth >= pr.lmrMinDepth && !threatened && ordered[i].first < INF_SCORE)
+        {
+            val = -negamax(b, depth - 1 - pr.lmrReduction, -alpha - 1, -alpha, next, p, me, arena, ply + 1);
+            if (val > alpha)
+                val = -negamax(b, depth - 1, -beta, -alpha, next, p, me, arena, ply + 1);
+        }
+        else
+            val = -negamax(b, depth - 1, -beta, -alpha, next, p, me, arena, ply + 1);
         if (val > best)
             best = val;
         if (best > alpha)
@@ -431,8 +817,12 @@ inline int negamax(IBoard &b, int depth, int alpha, int beta, Cell toMove, Pos l
     }
     return best;
 }
-inline Pos ai_negamax(IBoard &b, Cell me, int depth)
+// progress (необязательно) получает число узлов по ходу поиска
+inline Pos ai_negamax(IBoard &b, Cell me, int depth, metrics::SearchProgress *progress = nullptr, const NegamaxPruning &prune = {},
+                      const NegamaxQuiescence &qs = {}, const NegamaxZone &zone = {})
 {
+    TTT_TRACE_SCOPE("ai_negamax");
+    metrics::CallTimer timer("ai_negamax", depth, b.count());
     Cell opp = (me == Cell::O) ? Cell::X : Cell::O;
 
     if (auto wins = immediateWinningMoves(b, me); !wins.empty())
@@ -442,16 +832,24 @@ inline Pos ai_negamax(IBoard &b, Cell me, int depth)
     if (auto forks = forkPoints(b, opp); !forks.empty())
         return forks.front();
 
-    auto cand = genCandidates(b);
+    std::vector<Pos> cand(genCandidatesCap(b));
+    cand.resize(genZoneCandidates(b, cand.data(), cand.size(), zone));
     if (cand.empty())
         return {0, 0};
+    static thread_local NegamaxArena arena;
+    arena.quiesce = qs;
+    arena.zone = zone;
+    arena.prepare(b, depth);
+    arena.nodes = 0;
+    arena.progress = progress;
+    arena.prune = prune;
     int best = -INF_SCORE;
     Pos bestP = cand.front();
     int alpha = -INF_SCORE, beta = INF_SCORE;
     for (auto p : cand)
     {
         TempPlace2 t(&b, p, me);
-        int val = -negamax(b, depth - 1, -beta, -alpha, opp, p, me);
+        int val = -negamax(b, depth - 1, -beta, -alpha, opp, p, me, arena, 1);
         if (val > best)
         {
             best = val;
@@ -460,36 +858,303 @@ inline Pos ai_negamax(IBoard &b, Cell me, int depth)
         if (val > alpha)
             alpha = val;
     }
+    if (progress)
+        progress->add_nodes(arena.nodes % NegamaxArena::PROGRESS_BATCH);
+    arena.progress = nullptr;
+    timer.nodes = arena.nodes;
     return bestP;
 }
 
+// Тот же поиск, что ai_negamax, но на явном стеке вместо рекурсии: step() делает около
+// maxWork единиц работы — узел или оценка хода при сортировке (лист с продлением угроз
+// считается целиком, до quiesce.maxNodes узлов) — и возвращает управление, так что
+// однопоточный фронтенд ведёт поиск кусками в цикле кадров.
+// Ход и число узлов те же, что у ai_negamax. Поиск идёт на копии доски: между кадрами
+// на исходной нет камней поиска.
+class NegamaxTask
+{
+public:
+    void start(const MapBoard &b, Cell me_, int depth_, metrics::SearchProgress *progress = nullptr, const NegamaxPruning &prune = {},
+               const NegamaxQuiescence &qs = {}, const NegamaxZone &zone = {})
+    {
+        board = b;
+        me = me_;
+        opp = (me == Cell::O) ? Cell::X : Cell::O;
+        depth = depth_;
+        stack.clear();
+        stack.reserve(NegamaxArena::MAX_PLY + 2);
+        finished = true;
+        rootPending = false;
+        arena.nodes = 0;
+        if (auto wins = immediateWinningMoves(board, me); !wins.empty())
+            bestP = wins.front();
+        else if (auto oppWins = immediateWinningMoves(board, opp); !oppWins.empty())
+            bestP = oppWins.front();
+        else if (auto forks = forkPoints(board, opp); !forks.empty())
+            bestP = forks.front();
+        else
+        {
+            root.resize(genCandidatesCap(board));
+            root.resize(genZoneCandidates(board, root.data(), root.size(), zone));
+            bestP = root.empty() ? Pos{0, 0} : root.front();
+            finished = root.empty();
+        }
+        if (finished)
+            return;
+        arena.quiesce = qs;
+        arena.zone = zone;
+        arena.prepare(board, depth);
+        arena.progress = progress;
+        arena.prune = prune;
+        rootI = 0;
+        best = alpha = -INF_SCORE;
+        work = 0;
+    }
+    // true — поиск закончен, ход в result()
+    bool step(uint64_t maxWork)
+    {
+        TTT_TRACE_SCOPE("NegamaxTask::step");
+        uint64_t stop = work + maxWork;
+        while (!finished && work < stop)
+        {
+            if (stack.empty())
+                advanceRoot();
+            else
+                advance(stack.back());
+        }
+        return finished;
+    }
+    // бросить поиск (новая партия): доска своя, убирать нечего
+    void cancel()
+    {
+        stack.clear();
+        finished = true;
+        arena.progress = nullptr;
+    }
+    bool done() const { return finished; }
+    Pos result() const { return bestP; }
+    uint64_t nodes() const { return arena.nodes; }
+
+private:
+    struct Frame
+    {
+        enum Stage : uint8_t
+        {
+            Enter,
+            AfterNull,
+            Order,
+            Loop,
+            AfterReduced,
+            AfterChild
+        };
+        int depth, alpha, beta, ply;
+        Cell toMove;
+        Pos lastMove;
+        bool allowNull;
+        Stage stage;
+        bool threatened;
+        size_t n, i; // кандидатов; следующий к сортировке или к перебору
+        int best;
+        Pos placed;
+    };
+
+    MapBoard board;
+    NegamaxArena arena;
+    Cell me = Cell::O, opp = Cell::X;
+    int depth = 1;
+    std::vector<Pos> root;
+    size_t rootI = 0;
+    int best = -INF_SCORE, alpha = -INF_SCORE;
+    Pos bestP{0, 0};
+    std::vector<Frame> stack; // не растёт дальше MAX_PLY + 2: ссылки на кадры живут между push
+    int childVal = 0;
+    uint64_t work = 0;
+    bool rootPending = false, finished = true;
+
+    void push(int d, int a, int bt, int ply, Cell toMove, Pos last, bool allowNull)
+    {
+        stack.push_back({d, a, bt, ply, toMove, last, allowNull, Frame::Enter, false, 0, 0, -INF_SCORE, {0, 0}});
+    }
+    void ret(int v)
+    {
+        stack.pop_back();
+        childVal = v;
+    }
+    void advanceRoot()
+    {
+        if (rootPending)
+        {
+            rootPending = false;
+            Pos p = root[rootI++];
+            board.set(p.x, p.y, Cell::Empty);
+            int val = -childVal;
+            if (val > best)
+            {
+                best = val;
+                bestP = p;
+            }
+            if (val > alpha)
+                alpha = val;
+        }
+        if (rootI == root.size())
+        {
+            if (arena.progress)
+                arena.progress->add_nodes(arena.nodes % NegamaxArena::PROGRESS_BATCH);
+            arena.progress = nullptr;
+            finished = true;
+            return;
+        }
+        Pos p = root[rootI];
+        board.set(p.x, p.y, me);
+        rootPending = true;
+        push(depth - 1, -INF_SCORE, -alpha, 1, opp, p, true);
+    }
+    // оценка одного кандидата; после последнего — сортировка и перебор
+    void order(Frame &f)
+    {
+        Pos c = arena.cand[f.ply][f.i];
+        std::pair<int, Pos> *ordered = arena.ordered[f.ply].data();
+        {
+            TempPlace2 t(&board, c, f.toMove);
+            int e = evaluate(board, me);
+            ordered[f.i] = {checkWinFrom(board, c.x, c.y, f.toMove) ? INF_SCORE : (f.toMove == me ? e : -e), c};
+        }
+        ++work;
+        if (++f.i < f.n)
+            return;
+        std::sort(ordered, ordered + f.n, [](auto &a, auto &b)
+                  { return a.first > b.first; });
+        f.i = 0;
+        f.stage = Frame::Loop;
+    }
+    // один шаг кадра f (см. negamax: те же ветви в том же порядке)
+    void advance(Frame &f)
+    {
+        const NegamaxPruning &pr = arena.prune;
+        Cell next = (f.toMove == Cell::O) ? Cell::X : Cell::O;
+        switch (f.stage)
+        {
+        case Frame::Enter:
+        {
+            ++work;
+            if (++arena.nodes % NegamaxArena::PROGRESS_BATCH == 0 && arena.progress)
+                arena.progress->add_nodes(NegamaxArena::PROGRESS_BATCH);
+            if (f.lastMove.x != std::numeric_limits<int>::min() && checkWinFrom(board, f.lastMove.x, f.lastMove.y, next))
+                return ret(-INF_SCORE);
+            if (f.depth == 0 && arena.quiesce.enabled && f.ply <= NegamaxArena::MAX_PLY)
+            {
+                int budget = arena.quiesce.maxNodes;
+                uint64_t before = arena.nodes;
+                int val = quiesce(board, f.ply, 0, f.alpha, f.beta, f.toMove, me, arena, budget);
+                work += arena.nodes - before;
+                return ret(val);
+            }
+            if (f.depth == 0 || f.ply > NegamaxArena::MAX_PLY)
+                return ret(f.toMove == me ? evaluate(board, me) : -evaluate(board, me));
+            Pos *cand = arena.cand[f.ply].data();
+            f.n = genZoneCandidates(board, cand, arena.cand[f.ply].size(), arena.zone);
+            if (f.n == 0)
+                return ret(0);
+            if (f.ply > 0 && (pr.nullMove || pr.lmr) && f.depth >= std::min(pr.nullMinDepth, pr.lmrMinDepth))
+                for (size_t i = 0; i < f.n && !f.threatened; ++i)
+                {
+                    TempPlace2 t(&board, cand[i], next);
+                    f.threatened = checkWinFrom(board, cand[i].x, cand[i].y, next);
+                }
+            if (f.ply > 0 && f.allowNull && pr.nullMove && f.depth >= pr.nullMinDepth && !f.threatened && f.beta < INF_SCORE / 2)
+            {
+                f.stage = Frame::AfterNull;
+                return push(std::max(0, f.depth - 1 - pr.nullR), -f.beta, -f.beta + 1, f.ply + 1, next,
+                            {std::numeric_limits<int>::min(), 0}, false);
+            }
+            f.stage = Frame::Order;
+            return;
+        }
+        case Frame::AfterNull:
+        {
+            int val = -childVal;
+            if (val >= f.beta)
+                return ret(val >= INF_SCORE / 2 ? f.beta : val);
+            f.stage = Frame::Order;
+            return;
+        }
+        case Frame::Order:
+            return order(f);
+        case Frame::Loop:
+        {
+            if (f.i >= f.n)
+                return ret(f.best);
+            const std::pair<int, Pos> &o = arena.ordered[f.ply][f.i];
+            f.placed = o.second;
+            board.set(f.placed.x, f.placed.y, f.toMove);
+            if (pr.lmr && f.i >= (size_t)pr.lmrFullMoves && f.depth >= pr.lmrMinDepth && !f.threatened && o.first < INF_SCORE)
+            {
+                f.stage = Frame::AfterReduced;
+                return push(f.depth - 1 - pr.lmrReduction, -f.alpha - 1, -f.alpha, f.ply + 1, next, f.placed, true);
+            }
+            f.stage = Frame::AfterChild;
+            return push(f.depth - 1, -f.beta, -f.alpha, f.ply + 1, next, f.placed, true);
+        }
+        case Frame::AfterReduced:
+            if (-childVal > f.alpha)
+            {
+                f.stage = Frame::AfterChild;
+                return push(f.depth - 1, -f.beta, -f.alpha, f.ply + 1, next, f.placed, true);
+            }
+            [[fallthrough]];
+        case Frame::AfterChild:
+        {
+            int val = -childVal;
+            board.set(f.placed.x, f.placed.y, Cell::Empty);
+            if (val > f.best)
+                f.best = val;
+            if (f.best > f.alpha)
+                f.alpha = f.best;
+            if (f.alpha >= f.beta)
+                return ret(f.best);
+            ++f.i;
+            f.stage = Frame::Loop;
+            return;
+        }
+        }
+    }
+};
+
 // ===== Simple MCTS-like playouts =====
+enum class PlayoutBackend
+{
+    Scalar,  // PlayoutEngine, по одной партии
+    Batched  // BatchPlayoutEngine, LANES партий шаг в шаг
+};
 struct MCTSParams
 {
     int iters = 1200;
     int playoutDepth = 12;
+    PlayoutBackend backend = PlayoutBackend::Scalar;
+    // RAVE: каждый ход me в плейауте засчитывается своему кандидату (AMAF — «как будто
+    // сыгран первым»), и оценка хода смешивает прямую статистику с AMAF с весом
+    // beta = sqrt(raveK / (3n + raveK)), n — плейауты, начатые с этого хода. Плейауты
+    // раздаются не поровну, а по UCB от смешанной оценки (коэффициент explore).
+    // rave = false — прежний перебор: iters / число кандидатов плейаутов на каждый ход.
+    bool rave = true;
+    int raveK = 300;
+    float explore = 0.4f;
 };
-struct TempPlace3
-{
-    IBoard *b;
-    Pos p;
-    Cell prev;
-    TempPlace3(IBoard *b_, Pos p_, Cell c) : b(b_), p(p_)
-    {
-        prev = b->get(p.x, p.y);
-        b->set(p.x, p.y, c);
-    }
-    ~TempPlace3() { b->set(p.x, p.y, prev); }
-};
+// Эталонный (медленный) плейаут: ходы копятся на самой доске и снимаются в конце
 inline int playout(IBoard &b, Pos start, Cell me, int depthLimit, std::mt19937 &rng)
 {
-    Cell turn = me;
+    std::vector<Pos> placed;
+    auto done = [&](int result)
     {
-        TempPlace3 t(&b, start, me);
-        if (checkWinFrom(b, start.x, start.y, me))
-            return +1;
-        turn = (me == Cell::O) ? Cell::X : Cell::O;
-    }
+        for (auto it = placed.rbegin(); it != placed.rend(); ++it)
+            b.set(it->x, it->y, Cell::Empty);
+        return result;
+    };
+    b.set(start.x, start.y, me);
+    placed.push_back(start);
+    if (checkWinFrom(b, start.x, start.y, me))
+        return done(+1);
+    Cell turn = (me == Cell::O) ? Cell::X : Cell::O;
     for (int d = 0; d < depthLimit; ++d)
     {
         auto cand = genCandidates(b);
@@ -497,15 +1162,380 @@ inline int playout(IBoard &b, Pos start, Cell me, int depthLimit, std::mt19937 &
             break;
         std::uniform_int_distribution<int> dist(0, (int)cand.size() - 1);
         Pos p = cand[dist(rng)];
-        TempPlace3 t(&b, p, turn);
+        b.set(p.x, p.y, turn);
+        placed.push_back(p);
         if (checkWinFrom(b, p.x, p.y, turn))
-            return (turn == me) ? +1 : -1;
+            return done((turn == me) ? +1 : -1);
         turn = (turn == Cell::O) ? Cell::X : Cell::O;
     }
-    return 0;
+    return done(0);
 }
-inline Pos ai_mcts(IBoard &b, Cell me, const MCTSParams &P = {})
+// Быстрый ГПСЧ для плейаутов (splitmix64): одно умножение-сдвиг вместо mt19937 + distribution
+struct FastRng
 {
+    uint64_t s;
+    explicit FastRng(uint64_t seed) : s(seed) {}
+    uint64_t next()
+    {
+        uint64_t z = (s += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    // равномерно в [0, n) без деления (Lemire)
+    uint32_t below(uint32_t n) { return static_cast<uint32_t>(((next() >> 32) * n) >> 32); }
+};
+
+// Движок плейаутов: локальная копия окна доски (плоский массив) и список кандидатов,
+// который обновляется инкрементально при установке/снятии камня.
+// После load() ни один вызов run() не выделяет память.
+class PlayoutEngine
+{
+public:
+    // Копирует занятые клетки b в окно, достаточное для плейаута глубины depthLimit
+    void load(const IBoard &b, int depthLimit)
+    {
+        depth = depthLimit;
+        Bounds bb = b.bounds();
+        if (bb.minx > bb.maxx)
+            bb = {0, 0, 0, 0};
+        // камни плейаута уходят от bbox не дальше 2*(depth+1), кандидаты — ещё на 2, дальше стена
+        int pad = 2 * (depth + 1) + 3;
+        ox = bb.minx - pad;
+        oy = bb.miny - pad;
+        W = bb.maxx - bb.minx + 1 + 2 * pad;
+        H = bb.maxy - bb.miny + 1 + 2 * pad;
+        size_t n = static_cast<size_t>(W) * H;
+        cell.assign(n, WALL);
+        near.assign(n, 0);
+        slot.assign(n, -1);
+        cand.clear();
+        cand.reserve(n);
+        trail.clear();
+        trail.reserve(depth + 1);
+        for (int y = 1; y < H - 1; ++y)
+            for (int x = 1; x < W - 1; ++x)
+                cell[y * W + x] = EMPTY;
+        stride[0] = 1;
+        stride[1] = W;
+        stride[2] = W + 1;
+        stride[3] = W - 1;
+        for (int y = bb.miny; y <= bb.maxy; ++y)
+            for (int x = bb.minx; x <= bb.maxx; ++x)
+            {
+                Cell c = b.get(x, y);
+                if (c != Cell::Empty)
+                    place(index(x, y), static_cast<uint8_t>(c));
+            }
+    }
+
+    // Один случайный плейаут с первым ходом start; окно возвращается в исходное состояние.
+    // +1 — выиграл me, -1 — соперник, 0 — лимит глубины.
+    int run(Pos start, Cell me, FastRng &rng)
+    {
+        trail.clear();
+        uint8_t turn = static_cast<uint8_t>(me);
+        int result = 0;
+        int idx = index(start.x, start.y);
+        place(idx, turn);
+        trail.push_back(idx);
+        if (wins(idx, turn))
+            result = +1;
+        else
+        {
+            turn ^= 3; // X <-> O
+            for (int d = 0; d < depth && !cand.empty(); ++d)
+            {
+                idx = cand[rng.below(static_cast<uint32_t>(cand.size()))];
+                place(idx, turn);
+                trail.push_back(idx);
+                if (wins(idx, turn))
+                {
+                    result = (turn == static_cast<uint8_t>(me)) ? +1 : -1;
+                    break;
+                }
+                turn ^= 3;
+            }
+        }
+        for (auto it = trail.rbegin(); it != trail.rend(); ++it)
+            unplace(*it);
+        return result;
+    }
+
+    bool contains(Pos p) const
+    {
+        int x = p.x - ox, y = p.y - oy;
+        return x > 0 && y > 0 && x < W - 1 && y < H - 1;
+    }
+    size_t candidateCount() const { return cand.size(); }
+    // номер клетки окна для таблиц по клеткам (RAVE в ai_mcts): 0..cellCount()-1, -1 вне окна
+    int cellOf(Pos p) const { return contains(p) ? index(p.x, p.y) : -1; }
+    size_t cellCount() const { return cell.size(); }
+    // клетки последнего run() по порядку, первая — start: ходы me стоят на чётных местах
+    const std::vector<int> &lastMoves() const { return trail; }
+
+private:
+    static constexpr uint8_t EMPTY = 0;
+    static constexpr uint8_t WALL = 3;
+    int W = 0, H = 0, ox = 0, oy = 0, depth = 0;
+    int stride[4]{};
+    std::vector<uint8_t> cell; // Cell или WALL
+    std::vector<uint8_t> near; // число камней в квадрате 5x5 вокруг клетки
+    std::vector<int> slot;     // позиция клетки в cand или -1
+    std::vector<int> cand;     // пустые клетки с соседом на расстоянии <= 2 (как genCandidates)
+    std::vector<int> trail;    // ходы текущего плейаута
+
+    int index(int x, int y) const { return (y - oy) * W + (x - ox); }
+
+    void addCand(int i)
+    {
+        slot[i] = static_cast<int>(cand.size());
+        cand.push_back(i);
+    }
+    void removeCand(int i)
+    {
+        int k = slot[i], last = cand.back();
+        cand[k] = last;
+        slot[last] = k;
+        cand.pop_back();
+        slot[i] = -1;
+    }
+    void place(int i, uint8_t c)
+    {
+        cell[i] = c;
+        if (slot[i] >= 0)
+            removeCand(i);
+        for (int dy = -2; dy <= 2; ++dy)
+            for (int dx = -2; dx <= 2; ++dx)
+            {
+                int j = i + dy * W + dx;
+                if (j != i && near[j]++ == 0 && cell[j] == EMPTY)
+                    addCand(j);
+            }
+    }
+    void unplace(int i)
+    {
+        for (int dy = -2; dy <= 2; ++dy)
+            for (int dx = -2; dx <= 2; ++dx)
+            {
+                int j = i + dy * W + dx;
+                if (j != i && --near[j] == 0 && slot[j] >= 0)
+                    removeCand(j);
+            }
+        cell[i] = EMPTY;
+        if (near[i] > 0)
+            addCand(i);
+    }
+    bool wins(int i, uint8_t c) const
+    {
+        for (int d = 0; d < 4; ++d)
+        {
+            int s = stride[d], cnt = 1;
+            for (int j = i + s; cell[j] == c; j += s)
+                ++cnt;
+            for (int j = i - s; cell[j] == c; j -= s)
+                ++cnt;
+            if (cnt >= CONNECT)
+                return true;
+        }
+        return false;
+    }
+};
+
+// Пакетные плейауты: LANES партий идут шаг в шаг, каждая на своей битовой доске
+// (строка окна = одно 64-битное слово). Проверка победы и подсчёт кандидатов идут
+// сразу по всем дорожкам через lanes::kernels() (AVX2/SSE2/скалярный — по CPU).
+// Окно по x ограничено 64 столбцами: клетки за его краем в плейауте недоступны.
+class BatchPlayoutEngine
+{
+public:
+    static constexpr int LANES = lanes::LANES;
+
+    // false — доска шире окна, нужно использовать PlayoutEngine
+    bool load(const IBoard &b, int depthLimit)
+    {
+        depth = depthLimit;
+        Bounds bb = b.bounds();
+        if (bb.minx > bb.maxx)
+            bb = {0, 0, 0, 0};
+        int bw = bb.maxx - bb.minx + 1, bh = bb.maxy - bb.miny + 1;
+        if (bw + 4 > 64)
+            return false;
+        int pad = 2 * (depth + 1) + 2;
+        ox = bb.minx - std::min(pad, (64 - bw) / 2);
+        oy = bb.miny - pad - GUARD;
+        R = bh + 2 * pad + 2 * GUARD;
+        size_t n = static_cast<size_t>(R) * LANES;
+        for (auto &v : base)
+            v.assign(R, 0);
+        for (auto &v : side)
+            v.assign(n, 0);
+        cand.assign(n, 0);
+        counts.assign(n, 0);
+        baseCand.assign(R, 0);
+        for (auto &t : trail)
+        {
+            t.clear();
+            t.reserve(depth + 1);
+        }
+        for (int y = bb.miny; y <= bb.maxy; ++y)
+            for (int x = bb.minx; x <= bb.maxx; ++x)
+            {
+                Cell c = b.get(x, y);
+                if (c != Cell::Empty)
+                    base[c == Cell::X ? 0 : 1][y - oy] |= 1ULL << (x - ox);
+            }
+        for (int r = GUARD; r < R - GUARD; ++r)
+        {
+            uint64_t dil = 0;
+            for (int k = -2; k <= 2; ++k)
+            {
+                uint64_t o = base[0][r + k] | base[1][r + k];
+                dil |= o | (o << 1) | (o << 2) | (o >> 1) | (o >> 2);
+            }
+            baseCand[r] = dil & ~(base[0][r] | base[1][r]);
+        }
+        baseTop = bb.miny - oy - 2;
+        return true;
+    }
+
+    bool contains(Pos p) const
+    {
+        int c = p.x - ox, r = p.y - oy;
+        return c >= 0 && c < 64 && r >= GUARD && r < R - GUARD;
+    }
+    // как у PlayoutEngine; lastMoves — по дорожке
+    int cellOf(Pos p) const { return contains(p) ? (p.y - oy) * 64 + (p.x - ox) : -1; }
+    size_t cellCount() const { return static_cast<size_t>(R) * 64; }
+    const std::vector<int> &lastMoves(int lane) const { return trail[lane]; }
+
+    // LANES плейаутов с первым ходом start; out[i] — +1/-1/0 как у PlayoutEngine::run
+    void run(Pos start, Cell me, FastRng &rng, int *out)
+    {
+        const auto &K = lanes::kernels();
+        for (int r = 0; r < R; ++r)
+            for (int l = 0; l < LANES; ++l)
+            {
+                side[0][r * LANES + l] = base[0][r];
+                side[1][r * LANES + l] = base[1][r];
+                cand[r * LANES + l] = baseCand[r];
+            }
+        K.popcount(cand.data(), 0, R, counts.data());
+        for (int l = 0; l < LANES; ++l)
+        {
+            total[l] = 0;
+            for (int r = 0; r < R; ++r)
+                total[l] += counts[r * LANES + l];
+            out[l] = 0;
+            top[l] = baseTop;
+            trail[l].clear();
+        }
+
+        int s = (me == Cell::X) ? 0 : 1;
+        int sr = start.y - oy, sc = start.x - ox;
+        for (int l = 0; l < LANES; ++l)
+            put(l, sr, sc, s);
+        refresh(K, sr - 2, sr + 3);
+        if (K.win4(side[s].data(), sr - 3, sr + 1))
+        {
+            for (int l = 0; l < LANES; ++l)
+                out[l] = +1;
+            return;
+        }
+
+        uint32_t active = (1u << LANES) - 1;
+        for (int d = 0; d < depth && active; ++d)
+        {
+            s ^= 1;
+            int lo = R, hi = -1;
+            for (int l = 0; l < LANES; ++l)
+            {
+                if (!(active & (1u << l)))
+                    continue;
+                if (total[l] == 0)
+                {
+                    active &= ~(1u << l);
+                    continue;
+                }
+                // k-й свободный кандидат дорожки l
+                int k = static_cast<int>(rng.below(static_cast<uint32_t>(total[l])));
+                int r = top[l];
+                while (k >= counts[r * LANES + l])
+                    k -= counts[r++ * LANES + l];
+                uint64_t w = cand[r * LANES + l];
+                for (; k > 0; --k)
+                    w &= w - 1;
+                put(l, r, lanes::ctz64(w), s);
+                lo = std::min(lo, r);
+                hi = std::max(hi, r);
+            }
+            if (hi < 0)
+                break;
+            refresh(K, lo - 2, hi + 3);
+            uint32_t won = K.win4(side[s].data(), lo - 3, hi + 1) & active;
+            for (int l = 0; l < LANES; ++l)
+                if (won & (1u << l))
+                    out[l] = (s == (me == Cell::X ? 0 : 1)) ? +1 : -1;
+            active &= ~won;
+        }
+    }
+
+private:
+    static constexpr int GUARD = 3; // пустые строки сверху/снизу для окна 4x4 проверки победы
+    int R = 0, ox = 0, oy = 0, depth = 0;
+    std::vector<uint64_t> base[2], baseCand;
+    std::vector<uint64_t> side[2], cand; // [строка * LANES + дорожка]
+    std::vector<uint8_t> counts;         // popcount(cand) по строкам
+    int total[LANES]{};
+    int top[LANES]{}; // выше этой строки кандидатов нет
+    int baseTop = 0;
+    std::vector<int> trail[LANES]; // ходы текущего плейаута дорожки, строка * 64 + столбец
+
+    void put(int l, int r, int c, int s)
+    {
+        top[l] = std::min(top[l], r - 2);
+        trail[l].push_back(r * 64 + c);
+        uint64_t bit = 1ULL << c;
+        uint64_t spread = bit | (bit << 1) | (bit << 2) | (bit >> 1) | (bit >> 2);
+        side[s][r * LANES + l] |= bit;
+        for (int rr = r - 2; rr <= r + 2; ++rr)
+        {
+            int i = rr * LANES + l;
+            cand[i] = (cand[i] | spread) & ~(side[0][i] | side[1][i]);
+        }
+    }
+    // обновить counts/total всех дорожек в строках [r0, r1)
+    void refresh(const lanes::Kernels &K, int r0, int r1)
+    {
+        for (int i = r0 * LANES; i < r1 * LANES; ++i)
+            total[i % LANES] -= counts[i];
+        K.popcount(cand.data(), r0, r1, counts.data());
+        for (int i = r0 * LANES; i < r1 * LANES; ++i)
+            total[i % LANES] += counts[i];
+    }
+};
+
+// Статистика кандидата корня для RAVE (см. MCTSParams): прямые плейауты и AMAF,
+// суммы результатов +1/0/-1
+struct RaveStat
+{
+    int n = 0, w = 0;   // плейауты, начатые с этого хода
+    int an = 0, aw = 0; // плейауты, где me сыграл в эту клетку на любом своём ходу
+    double value = 0;   // смешанная оценка
+    double invSqrtN = 0;
+
+    void rescore(double k)
+    {
+        double q = n ? double(w) / n : 0.0, qa = an ? double(aw) / an : 0.0;
+        double beta = std::sqrt(k / (3.0 * n + k));
+        value = (1.0 - beta) * q + beta * qa;
+    }
+};
+
+// progress (необязательно) получает число сыгранных плейаутов
+inline Pos ai_mcts(IBoard &b, Cell me, const MCTSParams &P = {}, metrics::SearchProgress *progress = nullptr)
+{
+    metrics::CallTimer timer("ai_mcts", 0, b.count()); // в nodes — число плейаутов
     Cell opp = (me == Cell::O) ? Cell::X : Cell::O;
 
     if (auto wins = immediateWinningMoves(b, me); !wins.empty())
@@ -520,14 +1550,103 @@ inline Pos ai_mcts(IBoard &b, Cell me, const MCTSParams &P = {})
         return cand.front();
     if (cand.empty())
         return {0, 0};
-    std::mt19937 rng(1337u);
+    static thread_local PlayoutEngine engine; // буферы переживают вызовы — без аллокаций после прогрева
+    static thread_local BatchPlayoutEngine batch;
+    bool batched = P.backend == PlayoutBackend::Batched && batch.load(b, P.playoutDepth);
+    if (!batched)
+        engine.load(b, P.playoutDepth);
+    FastRng rng(1337u);
+    if (P.rave)
+    {
+        TTT_TRACE_SCOPE("ai_mcts playouts");
+        static thread_local std::vector<int> slotOf; // клетка окна -> номер кандидата или -1
+        static thread_local std::vector<RaveStat> st;
+        slotOf.assign(batched ? batch.cellCount() : engine.cellCount(), -1);
+        st.assign(cand.size(), RaveStat{});
+        for (size_t i = 0; i < cand.size(); ++i) // кандидаты лежат в bbox±2, окно их всегда вмещает
+            slotOf[batched ? batch.cellOf(cand[i]) : engine.cellOf(cand[i])] = static_cast<int>(i);
+        const double k = std::max(1, P.raveK);
+        auto record = [&](size_t i, const std::vector<int> &moves, int result)
+        {
+            for (size_t j = 0; j < moves.size(); j += 2) // ходы me, включая первый
+                if (int c = slotOf[moves[j]]; c >= 0)
+                {
+                    ++st[c].an;
+                    st[c].aw += result;
+                    st[c].rescore(k);
+                }
+            RaveStat &s = st[i];
+            ++s.n;
+            s.w += result;
+            s.invSqrtN = 1.0 / std::sqrt(double(s.n));
+            s.rescore(k);
+        };
+        int total = std::max(P.iters, static_cast<int>(cand.size())), played = 0;
+        size_t fresh = 0; // кандидаты до fresh сыграны хотя бы раз
+        while (played < total)
+        {
+            size_t i = fresh;
+            if (fresh < cand.size())
+                ++fresh;
+            else
+            {
+                double c = P.explore * std::sqrt(std::log(double(played))), top = -1e9;
+                for (size_t j = 0; j < st.size(); ++j)
+                    if (double u = st[j].value + c * st[j].invSqrtN; u > top)
+                    {
+                        top = u;
+                        i = j;
+                    }
+            }
+            int n = 0;
+            if (batched)
+            {
+                int res[BatchPlayoutEngine::LANES];
+                batch.run(cand[i], me, rng, res);
+                for (; n < BatchPlayoutEngine::LANES && played + n < total; ++n)
+                    record(i, batch.lastMoves(n), res[n]);
+            }
+            else
+            {
+                int r = engine.run(cand[i], me, rng);
+                record(i, engine.lastMoves(), r);
+                n = 1;
+            }
+            played += n;
+            if (progress)
+                progress->add_nodes(static_cast<uint64_t>(n));
+        }
+        timer.nodes = static_cast<uint64_t>(played);
+        size_t best = 0;
+        for (size_t j = 1; j < st.size(); ++j)
+            if (st[j].value > st[best].value)
+                best = j;
+        return cand[best];
+    }
     int bestScore = -1e9;
     Pos best = cand.front();
     for (auto p : cand)
     {
+        TTT_TRACE_SCOPE("ai_mcts playouts");
         int score = 0, quota = std::max(1, P.iters / (int)cand.size());
-        for (int i = 0; i < quota; ++i)
-            score += playout(b, p, me, P.playoutDepth, rng);
+        if (batched) // кандидаты лежат в bbox±2, окно их всегда вмещает
+        {
+            int res[BatchPlayoutEngine::LANES];
+            for (int i = 0; i < quota; i += BatchPlayoutEngine::LANES)
+            {
+                batch.run(p, me, rng, res);
+                for (int l = 0; l < BatchPlayoutEngine::LANES && i + l < quota; ++l)
+                    score += res[l];
+            }
+        }
+        else
+        {
+            for (int i = 0; i < quota; ++i)
+                score += engine.run(p, me, rng);
+        }
+        if (progress)
+            progress->add_nodes(static_cast<uint64_t>(quota));
+        timer.nodes += static_cast<uint64_t>(quota);
         if (score > bestScore)
         {
             bestScore = score;
@@ -537,6 +1656,59 @@ inline Pos ai_mcts(IBoard &b, Cell me, const MCTSParams &P = {})
     return best;
 }
 
+// Пространственный индекс камней для отрисовки: плитки TILE x TILE клеток,
+// в каждой — её камни. Запрос по прямоугольнику обходит только пересечённые плитки.
+struct StoneIndex
+{
+    static constexpr int TILE = 16;
+    struct Stone
+    {
+        int x, y;
+        Cell c;
+    };
+    std::unordered_map<std::pair<int, int>, std::vector<Stone>, PairHash> tiles;
+    size_t count = 0;
+
+    static int tileOf(int v) { return v >= 0 ? v / TILE : -((-v + TILE - 1) / TILE); }
+
+    void add(int x, int y, Cell c)
+    {
+        tiles[{tileOf(x), tileOf(y)}].push_back({x, y, c});
+        ++count;
+    }
+    void clear()
+    {
+        tiles.clear();
+        count = 0;
+    }
+
+    size_t memoryBytes() const
+    {
+        size_t bytes = tiles.bucket_count() * sizeof(void *);
+        for (auto &t : tiles)
+            bytes += sizeof(t) + 2 * sizeof(void *) + t.second.capacity() * sizeof(Stone);
+        return bytes;
+    }
+
+    // fn(const Stone&) для каждого камня в [x0, x1] x [y0, y1]
+    template <class F>
+    void query(int x0, int y0, int x1, int y1, F &&fn) const
+    {
+        if (tiles.empty())
+            return;
+        for (int ty = tileOf(y0); ty <= tileOf(y1); ++ty)
+            for (int tx = tileOf(x0); tx <= tileOf(x1); ++tx)
+            {
+                auto it = tiles.find({tx, ty});
+                if (it == tiles.end())
+                    continue;
+                for (const Stone &s : it->second)
+                    if (s.x >= x0 && s.x <= x1 && s.y >= y0 && s.y <= y1)
+                        fn(s);
+            }
+    }
+};
+
 enum class Algo
 {
     Greedy = 1,
@@ -550,11 +1722,22 @@ struct Game
     Cell turn = Cell::X;
     Algo algo = Algo::Negamax;
     int depth = 3;
+    NegamaxPruning pruning;
+    NegamaxQuiescence quiescence;
+    NegamaxZone zone;
     MCTSParams mcts{1200, 12};
+    StoneIndex stones;     // сыгранные камни по плиткам — для отрисовки
+    uint64_t revision = 0; // растёт при каждом изменении позиции
+
+    grec::Writer log; // бинарный журнал партий, если открыт
 
     void reset()
     {
+        if (log.in_game())
+            log.end_game(grec::Unfinished);
         board = MapBoard{};
+        stones.clear();
+        ++revision;
         turn = Cell::X;
     }
     bool placeIfEmpty(int x, int y, Cell who)
@@ -562,8 +1745,22 @@ struct Game
         if (board.get(x, y) != Cell::Empty)
             return false;
         board.set(x, y, who);
+        stones.add(x, y, who);
+        ++revision;
+        if (log.is_open())
+        {
+            if (!log.in_game())
+                log.begin_game({1, static_cast<uint32_t>(algo), static_cast<uint32_t>(depth), static_cast<uint32_t>(mcts.iters), 0},
+                               static_cast<int>(who));
+            log.add_move(x, y);
+        }
         return true;
     }
+    void finish(Cell winner)
+    {
+        if (log.in_game())
+            log.end_game(winner == Cell::X ? grec::XWins : grec::OWins);
+    }
     inline bool justWonAt(int x, int y) const
     {
         Cell who = board.get(x, y);
@@ -0,0 +1,155 @@
+#include "GameRecord.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace grec
+{
+    bool Reader::open(const std::string &path)
+    {
+        close();
+#ifdef _WIN32
+        HANDLE fh = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fh == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(fh, &sz) || sz.QuadPart < (LONGLONG)HEADER_SIZE)
+        {
+            CloseHandle(fh);
+            return false;
+        }
+        HANDLE mh = CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void *view = mh ? MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!view)
+        {
+            if (mh)
+                CloseHandle(mh);
+            CloseHandle(fh);
+            return false;
+        }
+        file = fh;
+        mapping = mh;
+        base = static_cast<const std::uint8_t *>(view);
+        len = (std::size_t)sz.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)HEADER_SIZE)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *view = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED)
+            return false;
+        madvise(view, (std::size_t)st.st_size, MADV_SEQUENTIAL);
+        base = static_cast<const std::uint8_t *>(view);
+        len = (std::size_t)st.st_size;
+#endif
+        if (std::memcmp(base, MAGIC, 8) != 0)
+        {
+            close();
+            return false;
+        }
+        if (!read_index())
+            scan();
+        return true;
+    }
+
+    void Reader::close()
+    {
+        if (base)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(base);
+            CloseHandle(mapping);
+            CloseHandle(file);
+            mapping = file = nullptr;
+#else
+            munmap(const_cast<std::uint8_t *>(base), len);
+#endif
+        }
+        base = nullptr;
+        len = 0;
+        offsets.clear();
+    }
+
+    bool Reader::read_index()
+    {
+        if (len < HEADER_SIZE + TRAILER_SIZE)
+            return false;
+        const std::uint8_t *tr = base + len - TRAILER_SIZE;
+        std::uint64_t idx = get_u64(tr);
+        if (std::memcmp(tr + 8, END_MAGIC, 8) != 0 || idx < HEADER_SIZE || idx > len - TRAILER_SIZE - 4)
+            return false;
+        const std::uint8_t *p = base + idx, *end = tr;
+        if (std::memcmp(p, IDX_MAGIC, 4) != 0)
+            return false;
+        p += 4;
+        std::uint64_t n;
+        if (!get_varint(p, end, n) || n > (std::uint64_t)(end - p) / 8)
+            return false;
+        offsets.resize((std::size_t)n);
+        for (auto &o : offsets)
+        {
+            o = get_u64(p);
+            p += 8;
+        }
+        return true;
+    }
+
+    // no index (writer did not close): walk the length prefixes
+    void Reader::scan()
+    {
+        offsets.clear();
+        const std::uint8_t *end = base + len;
+        std::uint64_t off = HEADER_SIZE;
+        while (off < len)
+        {
+            if (len - off >= 4 && std::memcmp(base + off, IDX_MAGIC, 4) == 0)
+                break; // a cut-off index
+            const std::uint8_t *p = base + off;
+            std::uint64_t n;
+            if (!get_varint(p, end, n) || n > (std::uint64_t)(end - p))
+                break;
+            offsets.push_back(off);
+            off = (std::uint64_t)(p - base) + n;
+        }
+    }
+
+    bool Reader::parse(std::uint64_t off, GameView &g) const
+    {
+        if (off >= len)
+            return false;
+        const std::uint8_t *p = base + off, *end = base + len;
+        std::uint64_t n, v[8];
+        if (!get_varint(p, end, n) || n > (std::uint64_t)(end - p))
+            return false;
+        end = p + n;
+        for (auto &x : v)
+            if (!get_varint(p, end, x))
+                return false;
+        g.config.engine = (std::uint32_t)v[0];
+        g.config.mode = (std::uint32_t)v[1];
+        g.config.depth = (std::uint32_t)v[2];
+        g.config.iters = (std::uint32_t)v[3];
+        g.config.timeMs = (std::uint32_t)v[4];
+        g.first = (int)v[5];
+        g.result = (Result)v[6];
+        g.nmoves = (std::uint32_t)v[7];
+        g.data = p;
+        g.end = end;
+        return true;
+    }
+}
@@ -0,0 +1,345 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+// Compact binary game log.
+//
+//   file    := header game* [index trailer]
+//   header  := "TTT4GREC" u16 version u16 0 u32 0                      (16 bytes)
+//   game    := varint len, then len bytes:
+//                engine mode depth iters timeMs first result nmoves  (varints)
+//                nmoves x (zigzag dx, zigzag dy)                      (delta to previous move, first from 0,0)
+//   index   := "GIDX" varint count, count x u64 offset of each game
+//   trailer := u64 index offset, "TTT4GEND"                           (16 bytes)
+//
+// All fixed-width integers are little-endian. A file without trailer (writer killed
+// before close) is still readable; the reader rebuilds the index by scanning.
+namespace grec
+{
+    constexpr char MAGIC[8] = {'T', 'T', 'T', '4', 'G', 'R', 'E', 'C'};
+    constexpr char END_MAGIC[8] = {'T', 'T', 'T', '4', 'G', 'E', 'N', 'D'};
+    constexpr char IDX_MAGIC[4] = {'G', 'I', 'D', 'X'};
+    constexpr std::uint16_t VERSION = 1;
+    constexpr std::size_t HEADER_SIZE = 16;
+    constexpr std::size_t TRAILER_SIZE = 16;
+
+    enum Result : std::uint8_t
+    {
+        Unfinished = 0,
+        XWins = 1,
+        OWins = 2,
+        Draw = 3
+    };
+
+    // engine that produced the game: 0 — AI (Board/AI.cpp), 1 — Game.hpp
+    struct EngineConfig
+    {
+        std::uint32_t engine{0};
+        std::uint32_t mode{0};
+        std::uint32_t depth{0};
+        std::uint32_t iters{0};
+        std::uint32_t timeMs{0};
+    };
+
+    inline std::uint64_t zigzag(std::int64_t v) { return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63); }
+    inline std::int64_t unzigzag(std::uint64_t v) { return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1); }
+
+    inline void put_varint(std::vector<std::uint8_t> &out, std::uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back(static_cast<std::uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(v));
+    }
+    // returns false on truncated input
+    inline bool get_varint(const std::uint8_t *&p, const std::uint8_t *end, std::uint64_t &v)
+    {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7)
+        {
+            std::uint8_t b = *p++;
+            v |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return true;
+        }
+        return false;
+    }
+    inline void put_u64(std::vector<std::uint8_t> &out, std::uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+    }
+    inline std::uint64_t get_u64(const std::uint8_t *p)
+    {
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i)
+            v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+        return v;
+    }
+
+    // Streaming writer: moves are encoded as they arrive, each finished game is
+    // appended and flushed, the index is written on close(). Opening an existing
+    // log appends to it.
+    class Writer
+    {
+    public:
+        Writer() = default;
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+        ~Writer() { close(); }
+
+        bool open(const std::string &path)
+        {
+            close();
+            offsets.clear();
+            std::error_code ec;
+            std::uint64_t size = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+            if (size > 0)
+            {
+                // never clobber a file that is not a game log
+                if (!load_existing(path, size))
+                    return false;
+                // cut the old index (or a torn tail) now: a crash before close() must not
+                // leave it between the games appended from here on
+                if (end < size)
+                {
+                    std::filesystem::resize_file(path, end, ec);
+                    if (ec)
+                        return false;
+                }
+                f = std::fopen(path.c_str(), "r+b");
+            }
+            else
+            {
+                f = std::fopen(path.c_str(), "wb");
+                if (f)
+                {
+                    std::uint8_t hdr[HEADER_SIZE] = {};
+                    std::memcpy(hdr, MAGIC, 8);
+                    hdr[8] = static_cast<std::uint8_t>(VERSION);
+                    hdr[9] = static_cast<std::uint8_t>(VERSION >> 8);
+                    std::fwrite(hdr, 1, HEADER_SIZE, f);
+                    end = HEADER_SIZE;
+                }
+            }
+            if (!f)
+                return false;
+            this->path = path;
+            return true;
+        }
+        bool is_open() const { return f != nullptr; }
+        bool in_game() const { return inGame; }
+
+        void begin_game(const EngineConfig &cfg, int first)
+        {
+            config = cfg;
+            firstPlayer = first;
+            moves.clear();
+            nmoves = 0;
+            px = py = 0;
+            inGame = true;
+        }
+        void add_move(int x, int y)
+        {
+            if (!inGame)
+                return;
+            put_varint(moves, zigzag(static_cast<std::int64_t>(x) - px));
+            put_varint(moves, zigzag(static_cast<std::int64_t>(y) - py));
+            px = x;
+            py = y;
+            ++nmoves;
+        }
+        void end_game(Result result)
+        {
+            if (!inGame || !f)
+                return;
+            inGame = false;
+            body.clear();
+            put_varint(body, config.engine);
+            put_varint(body, config.mode);
+            put_varint(body, config.depth);
+            put_varint(body, config.iters);
+            put_varint(body, config.timeMs);
+            put_varint(body, static_cast<std::uint64_t>(firstPlayer));
+            put_varint(body, result);
+            put_varint(body, nmoves);
+            body.insert(body.end(), moves.begin(), moves.end());
+            rec.clear();
+            put_varint(rec, body.size());
+            rec.insert(rec.end(), body.begin(), body.end());
+            seek(end);
+            std::fwrite(rec.data(), 1, rec.size(), f);
+            std::fflush(f);
+            offsets.push_back(end);
+            end += rec.size();
+        }
+        void close()
+        {
+            if (!f)
+                return;
+            if (inGame)
+                end_game(Unfinished);
+            rec.clear();
+            rec.insert(rec.end(), IDX_MAGIC, IDX_MAGIC + 4);
+            put_varint(rec, offsets.size());
+            for (auto o : offsets)
+                put_u64(rec, o);
+            put_u64(rec, end);
+            rec.insert(rec.end(), END_MAGIC, END_MAGIC + 8);
+            seek(end);
+            std::fwrite(rec.data(), 1, rec.size(), f);
+            std::fclose(f);
+            f = nullptr;
+            // drop a longer stale index left by a previous session
+            std::error_code ec;
+            std::filesystem::resize_file(path, end + rec.size(), ec);
+        }
+
+    private:
+        std::FILE *f = nullptr;
+        std::string path;
+        std::uint64_t end = 0; // where the next game goes (= index offset on close)
+        std::vector<std::uint64_t> offsets;
+        std::vector<std::uint8_t> moves, body, rec;
+        EngineConfig config;
+        int firstPlayer = 1;
+        std::uint32_t nmoves = 0;
+        std::int64_t px = 0, py = 0;
+        bool inGame = false;
+
+        void seek(std::uint64_t pos)
+        {
+#ifdef _WIN32
+            _fseeki64(f, static_cast<long long>(pos), SEEK_SET);
+#else
+            fseeko(f, static_cast<off_t>(pos), SEEK_SET);
+#endif
+        }
+        // offsets of the games already in the file: from the index, or by scanning
+        bool load_existing(const std::string &p, std::uint64_t size)
+        {
+            std::FILE *in = std::fopen(p.c_str(), "rb");
+            if (!in)
+                return false;
+            std::uint8_t hdr[HEADER_SIZE];
+            bool ok = size >= HEADER_SIZE && std::fread(hdr, 1, HEADER_SIZE, in) == HEADER_SIZE && std::memcmp(hdr, MAGIC, 8) == 0;
+            end = HEADER_SIZE;
+            if (ok && size >= HEADER_SIZE + TRAILER_SIZE)
+            {
+                std::uint8_t tr[TRAILER_SIZE];
+                read_at(in, size - TRAILER_SIZE, tr, TRAILER_SIZE);
+                std::uint64_t idx = get_u64(tr);
+                if (std::memcmp(tr + 8, END_MAGIC, 8) == 0 && idx >= HEADER_SIZE && idx <= size - TRAILER_SIZE)
+                {
+                    std::vector<std::uint8_t> buf(static_cast<std::size_t>(size - TRAILER_SIZE - idx));
+                    read_at(in, idx, buf.data(), buf.size());
+                    const std::uint8_t *q = buf.data() + 4, *e = buf.data() + buf.size();
+                    std::uint64_t n;
+                    if (buf.size() >= 4 && std::memcmp(buf.data(), IDX_MAGIC, 4) == 0 && get_varint(q, e, n) && n <= static_cast<std::uint64_t>(e - q) / 8)
+                    {
+                        for (std::uint64_t i = 0; i < n; ++i, q += 8)
+                            offsets.push_back(get_u64(q));
+                        end = idx;
+                        std::fclose(in);
+                        return true;
+                    }
+                }
+            }
+            // no index: walk the length prefixes, stop at the first incomplete record
+            while (ok)
+            {
+                std::uint8_t lb[10];
+                std::size_t got = read_at(in, end, lb, sizeof lb);
+                if (got >= 4 && std::memcmp(lb, IDX_MAGIC, 4) == 0)
+                    break; // a cut-off index
+                const std::uint8_t *q = lb;
+                std::uint64_t n;
+                if (!get_varint(q, lb + got, n) || n > size - end - (q - lb))
+                    break;
+                offsets.push_back(end);
+                end += (q - lb) + n;
+            }
+            std::fclose(in);
+            return ok;
+        }
+        static std::size_t read_at(std::FILE *in, std::uint64_t pos, std::uint8_t *buf, std::size_t n)
+        {
+#ifdef _WIN32
+            _fseeki64(in, static_cast<long long>(pos), SEEK_SET);
+#else
+            fseeko(in, static_cast<off_t>(pos), SEEK_SET);
+#endif
+            return std::fread(buf, 1, n, in);
+        }
+    };
+
+    // One game inside a mapped log; moves decode lazily from the mapped bytes.
+    struct GameView
+    {
+        EngineConfig config;
+        int first{1};
+        Result result{Unfinished};
+        std::uint32_t nmoves{0};
+        const std::uint8_t *data{nullptr}; // encoded moves
+        const std::uint8_t *end{nullptr};
+
+        struct Cursor
+        {
+            const std::uint8_t *p, *end;
+            std::int64_t x{0}, y{0};
+            bool next(int &ox, int &oy)
+            {
+                std::uint64_t dx, dy;
+                if (!get_varint(p, end, dx) || !get_varint(p, end, dy))
+                    return false;
+                x += unzigzag(dx);
+                y += unzigzag(dy);
+                ox = static_cast<int>(x);
+                oy = static_cast<int>(y);
+                return true;
+            }
+        };
+        Cursor moves() const { return Cursor{data, end}; }
+    };
+
+    // Zero-copy reader over a memory-mapped log.
+    class Reader
+    {
+    public:
+        Reader() = default;
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+        ~Reader() { close(); }
+
+        bool open(const std::string &path);
+        void close();
+        std::size_t size() const { return offsets.size(); }
+        bool game(std::size_t i, GameView &out) const { return i < offsets.size() && parse(offsets[i], out); }
+
+        template <class F>
+        void for_each(F &&f) const
+        {
+            GameView g;
+            for (std::size_t i = 0; i < offsets.size(); ++i)
+                if (parse(offsets[i], g))
+                    f(g);
+        }
+
+    private:
+        const std::uint8_t *base = nullptr;
+        std::size_t len = 0;
+        std::vector<std::uint64_t> offsets;
+#ifdef _WIN32
+        void *file = nullptr, *mapping = nullptr;
+#endif
+        bool parse(std::uint64_t off, GameView &out) const;
+        bool read_index();
+        void scan();
+    };
+}
@@ -0,0 +1,246 @@
+#include "Host.hpp"
+#include "Notation.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <future>
+
+namespace
+{
+    constexpr int MIN_BUDGET_MS = 2; // a late request still gets a short search
+    constexpr std::size_t MIN_TT_ENTRIES = 1024;
+
+    int ms_between(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b)
+    {
+        return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(b - a).count());
+    }
+}
+
+GameHost::GameHost(const HostLimits &limits) : lim(limits)
+{
+    int n = lim.threads > 0 ? lim.threads : static_cast<int>(std::thread::hardware_concurrency());
+    n = std::max(1, n);
+    for (int i = 0; i < n; ++i)
+        workers.emplace_back([this]
+                             {
+            trace::set_thread_name("host worker");
+            work(); });
+}
+
+GameHost::~GameHost()
+{
+    {
+        std::lock_guard<std::mutex> lk(mx);
+        stopping = true; // also the stop flag of every session's AI
+    }
+    cv.notify_all();
+    for (auto &t : workers)
+        t.join();
+    while (!queue.empty())
+    {
+        Request r = queue.top();
+        queue.pop();
+        MoveResult res;
+        res.session = r.s->id;
+        if (r.done)
+            r.done(res);
+    }
+}
+
+std::shared_ptr<GameHost::Session> GameHost::find(SessionId id) const
+{
+    auto it = sessions.find(id);
+    return it == sessions.end() ? nullptr : it->second;
+}
+
+std::size_t GameHost::tt_share() const
+{
+    std::size_t perSession = lim.ttBytes / sizeof(TTEntry) / std::max<std::size_t>(1, sessions.size());
+    return std::max(MIN_TT_ENTRIES, perSession);
+}
+
+GameHost::SessionId GameHost::open(const SessionConfig &cfg)
+{
+    auto s = std::make_shared<Session>();
+    s->cfg = cfg;
+    s->ai.set_mode(cfg.mode);
+    s->ai.set_depth(cfg.depth);
+    s->ai.set_time_budget(cfg.latencyMs);
+    s->ai.set_stop_flag(&stopping);
+    s->ai.set_pattern_eval(cfg.eval);
+    std::lock_guard<std::mutex> lk(mx);
+    if (sessions.size() >= lim.maxSessions)
+        return 0;
+    while (nextId == 0 || sessions.count(nextId))
+        ++nextId;
+    s->id = nextId++;
+    sessions.emplace(s->id, s);
+    return s->id;
+}
+
+bool GameHost::close(SessionId id)
+{
+    std::lock_guard<std::mutex> lk(mx);
+    auto it = sessions.find(id);
+    if (it == sessions.end())
+        return false;
+    it->second->closed = true; // a worker holding it reports ok == false
+    sessions.erase(it);
+    return true;
+}
+
+bool GameHost::play(SessionId id, Move m)
+{
+    std::lock_guard<std::mutex> lk(mx);
+    auto s = find(id);
+    if (!s || s->busy || s->won != Cell::Empty)
+        return false;
+    Cell who = s->record.size() % 2 == 0 ? Cell::X : Cell::O;
+    if (!s->game.place(m.x, m.y, who))
+        return false;
+    s->record.push_back(m);
+    if (s->game.is_win_from(m.x, m.y, who, 4))
+        s->won = who;
+    return true;
+}
+
+bool GameHost::reset(SessionId id)
+{
+    std::lock_guard<std::mutex> lk(mx);
+    auto s = find(id);
+    if (!s || s->busy)
+        return false;
+    s->game = Board();
+    s->record.clear();
+    s->won = Cell::Empty;
+    s->ai.clear_tt();
+    return true;
+}
+
+Cell GameHost::winner(SessionId id) const
+{
+    std::lock_guard<std::mutex> lk(mx);
+    auto s = find(id);
+    return s ? s->won : Cell::Empty;
+}
+
+std::vector<Move> GameHost::moves(SessionId id) const
+{
+    std::lock_guard<std::mutex> lk(mx);
+    auto s = find(id);
+    return s ? s->record : std::vector<Move>{};
+}
+
+bool GameHost::request_move(SessionId id, Callback done)
+{
+    {
+        std::lock_guard<std::mutex> lk(mx);
+        auto s = find(id);
+        if (!s || s->busy || s->won != Cell::Empty || stopping)
+            return false;
+        s->busy = true;
+        Request r;
+        r.submitted = clock::now();
+        r.deadline = r.submitted + std::chrono::milliseconds(s->cfg.latencyMs);
+        r.seq = seq++;
+        r.s = std::move(s);
+        r.done = std::move(done);
+        queue.push(std::move(r));
+    }
+    cv.notify_one();
+    return true;
+}
+
+MoveResult GameHost::think(SessionId id)
+{
+    auto p = std::make_shared<std::promise<MoveResult>>();
+    auto f = p->get_future();
+    if (!request_move(id, [p](const MoveResult &r)
+                      { p->set_value(r); }))
+    {
+        MoveResult r;
+        r.session = id;
+        return r;
+    }
+    return f.get();
+}
+
+HostStats GameHost::stats() const
+{
+    std::lock_guard<std::mutex> lk(mx);
+    HostStats st;
+    st.sessions = sessions.size();
+    st.queued = queue.size();
+    st.running = running;
+    st.completed = completed;
+    st.late = late;
+    st.ttEntriesPerSession = tt_share();
+    st.p50Ms = latency.percentile(0.50f);
+    st.p99Ms = latency.percentile(0.99f);
+    st.maxMs = latency.max();
+    return st;
+}
+
+void GameHost::work()
+{
+    Board board;
+    while (true)
+    {
+        Request r;
+        std::size_t share;
+        bool closed;
+        {
+            std::unique_lock<std::mutex> lk(mx);
+            cv.wait(lk, [&]
+                    { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            r = queue.top();
+            queue.pop();
+            ++running;
+            share = std::min(r.s->cfg.ttEntries, tt_share());
+            closed = r.s->closed;
+        }
+        Session &s = *r.s;
+        MoveResult res;
+        res.session = s.id;
+        auto start = clock::now();
+        res.queuedMs = ms_between(r.submitted, start);
+        if (!closed)
+        {
+            // the session is busy: nobody else touches its AI or record until we clear the flag
+            if (s.ttApplied != share)
+            {
+                s.ai.set_tt_entries(share);
+                s.ttApplied = share;
+            }
+            // a tenth of what is left covers the overshoot of the last iteration and the reply
+            s.ai.set_time_budget(std::max(MIN_BUDGET_MS, ms_between(start, r.deadline) * 9 / 10));
+            int depth = s.cfg.mode == AI::ID_DEEPEN ? 0 : s.cfg.depth;
+            s.ai.set_info_callback([&depth](const SearchInfo &i)
+                                   { depth = i.depth; });
+            load_game(board, s.record);
+            res.move = s.ai.choose_move(board);
+            s.ai.set_info_callback(nullptr);
+            res.depth = depth;
+            res.nodes = s.ai.nodes();
+            res.ok = !stopping;
+        }
+        auto end = clock::now();
+        res.searchMs = ms_between(start, end);
+        res.late = ms_between(r.submitted, end) > s.cfg.latencyMs;
+        {
+            std::lock_guard<std::mutex> lk(mx);
+            --running;
+            s.busy = false;
+            res.ok = res.ok && !s.closed;
+            if (res.ok)
+            {
+                ++completed;
+                late += res.late;
+                latency.add(static_cast<float>(res.queuedMs + res.searchMs));
+            }
+        }
+        if (r.done)
+            r.done(res);
+    }
+}
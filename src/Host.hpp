@@ -0,0 +1,137 @@
+#pragma once
+#include "Board.hpp"
+#include "AI.hpp"
+#include "Metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// In-process host for many concurrent games sharing one pool of search threads.
+//
+// A session is a game record plus its engine settings and its own AI (and so its own
+// TT). Move requests go to a queue served earliest-deadline-first by a fixed number of
+// workers; a request's deadline is its submission time plus the session's latency
+// target, and iterative deepening gets whatever is left of it when a worker picks the
+// request up. TT memory is one budget split evenly: each session gets the smaller of its
+// requested entries and budget / open sessions, applied at its next request.
+//
+// All methods are thread-safe. Callbacks run on a worker thread after the session is
+// free again, so they may call play() and request_move() for the same session.
+
+struct HostLimits
+{
+    int threads = 0;                              // 0: one per hardware thread
+    std::size_t ttBytes = std::size_t(256) << 20; // shared by all sessions' TTs
+    std::size_t maxSessions = 4096;
+};
+
+struct SessionConfig
+{
+    AI::Mode mode = AI::ID_DEEPEN;
+    int depth = 6;
+    int latencyMs = 200;                          // request to reply; bounds the ID time budget
+    std::size_t ttEntries = std::size_t(1) << 16; // wanted; the fair share may be smaller
+    const pattern_eval::Weights *eval = nullptr;  // nullptr: Board::evaluate
+};
+
+struct MoveResult
+{
+    std::uint32_t session{};
+    bool ok{false}; // false when the host shut down or the session closed first
+    Move move{};
+    int depth{}; // last completed iteration (ID) or the fixed depth
+    long long nodes{};
+    int queuedMs{}, searchMs{};
+    bool late{false}; // queuedMs + searchMs over the session's latency target
+};
+
+struct HostStats
+{
+    std::size_t sessions{}, queued{}, running{};
+    std::uint64_t completed{}, late{};
+    std::size_t ttEntriesPerSession{};
+    float p50Ms{}, p99Ms{}, maxMs{}; // request-to-reply latency over the last 4096 replies
+};
+
+class GameHost
+{
+public:
+    using SessionId = std::uint32_t;
+    using Callback = std::function<void(const MoveResult &)>;
+
+    explicit GameHost(const HostLimits &limits = {});
+    ~GameHost(); // running searches are stopped, queued requests get ok == false
+    GameHost(const GameHost &) = delete;
+    GameHost &operator=(const GameHost &) = delete;
+
+    // 0 when maxSessions are open
+    SessionId open(const SessionConfig &cfg = {});
+    // a request in flight still gets its callback, with ok == false
+    bool close(SessionId id);
+
+    // append a move for the side to move (X first); false if unknown, busy, occupied or over
+    bool play(SessionId id, Move m);
+    bool reset(SessionId id);
+    // X or O once a move completed four, Cell::Empty while the game goes on
+    Cell winner(SessionId id) const;
+    std::vector<Move> moves(SessionId id) const;
+
+    // queue a search for the side to move; false if unknown, busy or finished
+    bool request_move(SessionId id, Callback done);
+    // request_move and wait for the reply
+    MoveResult think(SessionId id);
+
+    HostStats stats() const;
+    int threads() const { return static_cast<int>(workers.size()); }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Session
+    {
+        SessionId id{};
+        SessionConfig cfg;
+        AI ai;
+        Board game; // absolute colours, X first
+        std::vector<Move> record;
+        Cell won{Cell::Empty};
+        std::size_t ttApplied{0};
+        bool busy{false}, closed{false};
+    };
+    struct Request
+    {
+        clock::time_point submitted, deadline;
+        std::uint64_t seq;
+        std::shared_ptr<Session> s;
+        Callback done;
+        bool operator<(const Request &o) const // priority_queue top = earliest deadline
+        {
+            return deadline != o.deadline ? deadline > o.deadline : seq > o.seq;
+        }
+    };
+
+    HostLimits lim;
+    mutable std::mutex mx;
+    std::condition_variable cv;
+    std::unordered_map<SessionId, std::shared_ptr<Session>> sessions;
+    std::priority_queue<Request> queue;
+    std::vector<std::thread> workers;
+    std::atomic<bool> stopping{false};
+    SessionId nextId{1};
+    std::uint64_t seq{0};
+    std::size_t running{0};
+    std::uint64_t completed{0}, late{0};
+    metrics::Series latency{4096};
+
+    std::shared_ptr<Session> find(SessionId id) const; // caller holds mx
+    std::size_t tt_share() const;                      // caller holds mx
+    void work();
+};
@@ -0,0 +1,199 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TTT_LANES_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TTT_TARGET_AVX2
+#else
+#define TTT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Lane-parallel bitboard kernels for batched playouts.
+// A batch is LANES independent boards; each board row is one 64-bit word (bit = column).
+// Rows are interleaved by lane: rows[r * LANES + lane].
+namespace lanes
+{
+    constexpr int LANES = 8;
+
+    inline int popcnt64(std::uint64_t v)
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        v = v - ((v >> 1) & 0x5555555555555555ULL);
+        v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+        v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return static_cast<int>((v * 0x0101010101010101ULL) >> 56);
+#else
+        return __builtin_popcountll(v);
+#endif
+    }
+
+    inline int ctz64(std::uint64_t v)
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long i;
+        _BitScanForward64(&i, v);
+        return static_cast<int>(i);
+#else
+        return __builtin_ctzll(v);
+#endif
+    }
+
+    // bitmask of lanes with 4 in a row starting in rows [r0, r1); rows r1..r1+2 must be readable
+    using WinFn = std::uint32_t (*)(const std::uint64_t *rows, int r0, int r1);
+    // counts[r * LANES + lane] = popcount of rows[r * LANES + lane] for r in [r0, r1)
+    using PopFn = void (*)(const std::uint64_t *rows, int r0, int r1, std::uint8_t *counts);
+
+    struct Kernels
+    {
+        WinFn win4;
+        PopFn popcount;
+        const char *name;
+    };
+
+    // ---- scalar ----
+    inline std::uint32_t win4_scalar(const std::uint64_t *rows, int r0, int r1)
+    {
+        std::uint32_t mask = 0;
+        for (int r = r0; r < r1; ++r)
+            for (int l = 0; l < LANES; ++l)
+            {
+                std::uint64_t a = rows[r * LANES + l];
+                std::uint64_t b = rows[(r + 1) * LANES + l];
+                std::uint64_t c = rows[(r + 2) * LANES + l];
+                std::uint64_t d = rows[(r + 3) * LANES + l];
+                std::uint64_t hit = (a & (a >> 1) & (a >> 2) & (a >> 3)) |
+                                    (a & b & c & d) |
+                                    (a & (b >> 1) & (c >> 2) & (d >> 3)) |
+                                    (a & (b << 1) & (c << 2) & (d << 3));
+                if (hit)
+                    mask |= 1u << l;
+            }
+        return mask;
+    }
+
+    inline void popcount_scalar(const std::uint64_t *rows, int r0, int r1, std::uint8_t *counts)
+    {
+        for (int i = r0 * LANES; i < r1 * LANES; ++i)
+            counts[i] = static_cast<std::uint8_t>(popcnt64(rows[i]));
+    }
+
+#ifdef TTT_LANES_X86
+    // ---- SSE2 (2 lanes per register) ----
+    inline std::uint32_t win4_sse2(const std::uint64_t *rows, int r0, int r1)
+    {
+        __m128i acc[LANES / 2];
+        for (auto &v : acc)
+            v = _mm_setzero_si128();
+        for (int r = r0; r < r1; ++r)
+            for (int k = 0; k < LANES / 2; ++k)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows + r * LANES + 2 * k));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows + (r + 1) * LANES + 2 * k));
+                __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows + (r + 2) * LANES + 2 * k));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows + (r + 3) * LANES + 2 * k));
+                __m128i h = _mm_and_si128(_mm_and_si128(a, _mm_srli_epi64(a, 1)), _mm_and_si128(_mm_srli_epi64(a, 2), _mm_srli_epi64(a, 3)));
+                __m128i v = _mm_and_si128(_mm_and_si128(a, b), _mm_and_si128(c, d));
+                __m128i d1 = _mm_and_si128(_mm_and_si128(a, _mm_srli_epi64(b, 1)), _mm_and_si128(_mm_srli_epi64(c, 2), _mm_srli_epi64(d, 3)));
+                __m128i d2 = _mm_and_si128(_mm_and_si128(a, _mm_slli_epi64(b, 1)), _mm_and_si128(_mm_slli_epi64(c, 2), _mm_slli_epi64(d, 3)));
+                acc[k] = _mm_or_si128(acc[k], _mm_or_si128(_mm_or_si128(h, v), _mm_or_si128(d1, d2)));
+            }
+        std::uint32_t mask = 0;
+        for (int k = 0; k < LANES / 2; ++k)
+        {
+            alignas(16) std::uint64_t out[2];
+            _mm_store_si128(reinterpret_cast<__m128i *>(out), acc[k]);
+            mask |= (out[0] ? 1u : 0u) << (2 * k);
+            mask |= (out[1] ? 1u : 0u) << (2 * k + 1);
+        }
+        return mask;
+    }
+
+    // ---- AVX2 (4 lanes per register, nibble-LUT popcount) ----
+    TTT_TARGET_AVX2 inline std::uint32_t win4_avx2(const std::uint64_t *rows, int r0, int r1)
+    {
+        __m256i acc[LANES / 4];
+        for (auto &v : acc)
+            v = _mm256_setzero_si256();
+        for (int r = r0; r < r1; ++r)
+            for (int k = 0; k < LANES / 4; ++k)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows + r * LANES + 4 * k));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows + (r + 1) * LANES + 4 * k));
+                __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows + (r + 2) * LANES + 4 * k));
+                __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows + (r + 3) * LANES + 4 * k));
+                __m256i h = _mm256_and_si256(_mm256_and_si256(a, _mm256_srli_epi64(a, 1)), _mm256_and_si256(_mm256_srli_epi64(a, 2), _mm256_srli_epi64(a, 3)));
+                __m256i v = _mm256_and_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, d));
+                __m256i d1 = _mm256_and_si256(_mm256_and_si256(a, _mm256_srli_epi64(b, 1)), _mm256_and_si256(_mm256_srli_epi64(c, 2), _mm256_srli_epi64(d, 3)));
+                __m256i d2 = _mm256_and_si256(_mm256_and_si256(a, _mm256_slli_epi64(b, 1)), _mm256_and_si256(_mm256_slli_epi64(c, 2), _mm256_slli_epi64(d, 3)));
+                acc[k] = _mm256_or_si256(acc[k], _mm256_or_si256(_mm256_or_si256(h, v), _mm256_or_si256(d1, d2)));
+            }
+        std::uint32_t mask = 0;
+        for (int k = 0; k < LANES / 4; ++k)
+        {
+            // lanes with a non-zero 64-bit word
+            __m256i nz = _mm256_cmpeq_epi64(acc[k], _mm256_setzero_si256());
+            std::uint32_t zero = static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(nz)));
+            mask |= (~zero & 0xFu) << (4 * k);
+        }
+        return mask;
+    }
+
+    TTT_TARGET_AVX2 inline void popcount_avx2(const std::uint64_t *rows, int r0, int r1, std::uint8_t *counts)
+    {
+        const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low = _mm256_set1_epi8(0x0F);
+        for (int r = r0; r < r1; ++r)
+            for (int k = 0; k < LANES / 4; ++k)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows + r * LANES + 4 * k));
+                __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low));
+                __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+                __m256i sum = _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+                alignas(32) std::uint64_t out[4];
+                _mm256_store_si256(reinterpret_cast<__m256i *>(out), sum);
+                for (int j = 0; j < 4; ++j)
+                    counts[r * LANES + 4 * k + j] = static_cast<std::uint8_t>(out[j]);
+            }
+    }
+
+    inline bool cpu_has_avx2()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    // selected once per process by CPU feature detection
+    inline const Kernels &kernels()
+    {
+        static const Kernels k = []
+        {
+#ifdef TTT_LANES_X86
+            if (cpu_has_avx2())
+                return Kernels{win4_avx2, popcount_avx2, "avx2"};
+            return Kernels{win4_sse2, popcount_scalar, "sse2"};
+#else
+            return Kernels{win4_scalar, popcount_scalar, "scalar"};
+#endif
+        }();
+        return k;
+    }
+}
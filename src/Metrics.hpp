@@ -0,0 +1,409 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Small counters for profiling overlays and tools. Series and FrameCounters belong to one
+// thread; SearchProgress is written by a search thread and read from another, lock-free.
+// Histogram and Registry collect the latency of every engine call for the whole process
+// (exported by MetricsExport.hpp). Nothing here allocates per sample.
+namespace metrics
+{
+    using clock = std::chrono::steady_clock;
+
+    // sub-millisecond timer for sections of a frame
+    struct Stopwatch
+    {
+        clock::time_point t0 = clock::now();
+        void restart() { t0 = clock::now(); }
+        float ms() const { return std::chrono::duration<float, std::milli>(clock::now() - t0).count(); }
+    };
+
+    // the last `capacity` samples (e.g. frame times in ms)
+    class Series
+    {
+    public:
+        explicit Series(std::size_t capacity = 240) : buf(capacity, 0.f), scratch(capacity) {}
+
+        void add(float v)
+        {
+            buf[head] = v;
+            head = (head + 1) % buf.size();
+            if (n < buf.size())
+                ++n;
+        }
+        std::size_t size() const { return n; }
+        std::size_t capacity() const { return buf.size(); }
+        // i-th sample, oldest first
+        float at(std::size_t i) const { return buf[(head + buf.size() - n + i) % buf.size()]; }
+        float last() const { return n ? at(n - 1) : 0.f; }
+        float max() const
+        {
+            float m = 0.f;
+            for (std::size_t i = 0; i < n; ++i)
+                m = std::max(m, at(i));
+            return m;
+        }
+        float mean() const
+        {
+            float s = 0.f;
+            for (std::size_t i = 0; i < n; ++i)
+                s += at(i);
+            return n ? s / n : 0.f;
+        }
+        // nearest-rank percentile over the window, p in [0, 1]
+        float percentile(float p) const
+        {
+            if (n == 0)
+                return 0.f;
+            for (std::size_t i = 0; i < n; ++i)
+                scratch[i] = at(i);
+            std::size_t k = std::min(n - 1, static_cast<std::size_t>(p * n));
+            std::nth_element(scratch.begin(), scratch.begin() + k, scratch.begin() + n);
+            return scratch[k];
+        }
+
+    private:
+        std::vector<float> buf;
+        mutable std::vector<float> scratch;
+        std::size_t head = 0, n = 0;
+    };
+
+    // what one frame submitted to the GPU
+    struct FrameCounters
+    {
+        std::uint32_t drawCalls = 0;
+        std::uint64_t vertices = 0;
+        void reset() { *this = FrameCounters{}; }
+        void draw(std::size_t vertexCount = 0)
+        {
+            ++drawCalls;
+            vertices += vertexCount;
+        }
+    };
+
+    // Progress of a search on another thread. The searcher calls begin/add_nodes/end,
+    // any thread may take a snapshot; all accesses are relaxed atomics.
+    class SearchProgress
+    {
+    public:
+        struct Snapshot
+        {
+            bool running = false;
+            std::uint64_t nodes = 0;
+            int depth = 0;
+            double ms = 0; // since begin; total time once finished
+            double nodes_per_sec() const { return ms > 0 ? nodes * 1000.0 / ms : 0.0; }
+        };
+
+        void begin(int depth)
+        {
+            nodeCount.store(0, std::memory_order_relaxed);
+            curDepth.store(depth, std::memory_order_relaxed);
+            startUs.store(now_us(), std::memory_order_relaxed);
+            running.store(true, std::memory_order_relaxed);
+        }
+        void add_nodes(std::uint64_t n) { nodeCount.fetch_add(n, std::memory_order_relaxed); }
+        void set_depth(int depth) { curDepth.store(depth, std::memory_order_relaxed); }
+        void end()
+        {
+            endUs.store(now_us(), std::memory_order_relaxed);
+            running.store(false, std::memory_order_relaxed);
+        }
+
+        Snapshot snapshot() const
+        {
+            Snapshot s;
+            s.running = running.load(std::memory_order_relaxed);
+            s.nodes = nodeCount.load(std::memory_order_relaxed);
+            s.depth = curDepth.load(std::memory_order_relaxed);
+            std::int64_t t0 = startUs.load(std::memory_order_relaxed);
+            std::int64_t t1 = s.running ? now_us() : endUs.load(std::memory_order_relaxed);
+            s.ms = t0 ? std::max<std::int64_t>(0, t1 - t0) / 1000.0 : 0.0;
+            return s;
+        }
+
+    private:
+        std::atomic<std::uint64_t> nodeCount{0};
+        std::atomic<int> curDepth{0};
+        std::atomic<std::int64_t> startUs{0}, endUs{0};
+        std::atomic<bool> running{false};
+
+        static std::int64_t now_us() // never 0: startUs == 0 means "never started"
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(clock::now().time_since_epoch()).count() + 1;
+        }
+    };
+
+    // Latency histogram with HDR-style log-linear buckets, in microseconds: values below
+    // 2 * SUB are exact and every power of two above is split into SUB buckets, so a
+    // quantile is within 1/SUB (about 3%) of the true value. Values from 2^MAX_BITS us
+    // (about 19 hours) on share the last bucket. record() is a few relaxed atomics; any
+    // thread may read meanwhile, and sees each sample either whole or not yet in a bucket.
+    class Histogram
+    {
+    public:
+        static constexpr int SUB_BITS = 5, SUB = 1 << SUB_BITS, MAX_BITS = 36;
+        static constexpr int BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB;
+
+        static int bucket_of(std::uint64_t v)
+        {
+            if (v >= (std::uint64_t(1) << MAX_BITS))
+                return BUCKETS - 1;
+            if (v < SUB)
+                return static_cast<int>(v);
+            int h = 0; // highest set bit
+            for (int s = 32; s; s >>= 1)
+                if (v >> h >> s)
+                    h += s;
+            return (h - SUB_BITS + 1) * SUB + static_cast<int>(v >> (h - SUB_BITS)) - SUB;
+        }
+        // smallest and largest value that land in bucket i
+        static std::uint64_t bucket_low(int i)
+        {
+            return i < 2 * SUB ? std::uint64_t(i) : std::uint64_t(SUB + i % SUB) << (i / SUB - 1);
+        }
+        static std::uint64_t bucket_high(int i)
+        {
+            return i < 2 * SUB ? std::uint64_t(i) : bucket_low(i) + (std::uint64_t(1) << (i / SUB - 1)) - 1;
+        }
+
+        void record(std::uint64_t v)
+        {
+            counts[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(v, std::memory_order_relaxed);
+            std::uint64_t m = top.load(std::memory_order_relaxed);
+            while (v > m && !top.compare_exchange_weak(m, v, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        std::uint64_t count() const
+        {
+            std::uint64_t n = 0;
+            for (const auto &c : counts)
+                n += c.load(std::memory_order_relaxed);
+            return n;
+        }
+        std::uint64_t sum() const { return total.load(std::memory_order_relaxed); }
+        std::uint64_t max() const { return top.load(std::memory_order_relaxed); }
+        // samples in buckets whose values are all <= v
+        std::uint64_t count_at_or_below(std::uint64_t v) const
+        {
+            std::uint64_t n = 0;
+            for (int i = 0; i < BUCKETS && bucket_high(i) <= v; ++i)
+                n += counts[i].load(std::memory_order_relaxed);
+            return n;
+        }
+        // nearest-rank quantile, q in [0, 1]: the top of the bucket holding that sample,
+        // at most max(); 0 when empty
+        std::uint64_t quantile(double q) const
+        {
+            std::uint64_t n = count();
+            if (n == 0)
+                return 0;
+            std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * n))), seen = 0;
+            for (int i = 0; i < BUCKETS; ++i)
+            {
+                seen += counts[i].load(std::memory_order_relaxed);
+                if (seen >= rank)
+                    return std::min(bucket_high(i), max());
+            }
+            return max();
+        }
+
+    private:
+        std::atomic<std::uint64_t> counts[BUCKETS]{};
+        std::atomic<std::uint64_t> total{0}, top{0};
+    };
+
+    // Engine calls by mode, depth and board size: a latency histogram and the nodes and
+    // stones of the calls. AI::choose_move and ai_greedy / ai_negamax / ai_mcts record
+    // every call through CallTimer. A series lives in a fixed table probed without locks,
+    // allocated the first time its labels occur and never freed, so recording is a probe
+    // plus a few relaxed atomics and the search threads never wait on each other or on an
+    // exporter. Modes must be string literals: only the pointer is kept.
+    class Registry
+    {
+    public:
+        static constexpr std::size_t SLOTS = 1024;
+        static constexpr int SIZE_CLASSES = 6; // stones < 16, < 64, < 256, < 1024, < 4096, more
+
+        struct Series
+        {
+            Series(const char *m, int d, int sc) : mode(m), depth(d), sizeClass(sc) {}
+            const char *mode;
+            int depth, sizeClass;
+            Histogram latencyUs;
+            std::atomic<std::uint64_t> nodes{0}, stones{0};
+        };
+
+        static int size_class(std::size_t stones)
+        {
+            int c = 0;
+            while (c + 1 < SIZE_CLASSES && stones >= (std::size_t(16) << (2 * c)))
+                ++c;
+            return c;
+        }
+        static const char *size_label(int c)
+        {
+            static const char *names[SIZE_CLASSES] = {"0-15", "16-63", "64-255", "256-1023", "1024-4095", "4096+"};
+            return names[c];
+        }
+
+        Registry() = default;
+        Registry(const Registry &) = delete;
+        Registry &operator=(const Registry &) = delete;
+        ~Registry()
+        {
+            for (auto &s : slots)
+                delete s.load(std::memory_order_relaxed);
+        }
+
+        // the series for these labels; when the table is full, one shared "other" series
+        Series &series(const char *mode, int depth, std::size_t stones)
+        {
+            int sc = size_class(stones);
+            std::size_t h = static_cast<std::size_t>(depth) * 31 + static_cast<std::size_t>(sc);
+            for (const char *c = mode; *c; ++c)
+                h = h * 131 + static_cast<unsigned char>(*c);
+            for (std::size_t probe = 0; probe < SLOTS; ++probe)
+            {
+                std::atomic<Series *> &slot = slots[(h + probe) % SLOTS];
+                Series *s = slot.load(std::memory_order_acquire);
+                if (!s)
+                {
+                    Series *fresh = new Series(mode, depth, sc);
+                    if (slot.compare_exchange_strong(s, fresh, std::memory_order_acq_rel))
+                        return *fresh;
+                    delete fresh; // another thread filled the slot first; s is its series
+                }
+                if (s->depth == depth && s->sizeClass == sc && std::strcmp(s->mode, mode) == 0)
+                    return *s;
+            }
+            return overflow;
+        }
+
+        void record(const char *mode, int depth, std::size_t stones, std::uint64_t us, std::uint64_t nodes)
+        {
+            Series &s = series(mode, depth, stones);
+            s.latencyUs.record(us);
+            s.nodes.fetch_add(nodes, std::memory_order_relaxed);
+            s.stones.fetch_add(stones, std::memory_order_relaxed);
+        }
+
+        template <class F>
+        void each(F &&fn) const
+        {
+            for (auto &slot : slots)
+                if (const Series *s = slot.load(std::memory_order_acquire))
+                    fn(*s);
+            if (overflow.latencyUs.count())
+                fn(overflow);
+        }
+
+        // Prometheus text exposition (format 0.0.4): per series a histogram in seconds
+        // (cumulative buckets from 0.1 ms to 60 s, at the histogram's 3% resolution), its
+        // p50/p90/p99/p99.9/max as gauges, and nodes and stones as counters
+        std::string prometheus() const
+        {
+            static const double bounds[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+                                            0.25, 0.5, 1, 2.5, 5, 10, 30, 60};
+            static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+            std::string out;
+            char line[256];
+            auto labels = [&](const Series &s)
+            {
+                std::snprintf(line, sizeof line, "mode=\"%s\",depth=\"%d\",stones=\"%s\"", s.mode, s.depth, size_label(s.sizeClass));
+                return std::string(line);
+            };
+            auto add = [&](const char *fmt, const std::string &l, double v)
+            {
+                std::snprintf(line, sizeof line, fmt, l.c_str(), v);
+                out += line;
+            };
+            auto add_count = [&](const char *name, const std::string &l, std::uint64_t v)
+            {
+                std::snprintf(line, sizeof line, "%s{%s} %llu\n", name, l.c_str(), static_cast<unsigned long long>(v));
+                out += line;
+            };
+
+            out += "# HELP ttt4_move_seconds Time of one engine move search.\n# TYPE ttt4_move_seconds histogram\n";
+            each([&](const Series &s)
+                 {
+                std::string l = labels(s);
+                std::uint64_t n = s.latencyUs.count();
+                for (double b : bounds)
+                {
+                    std::snprintf(line, sizeof line, "ttt4_move_seconds_bucket{%s,le=\"%g\"} %llu\n", l.c_str(), b,
+                                  static_cast<unsigned long long>(s.latencyUs.count_at_or_below(static_cast<std::uint64_t>(b * 1e6))));
+                    out += line;
+                }
+                std::snprintf(line, sizeof line, "ttt4_move_seconds_bucket{%s,le=\"+Inf\"} %llu\n", l.c_str(), static_cast<unsigned long long>(n));
+                out += line;
+                add("ttt4_move_seconds_sum{%s} %.6f\n", l, s.latencyUs.sum() / 1e6);
+                add_count("ttt4_move_seconds_count", l, n); });
+
+            out += "# HELP ttt4_move_seconds_quantile Move search time quantiles since start.\n# TYPE ttt4_move_seconds_quantile gauge\n";
+            each([&](const Series &s)
+                 {
+                std::string l = labels(s);
+                for (double q : quantiles)
+                {
+                    std::snprintf(line, sizeof line, "ttt4_move_seconds_quantile{%s,quantile=\"%g\"} %.6f\n", l.c_str(), q,
+                                  s.latencyUs.quantile(q) / 1e6);
+                    out += line;
+                }
+                add("ttt4_move_seconds_quantile{%s,quantile=\"1\"} %.6f\n", l, s.latencyUs.max() / 1e6); });
+
+            out += "# HELP ttt4_search_nodes_total Nodes (playouts for MCTS) searched.\n# TYPE ttt4_search_nodes_total counter\n";
+            each([&](const Series &s)
+                 { add_count("ttt4_search_nodes_total", labels(s), s.nodes.load(std::memory_order_relaxed)); });
+            out += "# HELP ttt4_board_stones_total Stones on the board, summed over calls.\n# TYPE ttt4_board_stones_total counter\n";
+            each([&](const Series &s)
+                 { add_count("ttt4_board_stones_total", labels(s), s.stones.load(std::memory_order_relaxed)); });
+            return out;
+        }
+
+    private:
+        std::atomic<Series *> slots[SLOTS]{};
+        Series overflow{"other", 0, 0};
+    };
+
+    // the process-wide registry; never destroyed, so threads may record during exit
+    inline Registry &registry()
+    {
+        static Registry *r = new Registry;
+        return *r;
+    }
+
+    // Times the enclosing engine call and records it in registry() on scope exit. Set
+    // `nodes`, and `depth` when it is only known at the end (iterative deepening).
+    class CallTimer
+    {
+    public:
+        CallTimer(const char *mode_, int depth_, std::size_t stones_) : depth(depth_), mode(mode_), stones(stones_) {}
+        ~CallTimer()
+        {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - t0).count();
+            registry().record(mode, depth, stones, static_cast<std::uint64_t>(us), nodes);
+        }
+        CallTimer(const CallTimer &) = delete;
+        CallTimer &operator=(const CallTimer &) = delete;
+
+        int depth;
+        std::uint64_t nodes = 0;
+
+    private:
+        const char *mode;
+        std::size_t stones;
+        clock::time_point t0 = clock::now();
+    };
+}
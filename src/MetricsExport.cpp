@@ -0,0 +1,213 @@
+#include "MetricsExport.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define TTT_METRICS_SOCKETS 1
+#endif
+
+namespace metrics
+{
+    namespace
+    {
+        constexpr int POLL_MS = 100; // how soon stop() is noticed while listening
+        constexpr std::size_t MAX_REQUEST = 8192;
+
+        void set_error(std::string *error, const std::string &what)
+        {
+            if (error)
+                *error = what;
+        }
+    }
+
+    bool write_prometheus(const std::string &path, std::string *error)
+    {
+        std::string text = registry().prometheus();
+        std::string tmp = path + ".tmp";
+        std::FILE *f = std::fopen(tmp.c_str(), "wb");
+        if (!f)
+        {
+            set_error(error, "cannot write " + tmp);
+            return false;
+        }
+        bool ok = std::fwrite(text.data(), 1, text.size(), f) == text.size();
+        ok = std::fclose(f) == 0 && ok;
+#ifdef _WIN32
+        std::remove(path.c_str()); // rename does not replace there
+#endif
+        if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tmp.c_str());
+            set_error(error, "cannot write " + path);
+            return false;
+        }
+        return true;
+    }
+
+    bool Exporter::start(const Options &o, std::string *error)
+    {
+        if (running())
+        {
+            set_error(error, "metrics export already running");
+            return false;
+        }
+        if (o.file.empty() && o.port < 0)
+        {
+            set_error(error, "no metrics file or port");
+            return false;
+        }
+        opt = o;
+        opt.intervalMs = std::max(1, opt.intervalMs);
+        if (opt.port >= 0)
+        {
+#ifdef TTT_METRICS_SOCKETS
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            int one = 1;
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(static_cast<std::uint16_t>(opt.port));
+            socklen_t len = sizeof(addr);
+            if (fd < 0 || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+                ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd, 16) != 0 ||
+                ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+            {
+                if (fd >= 0)
+                    ::close(fd);
+                set_error(error, "cannot listen on 127.0.0.1:" + std::to_string(opt.port));
+                return false;
+            }
+            listenFd = fd;
+            boundPort = ntohs(addr.sin_port);
+#else
+            set_error(error, "the metrics endpoint needs POSIX sockets");
+            return false;
+#endif
+        }
+        stopping = false;
+        worker = std::thread([this]
+                             { run(); });
+        return true;
+    }
+
+    bool Exporter::start_from_env(std::string *error)
+    {
+        Options o;
+        const char *file = std::getenv("TTT_METRICS_FILE");
+        const char *port = std::getenv("TTT_METRICS_PORT");
+        const char *interval = std::getenv("TTT_METRICS_INTERVAL_MS");
+        if (file && *file)
+            o.file = file;
+        if (port && *port)
+            o.port = std::atoi(port);
+        if (interval && *interval)
+            o.intervalMs = std::atoi(interval);
+        if (o.file.empty() && o.port < 0)
+        {
+            set_error(error, "");
+            return false;
+        }
+        return start(o, error);
+    }
+
+    void Exporter::stop()
+    {
+        if (!running())
+            return;
+        {
+            std::lock_guard<std::mutex> lk(mx);
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+#ifdef TTT_METRICS_SOCKETS
+        if (listenFd >= 0)
+            ::close(listenFd);
+#endif
+        listenFd = boundPort = -1;
+    }
+
+    void Exporter::run()
+    {
+        using ms = std::chrono::milliseconds;
+        auto next = clock::now() + ms(opt.intervalMs);
+        for (;;)
+        {
+            auto wait = opt.file.empty() ? ms(POLL_MS) : std::chrono::duration_cast<ms>(next - clock::now());
+            wait = std::max(ms(0), wait);
+            if (listenFd >= 0)
+            {
+#ifdef TTT_METRICS_SOCKETS
+                pollfd p{listenFd, POLLIN, 0};
+                if (::poll(&p, 1, static_cast<int>(std::min<long long>(wait.count(), POLL_MS))) > 0)
+                    serve_one();
+#endif
+                std::lock_guard<std::mutex> lk(mx);
+                if (stopping)
+                    break;
+            }
+            else
+            {
+                std::unique_lock<std::mutex> lk(mx);
+                if (cv.wait_for(lk, wait, [this]
+                                { return stopping; }))
+                    break;
+            }
+            if (!opt.file.empty() && clock::now() >= next)
+            {
+                write_prometheus(opt.file);
+                next = clock::now() + ms(opt.intervalMs);
+            }
+        }
+        if (!opt.file.empty())
+            write_prometheus(opt.file);
+    }
+
+    void Exporter::serve_one()
+    {
+#ifdef TTT_METRICS_SOCKETS
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+            return;
+        timeval tv{1, 0}; // a client that sends nothing must not hold up the exporter
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        std::string req;
+        char buf[1024];
+        while (req.size() < MAX_REQUEST && req.find("\r\n\r\n") == std::string::npos)
+        {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0)
+                break;
+            req.append(buf, static_cast<std::size_t>(n));
+        }
+        std::string body = registry().prometheus();
+        std::string reply = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                            std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        for (std::size_t sent = 0; sent < reply.size();)
+        {
+            ssize_t n = ::send(fd, reply.data() + sent, reply.size() - sent, flags);
+            if (n <= 0)
+                break;
+            sent += static_cast<std::size_t>(n);
+        }
+        ::close(fd);
+#endif
+    }
+}
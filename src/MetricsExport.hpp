@@ -0,0 +1,60 @@
+#pragma once
+#include "Metrics.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Publishes metrics::registry() as Prometheus text from a thread of its own, so search
+// threads never format or wait on I/O:
+//   - file: rewritten every intervalMs and once more on stop(). The text goes to a
+//     temporary file renamed over the target, so a reader (e.g. node_exporter's textfile
+//     collector) never sees half of it.
+//   - port: HTTP on 127.0.0.1; every request gets the current text (POSIX only). Port 0
+//     takes any free port, see port().
+//
+//   TTT_METRICS_FILE=m.prom TTT_METRICS_PORT=9464 ttt4_engine     (start_from_env)
+namespace metrics
+{
+    // the registry's text, written once to `path` the same way
+    bool write_prometheus(const std::string &path, std::string *error = nullptr);
+
+    class Exporter
+    {
+    public:
+        struct Options
+        {
+            std::string file; // empty: no file
+            int intervalMs = 5000;
+            int port = -1; // -1: no endpoint
+        };
+
+        Exporter() = default;
+        Exporter(const Exporter &) = delete;
+        Exporter &operator=(const Exporter &) = delete;
+        ~Exporter() { stop(); }
+
+        // false if nothing is to be exported, the endpoint cannot listen or it is
+        // already running
+        bool start(const Options &o, std::string *error = nullptr);
+        // Options from TTT_METRICS_FILE, TTT_METRICS_PORT and TTT_METRICS_INTERVAL_MS;
+        // false, with an empty error, when neither of the first two is set
+        bool start_from_env(std::string *error = nullptr);
+        void stop();
+        bool running() const { return worker.joinable(); }
+        // the endpoint's port, -1 without one
+        int port() const { return boundPort; }
+
+    private:
+        Options opt;
+        int listenFd = -1, boundPort = -1;
+        std::thread worker;
+        std::mutex mx;
+        std::condition_variable cv;
+        bool stopping = false;
+
+        void run();
+        void serve_one();
+    };
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "Metrics.hpp"
+
+// Tiny micro-benchmark harness for ttt4_micro and ttt4_micro_game: times an operation
+// in rounds of at least ROUND_MS, keeps the fastest round (the least disturbed by other
+// load) and compares its ns/op with a recorded baseline.
+//
+//   ttt4_micro[_game] [--tolerance F] [--filter SUBSTRING]
+//
+// An op over baseline * tolerance (default 2: shared machines jitter by tens of percent)
+// is reported SLOW and makes the exit code 1. Baselines are ns/op on the reference
+// machine with -O2; after a deliberate change (or on other hardware) scale with
+// --tolerance or edit the numbers in the bench.
+namespace micro
+{
+    constexpr double ROUND_MS = 30.0;
+    constexpr int ROUNDS = 5;
+
+    // keeps results alive so the optimiser cannot drop the measured calls
+    inline volatile std::uint64_t sink = 0;
+
+    class Runner
+    {
+    public:
+        Runner(int argc, char **argv)
+        {
+            for (int i = 1; i + 1 < argc; i += 2)
+            {
+                if (std::strcmp(argv[i], "--tolerance") == 0)
+                    tolerance = std::atof(argv[i + 1]);
+                else if (std::strcmp(argv[i], "--filter") == 0)
+                    filter = argv[i + 1];
+            }
+            std::printf("%-28s %10s %10s %7s\n", "op", "ns/op", "baseline", "ratio");
+        }
+
+        // op(i) performs one operation and returns something to fold into the sink
+        template <class Op>
+        void run(const char *name, double baselineNs, Op &&op)
+        {
+            if (!filter.empty() && std::string(name).find(filter) == std::string::npos)
+                return;
+            std::uint64_t acc = 0, iters = 1;
+            // calibrate: double until one round is long enough to time
+            for (;;)
+            {
+                metrics::Stopwatch sw;
+                for (std::uint64_t i = 0; i < iters; ++i)
+                    acc += static_cast<std::uint64_t>(op(i));
+                if (sw.ms() >= ROUND_MS / 4)
+                    break;
+                iters *= 2;
+            }
+            iters *= 4;
+            double best = 1e300;
+            for (int r = 0; r < ROUNDS; ++r)
+            {
+                metrics::Stopwatch sw;
+                for (std::uint64_t i = 0; i < iters; ++i)
+                    acc += static_cast<std::uint64_t>(op(i));
+                double ns = sw.ms() * 1e6 / iters;
+                best = ns < best ? ns : best;
+            }
+            sink = sink + acc;
+            double ratio = best / baselineNs;
+            bool slow = ratio > tolerance;
+            failures += slow;
+            std::printf("%-28s %10.1f %10.1f %7.2f%s\n", name, best, baselineNs, ratio, slow ? "  SLOW" : "");
+        }
+
+        int exit_code() const
+        {
+            if (failures)
+                std::printf("%d op(s) over %.2fx baseline\n", failures, tolerance);
+            return failures ? 1 : 0;
+        }
+
+    private:
+        double tolerance = 2.0;
+        std::string filter;
+        int failures = 0;
+    };
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Board.hpp"
+
+// Text positions for the engine and batch front ends: moves are "x,y", a game is the
+// list of moves in order with X first.
+
+inline bool parse_move(const std::string &s, Move &m)
+{
+    char comma = 0;
+    std::istringstream ss(s);
+    return static_cast<bool>(ss >> m.x >> comma >> m.y) && comma == ',';
+}
+
+inline std::string format_move(const Move &m) { return std::to_string(m.x) + "," + std::to_string(m.y); }
+
+// Plays `moves` on an empty board with colours chosen so that the side to move owns
+// the O stones (the AI always searches for O). Stops at the first occupied cell;
+// returns the number of moves placed.
+inline std::size_t load_game(Board &b, const std::vector<Move> &moves)
+{
+    b = Board();
+    Cell stm = moves.size() % 2 == 0 ? Cell::X : Cell::O;
+    for (std::size_t i = 0; i < moves.size(); ++i)
+    {
+        Cell who = i % 2 == 0 ? Cell::X : Cell::O;
+        if (!b.place(moves[i].x, moves[i].y, who == stm ? Cell::O : Cell::X))
+            return i;
+    }
+    return moves.size();
+}
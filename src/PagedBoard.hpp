@@ -0,0 +1,547 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Game.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Disk-backed IBoard for a persistent "infinite world". The stones live in a file of 4 KiB
+// pages, and only recently used tiles are mapped, so memory stays bounded however many
+// stones the world holds.
+//
+//   file   := header group*
+//   header := "TTT4PAGE" u32 version u32 TILE u64 tiles u64 stones
+//             i32 minx miny maxx maxy u32 orderTag u32 0                    (one page)
+//   group  := dir tile{511}
+//   dir    := 511 x (i32 tx, i32 ty): slot i of the group holds tile (tx, ty)
+//   tile   := TILE x TILE cells, one Cell byte each, row-major            (one page)
+//
+// Tiles get a slot on their first stone, in order. The file grows a group (2 MiB, sparse)
+// at a time. The tile -> slot index (about 14 bytes a tile) is rebuilt from the
+// directories on open and kept in memory. Tile pages are mapped one by one, at most
+// residentTiles at a time, and the least recently used is unmapped first. Reading a tile
+// that was never written maps nothing.
+//
+// Mappings are shared, so every write lands in the page cache: a crashed process loses
+// nothing, and sync() also flushes to disk. Fields are native-endian; orderTag rejects a
+// file from another architecture.
+//
+// bounds() is exact while stones are only added, or undone in LIFO order (the last
+// undoDepth placements are remembered, enough for any search). Removing an older stone
+// leaves it conservative. The world's bbox grows with the world, so search and rendering
+// should stay local: extract() copies a rectangle into a MapBoard for the AI, and query()
+// visits the stones of a rectangle for drawing. Both map only the tiles they cross.
+//
+// If a page cannot be mapped, reads see Empty, writes are dropped and failed() turns true.
+// Not thread-safe, like MapBoard: get() updates the LRU.
+class PagedBoard : public IBoard
+{
+public:
+    static constexpr int TILE_SHIFT = 6;
+    static constexpr int TILE = 1 << TILE_SHIFT;
+    static constexpr std::size_t PAGE = 4096;
+    static constexpr std::uint32_t GROUP_TILES = 511;
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::uint32_t ORDER_TAG = 0x01020304;
+    static_assert(TILE * TILE == PAGE, "a tile is one page");
+
+    struct Options
+    {
+        std::size_t residentTiles = 256; // mapped tile pages (1 MiB)
+        std::size_t undoDepth = 4096;    // placements remembered for exact bounds and recent()
+    };
+
+    PagedBoard() = default;
+    PagedBoard(const PagedBoard &) = delete;
+    PagedBoard &operator=(const PagedBoard &) = delete;
+    ~PagedBoard() override { close(); }
+
+    // Opens the world file, creating an empty one if it is missing. On failure the board
+    // stays closed.
+    bool open(const std::string &path, std::string *error = nullptr) { return open(path, Options(), error); }
+    bool open(const std::string &path, const Options &o, std::string *error = nullptr)
+    {
+        close();
+        auto bail = [&](const char *what)
+        {
+            close();
+            return fail(error, what);
+        };
+        opt = o;
+        opt.residentTiles = std::max<std::size_t>(opt.residentTiles, 1);
+        opt.undoDepth = std::max<std::size_t>(opt.undoDepth, 1);
+        std::uint64_t size = 0;
+        if (!openFile(path, size))
+            return bail("cannot open file");
+        bool fresh = size == 0;
+        if (fresh && !growTo(1))
+            return bail("cannot grow file");
+        if (!fresh && size < PAGE)
+            return bail("not a paged board");
+        hdr = reinterpret_cast<Header *>(mapPage(0, &hdrView));
+        if (!hdr)
+            return bail("cannot map header");
+        if (fresh)
+        {
+            std::memcpy(hdr->magic, "TTT4PAGE", 8);
+            hdr->version = VERSION;
+            hdr->tile = TILE;
+            hdr->orderTag = ORDER_TAG;
+        }
+        else if (std::memcmp(hdr->magic, "TTT4PAGE", 8) != 0)
+            return bail("not a paged board");
+        else if (hdr->version != VERSION || hdr->tile != TILE)
+            return bail("unsupported version");
+        else if (hdr->orderTag != ORDER_TAG)
+            return bail("board from another architecture");
+
+        std::uint64_t tiles = hdr->tiles;
+        if (tiles > UINT32_MAX || (tiles && size / PAGE < tilePage(static_cast<std::uint32_t>(tiles - 1)) + 1))
+            return bail("truncated file");
+        slotOf.reserve(static_cast<std::size_t>(tiles));
+        for (std::uint32_t s = 0; s < tiles; s += GROUP_TILES)
+        {
+            void *view = nullptr;
+            const std::uint8_t *page = mapPage(dirPage(s), &view);
+            if (!page)
+                return bail("cannot map directory");
+            DirEntry dir[GROUP_TILES];
+            std::memcpy(dir, page, sizeof(dir));
+            unmapPage(view, page);
+            for (std::uint32_t i = 0; i < GROUP_TILES && s + i < tiles; ++i)
+                if (!slotOf.insert(dir[i].tx, dir[i].ty, s + i))
+                    return bail("corrupt directory");
+        }
+        return true;
+    }
+
+    // Unmaps every page and closes the file; the board reads as empty afterwards.
+    void close()
+    {
+        for (Resident &r : res)
+            unmapPage(r.view, r.cells);
+        res.clear();
+        resOf.clear();
+        head = tail = NONE;
+        lastValid = false;
+        if (hdr)
+            unmapPage(hdrView, reinterpret_cast<std::uint8_t *>(hdr));
+        hdr = nullptr;
+        hdrView = nullptr;
+        slotOf.clear();
+        hist.clear();
+        closeFile();
+        loads = evictions = 0;
+        bad = false;
+    }
+
+    bool isOpen() const { return hdr != nullptr; }
+    bool failed() const { return bad; }
+
+    // Writes the mapped pages back and flushes the file to disk.
+    bool sync()
+    {
+        if (!hdr)
+            return false;
+        bool ok = syncPage(hdrView, reinterpret_cast<std::uint8_t *>(hdr));
+        for (const Resident &r : res)
+            ok = syncPage(r.view, r.cells) && ok;
+        return syncFile() && ok;
+    }
+
+    Cell get(int x, int y) const override
+    {
+        const std::uint8_t *cells = find(x >> TILE_SHIFT, y >> TILE_SHIFT);
+        return cells ? Cell(cells[cellIndex(x, y)]) : Cell::Empty;
+    }
+    bool exists(int x, int y) const override { return get(x, y) != Cell::Empty; }
+
+    void set(int x, int y, Cell c) override
+    {
+        int tx = x >> TILE_SHIFT, ty = y >> TILE_SHIFT;
+        std::uint8_t *cells = find(tx, ty);
+        if (!cells)
+        {
+            if (c == Cell::Empty || slotOf.contains(tx, ty)) // nothing to clear, or unmappable
+                return;
+            if (!(cells = allocate(tx, ty)))
+                return;
+        }
+        std::uint8_t &cell = cells[cellIndex(x, y)];
+        Cell old = Cell(cell);
+        if (old == c)
+            return;
+        cell = static_cast<std::uint8_t>(c);
+        if (c == Cell::Empty)
+        {
+            --hdr->stones;
+            if (!hist.empty() && hist.back().x == x && hist.back().y == y)
+            {
+                const Placed &h = hist.back();
+                hdr->minx = h.minx;
+                hdr->miny = h.miny;
+                hdr->maxx = h.maxx;
+                hdr->maxy = h.maxy;
+                hist.pop_back();
+            }
+            else // an older stone: the bbox stays as it is
+                for (std::size_t i = hist.size(); i-- > 0;)
+                    if (hist[i].x == x && hist[i].y == y)
+                    {
+                        hist.erase(hist.begin() + static_cast<std::ptrdiff_t>(i));
+                        break;
+                    }
+        }
+        else if (old == Cell::Empty)
+        {
+            if (hist.size() >= 2 * opt.undoDepth)
+                hist.erase(hist.begin(), hist.begin() + static_cast<std::ptrdiff_t>(opt.undoDepth));
+            hist.push_back({x, y, hdr->minx, hdr->miny, hdr->maxx, hdr->maxy});
+            if (hdr->stones++ == 0)
+            {
+                hdr->minx = hdr->maxx = x;
+                hdr->miny = hdr->maxy = y;
+            }
+            else
+            {
+                hdr->minx = std::min(hdr->minx, x);
+                hdr->miny = std::min(hdr->miny, y);
+                hdr->maxx = std::max(hdr->maxx, x);
+                hdr->maxy = std::max(hdr->maxy, y);
+            }
+        }
+    }
+
+    Bounds bounds() const override
+    {
+        if (!hdr || hdr->stones == 0)
+            return {1, 1, 0, 0};
+        return {hdr->minx, hdr->miny, hdr->maxx, hdr->maxy};
+    }
+    size_t count() const override { return hdr ? static_cast<size_t>(hdr->stones) : 0; }
+    size_t recent(Pos *out, size_t n) const override
+    {
+        size_t k = 0;
+        for (size_t i = hist.size(); i-- > 0 && k < n;)
+            out[k++] = {hist[i].x, hist[i].y};
+        return k;
+    }
+
+    // fn(x, y, Cell) for every stone in [x0, x1] x [y0, y1], tile by tile. Tiles without
+    // stones are skipped without mapping them. fn may read the board.
+    template <class F>
+    void query(int x0, int y0, int x1, int y1, F &&fn) const
+    {
+        for (int ty = y0 >> TILE_SHIFT; ty <= (y1 >> TILE_SHIFT); ++ty)
+            for (int tx = x0 >> TILE_SHIFT; tx <= (x1 >> TILE_SHIFT); ++tx)
+            {
+                const std::uint8_t *cells = find(tx, ty);
+                int cx0 = std::max(x0, tx * TILE), cx1 = std::min(x1, tx * TILE + TILE - 1);
+                int cy0 = std::max(y0, ty * TILE), cy1 = std::min(y1, ty * TILE + TILE - 1);
+                for (int y = cy0; y <= cy1 && cells; ++y)
+                    for (int x = cx0; x <= cx1 && cells; ++x)
+                        if (std::uint8_t v = cells[cellIndex(x, y)])
+                        {
+                            std::uint64_t seen = evictions;
+                            fn(x, y, Cell(v));
+                            if (evictions != seen) // fn's reads pushed this tile out
+                                cells = find(tx, ty);
+                        }
+            }
+    }
+
+    // The stones of `r` as a MapBoard for the AI. Stones still in recent() go in last and
+    // in order, so zone candidates around the last moves behave as on the world itself.
+    void extract(const Bounds &r, MapBoard &out) const
+    {
+        out = MapBoard{};
+        static constexpr size_t MAX_RECENT = 64;
+        Pos rec[MAX_RECENT];
+        size_t nr = recent(rec, MAX_RECENT);
+        auto isRecent = [&](int x, int y)
+        {
+            for (size_t i = 0; i < nr; ++i)
+                if (rec[i].x == x && rec[i].y == y)
+                    return true;
+            return false;
+        };
+        query(r.minx, r.miny, r.maxx, r.maxy, [&](int x, int y, Cell c)
+              {
+            if (!isRecent(x, y))
+                out.set(x, y, c); });
+        for (size_t i = nr; i-- > 0;)
+            if (rec[i].x >= r.minx && rec[i].x <= r.maxx && rec[i].y >= r.miny && rec[i].y <= r.maxy)
+                out.set(rec[i].x, rec[i].y, get(rec[i].x, rec[i].y));
+    }
+
+    size_t tileCount() const { return hdr ? static_cast<size_t>(hdr->tiles) : 0; }
+    size_t residentTiles() const { return res.size(); }
+    std::uint64_t tileLoads() const { return loads; }
+    // heap of the index and undo list plus the mapped pages
+    size_t memoryBytes() const
+    {
+        return slotOf.memory_bytes() + resOf.memory_bytes() + res.capacity() * sizeof(Resident) +
+               hist.capacity() * sizeof(Placed) + (res.size() + (hdr ? 1 : 0)) * PAGE;
+    }
+
+private:
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version, tile;
+        std::uint64_t tiles, stones;
+        std::int32_t minx, miny, maxx, maxy;
+        std::uint32_t orderTag, reserved;
+    };
+    struct DirEntry
+    {
+        std::int32_t tx, ty;
+    };
+    static_assert(sizeof(DirEntry) * GROUP_TILES <= PAGE, "a directory is one page");
+    struct Placed
+    {
+        int x, y;
+        int minx, miny, maxx, maxy;
+    };
+    // a mapped tile page, linked into the LRU list (head = most recent)
+    struct Resident
+    {
+        int tx, ty;
+        std::uint8_t *cells;
+        void *view;
+        std::uint32_t prev, next;
+    };
+    static constexpr std::uint32_t NONE = UINT32_MAX;
+
+    Options opt;
+    Header *hdr = nullptr;
+    void *hdrView = nullptr;
+    FlatMap<std::uint32_t> slotOf; // tile -> slot
+    std::vector<Placed> hist;
+    mutable std::vector<Resident> res;
+    mutable FlatMap<std::uint32_t> resOf; // tile -> res index
+    mutable std::uint32_t head = NONE, tail = NONE;
+    // the tile of the previous lookup (cells nullptr: no such tile)
+    mutable int lastTx = 0, lastTy = 0;
+    mutable std::uint8_t *lastCells = nullptr;
+    mutable bool lastValid = false;
+    mutable std::uint64_t loads = 0, evictions = 0;
+    mutable bool bad = false;
+    std::size_t gran = PAGE; // mapping offsets must be multiples of this
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    static bool fail(std::string *error, const char *what)
+    {
+        if (error)
+            *error = what;
+        return false;
+    }
+    static int cellIndex(int x, int y) { return ((y & (TILE - 1)) << TILE_SHIFT) | (x & (TILE - 1)); }
+    static std::uint64_t dirPage(std::uint32_t slot) { return 1 + std::uint64_t(slot / GROUP_TILES) * (GROUP_TILES + 1); }
+    static std::uint64_t tilePage(std::uint32_t slot) { return dirPage(slot) + 1 + slot % GROUP_TILES; }
+
+    // cells of tile (tx, ty), mapped if needed; nullptr if it has no slot
+    std::uint8_t *find(int tx, int ty) const
+    {
+        if (lastValid && tx == lastTx && ty == lastTy)
+            return lastCells;
+        const std::uint32_t *slot = slotOf.find(tx, ty);
+        std::uint8_t *cells = slot ? resident(tx, ty, *slot) : nullptr;
+        lastTx = tx;
+        lastTy = ty;
+        lastCells = cells;
+        lastValid = cells || !slot;
+        return cells;
+    }
+
+    std::uint8_t *resident(int tx, int ty, std::uint32_t slot) const
+    {
+        if (const std::uint32_t *r = resOf.find(tx, ty))
+        {
+            unlink(*r);
+            pushFront(*r);
+            return res[*r].cells;
+        }
+        void *view = nullptr;
+        std::uint8_t *cells = mapPage(tilePage(slot), &view);
+        if (!cells)
+        {
+            bad = true;
+            return nullptr;
+        }
+        ++loads;
+        std::uint32_t i;
+        if (res.size() < opt.residentTiles)
+        {
+            i = static_cast<std::uint32_t>(res.size());
+            res.push_back({});
+        }
+        else
+        {
+            i = tail;
+            Resident &old = res[i];
+            unlink(i);
+            resOf.erase(old.tx, old.ty);
+            unmapPage(old.view, old.cells);
+            if (lastValid && lastTx == old.tx && lastTy == old.ty)
+                lastValid = false;
+            ++evictions;
+        }
+        res[i] = {tx, ty, cells, view, NONE, NONE};
+        resOf.insert(tx, ty, i);
+        pushFront(i);
+        return cells;
+    }
+    void unlink(std::uint32_t i) const
+    {
+        Resident &r = res[i];
+        (r.prev == NONE ? head : res[r.prev].next) = r.next;
+        (r.next == NONE ? tail : res[r.next].prev) = r.prev;
+    }
+    void pushFront(std::uint32_t i) const
+    {
+        res[i].prev = NONE;
+        res[i].next = head;
+        (head == NONE ? tail : res[head].prev) = i;
+        head = i;
+    }
+
+    // gives (tx, ty) the next slot; its page is fresh from the sparse file, all Empty
+    std::uint8_t *allocate(int tx, int ty)
+    {
+        if (!hdr || hdr->tiles >= UINT32_MAX)
+        {
+            bad = true;
+            return nullptr;
+        }
+        std::uint32_t slot = static_cast<std::uint32_t>(hdr->tiles);
+        if (slot % GROUP_TILES == 0 && !growTo(dirPage(slot) + 1 + GROUP_TILES))
+        {
+            bad = true;
+            return nullptr;
+        }
+        void *view = nullptr;
+        std::uint8_t *dir = mapPage(dirPage(slot), &view);
+        if (!dir)
+        {
+            bad = true;
+            return nullptr;
+        }
+        DirEntry e{tx, ty};
+        std::memcpy(dir + (slot % GROUP_TILES) * sizeof(DirEntry), &e, sizeof(e));
+        unmapPage(view, dir);
+        hdr->tiles = slot + 1;
+        slotOf.insert(tx, ty, slot);
+        lastValid = false;
+        return find(tx, ty);
+    }
+
+    // Platform layer: one PAGE at a time, mapped from the enclosing granule.
+#ifdef _WIN32
+    bool openFile(const std::string &path, std::uint64_t &size)
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        gran = si.dwAllocationGranularity;
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER sz;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &sz))
+            return false;
+        size = static_cast<std::uint64_t>(sz.QuadPart);
+        return size == 0 || remap();
+    }
+    void closeFile()
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+    }
+    // a section covering the whole file; views of an older one stay valid
+    bool remap()
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+        return mapping != nullptr;
+    }
+    bool growTo(std::uint64_t pages)
+    {
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(pages * PAGE);
+        return SetFilePointerEx(file, end, nullptr, FILE_BEGIN) && SetEndOfFile(file) && remap();
+    }
+    std::uint8_t *mapPage(std::uint64_t page, void **view) const
+    {
+        std::uint64_t off = page * PAGE, base = off / gran * gran;
+        void *v = MapViewOfFile(mapping, FILE_MAP_WRITE, static_cast<DWORD>(base >> 32), static_cast<DWORD>(base),
+                                static_cast<SIZE_T>(off - base + PAGE));
+        if (!v)
+            return nullptr;
+        *view = v;
+        return static_cast<std::uint8_t *>(v) + (off - base);
+    }
+    static void unmapPage(void *view, const std::uint8_t *) { UnmapViewOfFile(view); }
+    static bool syncPage(void *view, const std::uint8_t *page)
+    {
+        return FlushViewOfFile(view, static_cast<SIZE_T>(page - static_cast<std::uint8_t *>(view) + PAGE)) != 0;
+    }
+    bool syncFile() { return FlushFileBuffers(file) != 0; }
+#else
+    bool openFile(const std::string &path, std::uint64_t &size)
+    {
+        long ps = sysconf(_SC_PAGESIZE);
+        gran = ps > 0 ? static_cast<std::size_t>(ps) : PAGE;
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+            return false;
+        size = static_cast<std::uint64_t>(st.st_size);
+        return true;
+    }
+    void closeFile()
+    {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+    bool growTo(std::uint64_t pages) { return ftruncate(fd, static_cast<off_t>(pages * PAGE)) == 0; }
+    std::uint8_t *mapPage(std::uint64_t page, void **view) const
+    {
+        std::uint64_t off = page * PAGE, base = off / gran * gran;
+        void *v = mmap(nullptr, off - base + PAGE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(base));
+        if (v == MAP_FAILED)
+            return nullptr;
+        *view = v;
+        return static_cast<std::uint8_t *>(v) + (off - base);
+    }
+    static void unmapPage(void *view, const std::uint8_t *page)
+    {
+        munmap(view, static_cast<std::size_t>(page - static_cast<std::uint8_t *>(view)) + PAGE);
+    }
+    static bool syncPage(void *view, const std::uint8_t *page)
+    {
+        return msync(view, static_cast<std::size_t>(page - static_cast<std::uint8_t *>(view)) + PAGE, MS_SYNC) == 0;
+    }
+    bool syncFile() { return fsync(fd) == 0; }
+#endif
+};
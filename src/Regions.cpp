@@ -0,0 +1,225 @@
+#include "Regions.hpp"
+#include <utility>
+
+namespace
+{
+    constexpr int DIRS[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+}
+
+std::uint32_t RegionIndex::find(std::uint32_t i) const
+{
+    while (stones[i].parent != i)
+        i = stones[i].parent;
+    return i;
+}
+
+void RegionIndex::reset(const Board &b)
+{
+    count = 0;
+    mergeCount = 0;
+    roots.clear();
+    idAt.clear();
+    rescans = 0;
+    pending.clear();
+    for (const UndoRecord &r : b.history())
+        pending.emplace_back(r.x, r.y);
+}
+
+void RegionIndex::link_pending()
+{
+    for (const Move &m : pending)
+        add_stone(m.x, m.y);
+    pending.clear();
+}
+
+void RegionIndex::remove_root(std::uint32_t r)
+{
+    std::uint32_t pos = stones[r].rootPos, last = roots.back();
+    roots[pos] = last;
+    stones[last].rootPos = pos;
+    roots.pop_back();
+}
+
+void RegionIndex::add_stone(int x, int y)
+{
+    std::uint32_t i = static_cast<std::uint32_t>(count++);
+    if (stones.size() < count)
+        stones.emplace_back();
+    Stone &s = stones[i];
+    s.x = x;
+    s.y = y;
+    s.parent = s.next = i;
+    s.size = 1;
+    s.mergeFrom = static_cast<std::uint32_t>(mergeCount);
+    s.rootPos = static_cast<std::uint32_t>(roots.size());
+    s.score = s.scoreNeed = s.candRadius = 0;
+    roots.push_back(i);
+
+    // the distinct regions within LINK, joined one by one, smaller under larger
+    std::uint32_t near[(2 * LINK + 1) * (2 * LINK + 1)];
+    int nn = 0;
+    for (int dy = -LINK; dy <= LINK; ++dy)
+        for (int dx = -LINK; dx <= LINK; ++dx)
+            if (const std::uint32_t *id = idAt.find(x + dx, y + dy))
+            {
+                std::uint32_t r = find(*id);
+                bool seen = false;
+                for (int k = 0; k < nn && !seen; ++k)
+                    seen = near[k] == r;
+                if (!seen)
+                    near[nn++] = r;
+            }
+    idAt.insert(x, y, i);
+    std::uint32_t cur = i;
+    for (int k = 0; k < nn; ++k)
+    {
+        if (merges.size() == mergeCount)
+            merges.emplace_back();
+        Merge &m = merges[mergeCount++];
+        Stone &o = stones[near[k]];
+        m.other = near[k];
+        m.score = o.score;
+        m.scoreNeed = o.scoreNeed;
+        m.candRadius = o.candRadius;
+        std::swap(m.cand, o.cand);
+        o.scoreNeed = o.candRadius = 0;
+        std::uint32_t big = cur, small = near[k];
+        if (stones[small].size > stones[big].size)
+            std::swap(big, small);
+        m.child = small;
+        m.parent = big;
+        m.childPos = stones[small].rootPos;
+        remove_root(small);
+        stones[small].parent = big;
+        stones[big].size += stones[small].size;
+        std::swap(stones[small].next, stones[big].next); // splice the two circular lists
+        cur = big;
+    }
+    stones[cur].scoreNeed = stones[cur].candRadius = 0;
+}
+
+void RegionIndex::on_place(const Board &b)
+{
+    const std::vector<UndoRecord> &h = b.history();
+    if (h.size() != count + pending.size() + 1)
+        return reset(b);
+    pending.emplace_back(h.back().x, h.back().y);
+}
+
+void RegionIndex::on_undo(const Board &b)
+{
+    if (b.history().size() + 1 != count + pending.size())
+        return reset(b);
+    if (!pending.empty())
+    {
+        pending.pop_back();
+        return;
+    }
+    std::uint32_t i = static_cast<std::uint32_t>(count - 1);
+    for (std::size_t k = mergeCount; k-- > stones[i].mergeFrom;)
+    {
+        Merge &m = merges[k];
+        Stone &c = stones[m.child], &p = stones[m.parent];
+        std::swap(c.next, p.next);
+        p.size -= c.size;
+        c.parent = m.child;
+        // back to its old slot in `roots`; the root that filled the slot goes back to the end
+        if (m.childPos == roots.size())
+            roots.push_back(m.child);
+        else
+        {
+            std::uint32_t moved = roots[m.childPos];
+            stones[moved].rootPos = static_cast<std::uint32_t>(roots.size());
+            roots.push_back(moved);
+            roots[m.childPos] = m.child;
+        }
+        c.rootPos = m.childPos;
+        Stone &o = stones[m.other];
+        o.score = m.score;
+        o.scoreNeed = m.scoreNeed;
+        o.candRadius = m.candRadius;
+        std::swap(o.cand, m.cand);
+    }
+    mergeCount = stones[i].mergeFrom;
+    idAt.erase(stones[i].x, stones[i].y);
+    roots.pop_back(); // i, a singleton again at the end
+    --count;
+}
+
+void RegionIndex::rescore(const Board &b, std::uint32_t r, int need)
+{
+    int score = 0;
+    std::uint32_t k = r;
+    do
+    {
+        const Stone &s = stones[k];
+        Cell c = b.at(s.x, s.y);
+        for (auto &d : DIRS)
+        {
+            int v = b.line_score_from(s.x, s.y, d[0], d[1], c, need);
+            score += c == Cell::O ? v : -v;
+        }
+        ++rescans;
+        k = s.next;
+    } while (k != r);
+    stones[r].score = score;
+    stones[r].scoreNeed = need;
+}
+
+int RegionIndex::evaluate(const Board &b, int need)
+{
+    link_pending();
+    int score = 0;
+    for (std::uint32_t r : roots)
+    {
+        if (stones[r].scoreNeed != need)
+            rescore(b, r, need);
+        score += stones[r].score;
+    }
+    return score;
+}
+
+void RegionIndex::recollect(const Board &b, std::uint32_t r, CandidateMarks &marks, int radius)
+{
+    std::vector<Move> &out = stones[r].cand;
+    out.clear();
+    marks.next_epoch();
+    std::uint32_t k = r;
+    do
+    {
+        const Stone &s = stones[k];
+        for (int dx = -radius; dx <= radius; ++dx)
+            for (int dy = -radius; dy <= radius; ++dy)
+            {
+                int nx = s.x + dx, ny = s.y + dy;
+                if (b.is_empty(nx, ny) && marks.mark(nx, ny))
+                    out.emplace_back(nx, ny);
+            }
+        ++rescans;
+        k = s.next;
+    } while (k != r);
+    stones[r].candRadius = radius;
+}
+
+std::size_t RegionIndex::candidates(const Board &b, Move *out, std::size_t cap, CandidateMarks &marks, int radius)
+{
+    link_pending();
+    for (std::uint32_t r : roots)
+        if (stones[r].candRadius != radius)
+            recollect(b, r, marks, radius);
+    // lists of regions closer than 2 * radius may share cells
+    marks.next_epoch();
+    std::size_t n = 0;
+    for (std::uint32_t r : roots)
+        for (const Move &m : stones[r].cand)
+            if (n < cap && marks.mark(m.x, m.y))
+                out[n++] = m;
+    return n;
+}
+
+std::size_t RegionIndex::region_size(int x, int y)
+{
+    link_pending();
+    const std::uint32_t *id = idAt.find(x, y);
+    return id ? stones[find(*id)].size : 0;
+}
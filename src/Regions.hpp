@@ -0,0 +1,90 @@
+#pragma once
+#include "Board.hpp"
+#include <cstdint>
+#include <vector>
+
+// Connected regions of stones, for boards where play splits into distant clusters.
+//
+// Two stones share a region when they are at most LINK cells apart (Chebyshev), so
+// clusters separated by a gap of LINK empty cells or more are separate regions. A stone's
+// line score in Board::evaluate depends only on its run and the cells just past it, and
+// a candidate within radius <= LINK of a stone is linked to it, so each region keeps its
+// own evaluation and its own candidate list, and both stay exact.
+//
+// Attached to a board (Board::attach_regions), the index follows every place/undo, and
+// Board::evaluate and Board::candidates answer from it. A move dirties only its own region.
+// Evaluation then costs the moved-in cluster plus one add per other region, and candidates
+// are copied from the clean regions' lists. Undo restores the caches the move replaced.
+//
+// The regions are a union-find over the stones, by history index, with union by size
+// and no path compression, so a LIFO undo unlinks its merges in reverse. Stones join
+// lazily: place/undo only queue them, and the next query links the queue. The search's
+// many place/is_win_from/undo probes then cost nothing extra. Removing a stone below the
+// top of the history rebuilds the index. Output order is region by region, in creation
+// order, so candidates come out in another order than without the index.
+class RegionIndex
+{
+public:
+    static constexpr int LINK = 4;
+
+    // rebuild from scratch (linked on the next query, O(stones * (2 LINK + 1)^2)); drops
+    // every cache
+    void reset(const Board &b);
+    // the top of b.history() was just placed
+    void on_place(const Board &b);
+    // the top of the history was just undone
+    void on_undo(const Board &b);
+
+    // Board::evaluate(need) summed from the per-region caches
+    int evaluate(const Board &b, int need);
+    // Board::candidates' moves, region by region; radius must be <= LINK
+    std::size_t candidates(const Board &b, Move *out, std::size_t cap, CandidateMarks &marks, int radius);
+
+    std::size_t regions()
+    {
+        link_pending();
+        return roots.size();
+    }
+    // stones in the region of the stone at (x, y), 0 if there is none
+    std::size_t region_size(int x, int y);
+    // stones whose line scores or neighbourhoods were recomputed since reset
+    std::uint64_t rescanned() const { return rescans; }
+
+private:
+    struct Stone
+    {
+        int x, y;
+        std::uint32_t parent, size, next; // next: circular list of the region's stones
+        std::uint32_t mergeFrom;          // first of this stone's entries in `merges`
+        std::uint32_t rootPos;            // index in `roots` while a root
+        // caches, meaningful while a root: scoreNeed / candRadius 0 mean stale
+        int score, scoreNeed, candRadius;
+        std::vector<Move> cand;
+    };
+    // a region absorbed when a stone was placed, with the caches it had
+    struct Merge
+    {
+        std::uint32_t child, parent; // after the union
+        std::uint32_t childPos;      // child's index in `roots` before it was removed
+        std::uint32_t other;         // the neighbouring root the stone joined
+        int score, scoreNeed, candRadius;
+        std::vector<Move> cand; // swapped with other's list, so no copies
+    };
+
+    // entries past count / mergeCount keep their buffers, so place/undo stop allocating
+    std::vector<Stone> stones;
+    std::size_t count = 0;
+    std::vector<Merge> merges;
+    std::size_t mergeCount = 0;
+    std::vector<Move> pending; // placed after the first `count` stones, not linked yet
+    std::vector<std::uint32_t> roots;
+    FlatMap<std::uint32_t> idAt;
+    std::uint64_t rescans = 0;
+
+    std::uint32_t find(std::uint32_t i) const;
+    void remove_root(std::uint32_t r);
+    void add_stone(int x, int y);
+    void link_pending();
+    void rescore(const Board &b, std::uint32_t r, int need);
+    void recollect(const Board &b, std::uint32_t r, CandidateMarks &marks, int radius);
+};
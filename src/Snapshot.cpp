@@ -0,0 +1,226 @@
+#include "Snapshot.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::is_trivially_copyable<TTEntry>::value, "the TT section is raw TTEntry memory");
+static_assert(snap::TT_ALIGN % alignof(TTEntry) == 0, "mapped entries must stay aligned");
+
+namespace
+{
+    void put_u32(std::vector<std::uint8_t> &out, std::uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+    }
+    void put_u64(std::vector<std::uint8_t> &out, std::uint64_t v)
+    {
+        put_u32(out, static_cast<std::uint32_t>(v));
+        put_u32(out, static_cast<std::uint32_t>(v >> 32));
+    }
+    std::uint32_t get_u32(const std::uint8_t *p)
+    {
+        return p[0] | (std::uint32_t(p[1]) << 8) | (std::uint32_t(p[2]) << 16) | (std::uint32_t(p[3]) << 24);
+    }
+    std::uint64_t get_u64(const std::uint8_t *p)
+    {
+        return get_u32(p) | (std::uint64_t(get_u32(p + 4)) << 32);
+    }
+    std::int32_t get_i32(const std::uint8_t *p) { return static_cast<std::int32_t>(get_u32(p)); }
+
+    bool fail(std::string *error, const char *what)
+    {
+        if (error)
+            *error = what;
+        return false;
+    }
+}
+
+namespace snap
+{
+    bool MappedFile::open(const std::string &path)
+    {
+        close();
+#ifdef _WIN32
+        HANDLE fh = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fh == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER sz;
+        HANDLE mh = nullptr;
+        void *view = nullptr;
+        if (GetFileSizeEx(fh, &sz) && sz.QuadPart > 0)
+        {
+            mh = CreateFileMappingA(fh, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+            view = mh ? MapViewOfFile(mh, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+        }
+        if (!view)
+        {
+            if (mh)
+                CloseHandle(mh);
+            CloseHandle(fh);
+            return false;
+        }
+        file = fh;
+        mapping = mh;
+        base = static_cast<std::uint8_t *>(view);
+        len = (std::size_t)sz.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *view = mmap(nullptr, (std::size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED)
+            return false;
+        base = static_cast<std::uint8_t *>(view);
+        len = (std::size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (base)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(base);
+            CloseHandle(mapping);
+            CloseHandle(file);
+            mapping = file = nullptr;
+#else
+            munmap(base, len);
+#endif
+        }
+        base = nullptr;
+        len = 0;
+    }
+
+    bool save(const std::string &path, const Board &b, const AI *ai, std::string *error)
+    {
+        const std::vector<UndoRecord> &hist = b.history();
+        const TTEntry *tt = ai ? ai->tt_data() : nullptr;
+        std::uint64_t ttEntries = tt ? ai->tt_size() : 0;
+        std::uint64_t boardEnd = HEADER_SIZE + hist.size() * RECORD_SIZE;
+        std::uint64_t ttOffset = ttEntries ? (boardEnd + TT_ALIGN - 1) / TT_ALIGN * TT_ALIGN : 0;
+
+        std::vector<std::uint8_t> out;
+        out.reserve(ttEntries ? ttOffset : boardEnd);
+        out.insert(out.end(), MAGIC, MAGIC + 8);
+        put_u32(out, VERSION);
+        put_u32(out, 0);
+        put_u64(out, hist.size());
+        put_u64(out, b.hash());
+        put_u64(out, ttEntries);
+        put_u64(out, ttOffset);
+        put_u32(out, RECORD_SIZE);
+        put_u32(out, sizeof(TTEntry));
+        out.resize(out.size() + 4);
+        std::memcpy(&out[out.size() - 4], &ORDER_TAG, 4);
+        put_u32(out, 0);
+        for (const UndoRecord &r : hist)
+        {
+            put_u32(out, static_cast<std::uint32_t>(r.x));
+            put_u32(out, static_cast<std::uint32_t>(r.y));
+            put_u32(out, static_cast<std::uint32_t>(r.minX));
+            put_u32(out, static_cast<std::uint32_t>(r.maxX));
+            put_u32(out, static_cast<std::uint32_t>(r.minY));
+            put_u32(out, static_cast<std::uint32_t>(r.maxY));
+            put_u32(out, static_cast<std::uint32_t>(r.who));
+            put_u32(out, 0);
+            put_u64(out, r.zkey);
+        }
+        if (ttEntries)
+            out.resize(ttOffset);
+
+        std::string tmp = path + ".tmp";
+        std::FILE *f = std::fopen(tmp.c_str(), "wb");
+        if (!f)
+            return fail(error, "cannot create file");
+        bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+        if (ok && ttEntries)
+            ok = std::fwrite(tt, sizeof(TTEntry), ttEntries, f) == ttEntries;
+        ok = std::fclose(f) == 0 && ok;
+        std::error_code ec;
+        if (ok)
+            std::filesystem::rename(tmp, path, ec);
+        if (!ok || ec)
+        {
+            std::filesystem::remove(tmp, ec);
+            return fail(error, "write failed");
+        }
+        return true;
+    }
+
+    bool load(const std::string &path, Board &b, AI *ai, std::string *error)
+    {
+        auto file = std::make_shared<MappedFile>();
+        if (!file->open(path))
+            return fail(error, "cannot map file");
+        const std::uint8_t *p = file->data();
+        std::size_t len = file->size();
+        if (len < HEADER_SIZE || std::memcmp(p, MAGIC, 8) != 0)
+            return fail(error, "not a snapshot");
+        if (get_u32(p + 8) != VERSION)
+            return fail(error, "unsupported version");
+        std::uint64_t stones = get_u64(p + 16), zkey = get_u64(p + 24);
+        std::uint64_t ttEntries = get_u64(p + 32), ttOffset = get_u64(p + 40);
+        if (get_u32(p + 48) != RECORD_SIZE || stones > (len - HEADER_SIZE) / RECORD_SIZE)
+            return fail(error, "truncated board");
+
+        // replaying reproduces the bounding boxes and keys; comparing them catches
+        // other Zobrist keys and corrupt records
+        Board nb;
+        for (std::uint64_t i = 0; i < stones; ++i)
+        {
+            const std::uint8_t *r = p + HEADER_SIZE + i * RECORD_SIZE;
+            int x = get_i32(r), y = get_i32(r + 4);
+            std::uint32_t who = get_u32(r + 24);
+            if ((who != std::uint32_t(Cell::X) && who != std::uint32_t(Cell::O)) || !nb.place(x, y, Cell(who)))
+                return fail(error, "bad stone");
+            const UndoRecord &u = nb.history().back();
+            if (u.minX != get_i32(r + 8) || u.maxX != get_i32(r + 12) || u.minY != get_i32(r + 16) ||
+                u.maxY != get_i32(r + 20) || u.zkey != get_u64(r + 32))
+                return fail(error, "history mismatch");
+        }
+        if (nb.hash() != zkey)
+            return fail(error, "hash mismatch");
+
+        std::shared_ptr<TTEntry> table;
+        if (ai && ttEntries)
+        {
+            std::uint32_t order;
+            std::memcpy(&order, p + 56, 4);
+            if (get_u32(p + 52) != sizeof(TTEntry) || order != ORDER_TAG)
+                return fail(error, "table from another architecture");
+            if ((ttEntries & (ttEntries - 1)) != 0 || ttOffset % TT_ALIGN != 0 || ttOffset < HEADER_SIZE + stones * RECORD_SIZE ||
+                ttOffset > len || ttEntries > (len - ttOffset) / sizeof(TTEntry))
+                return fail(error, "truncated table");
+            // the entries share ownership of the mapping
+            table = std::shared_ptr<TTEntry>(file, reinterpret_cast<TTEntry *>(file->data() + ttOffset));
+        }
+        b = std::move(nb);
+        if (table)
+            ai->adopt_tt(std::move(table), ttEntries);
+        return true;
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "Board.hpp"
+#include "AI.hpp"
+#include <cstdint>
+#include <string>
+
+// Engine snapshot: a board with its undo history and an AI's transposition table, for
+// restarting a long analysis without re-searching.
+//
+//   file    := header board [pad tt]
+//   header  := "TTT4SNAP" u32 version u32 0
+//              u64 stones u64 zkey u64 ttEntries u64 ttOffset
+//              u32 recordBytes u32 ttEntryBytes u32 orderTag u32 0       (64 bytes)
+//   board   := stones x (i32 x, y, minX, maxX, minY, maxY, u32 who, u32 0, u64 zkey)
+//              one UndoRecord per stone, oldest first                   (40 bytes each)
+//   tt      := ttEntries x TTEntry, raw, at a page-aligned ttOffset
+//
+// Header and board are little-endian. The TT is the in-memory TTEntry array as is, so
+// load() maps it copy-on-write and hands it to the AI without reading it: pages come in
+// as the search touches them and writes stay private. orderTag (0x01020304 written
+// natively) and ttEntryBytes reject a table from another architecture. The board is
+// replayed and every record compared with the saved one, so a file written with other
+// Zobrist keys is refused rather than giving a board whose hash misses the table.
+namespace snap
+{
+    constexpr char MAGIC[8] = {'T', 'T', 'T', '4', 'S', 'N', 'A', 'P'};
+    constexpr std::uint32_t VERSION = 1;
+    constexpr std::size_t HEADER_SIZE = 64;
+    constexpr std::size_t RECORD_SIZE = 40;
+    constexpr std::size_t TT_ALIGN = 4096;
+    constexpr std::uint32_t ORDER_TAG = 0x01020304;
+
+    // Whole-file private mapping: read on first touch, writes never reach the file.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile() { close(); }
+
+        bool open(const std::string &path);
+        void close();
+        std::uint8_t *data() const { return base; }
+        std::size_t size() const { return len; }
+
+    private:
+        std::uint8_t *base = nullptr;
+        std::size_t len = 0;
+#ifdef _WIN32
+        void *file = nullptr, *mapping = nullptr;
+#endif
+    };
+
+    // Writes `b` and, when `ai` has searched, its TT. The file is written next to `path`
+    // and renamed over it, so a crash never leaves a torn snapshot.
+    bool save(const std::string &path, const Board &b, const AI *ai, std::string *error = nullptr);
+    // Restores `b` (any attached accumulator is dropped) and, if `ai` is given and the
+    // file has a table, makes the mapped table the AI's TT. On failure nothing changes.
+    bool load(const std::string &path, Board &b, AI *ai, std::string *error = nullptr);
+}
@@ -0,0 +1,277 @@
+#include "Solver.hpp"
+#include "Zobrist.hpp"
+#include <algorithm>
+
+namespace
+{
+    constexpr std::uint32_t INF = 100000000u;
+    constexpr int DIRS[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+
+    inline Cell other(Cell c) { return c == Cell::X ? Cell::O : Cell::X; }
+    inline std::uint32_t clamp_inf(std::uint64_t v) { return v >= INF ? INF : static_cast<std::uint32_t>(v); }
+}
+
+Solver::Solver(const SolverLimits &limits) : lim(limits)
+{
+    std::size_t buckets = lim.tableBytes / (sizeof(Entry) * WAYS);
+    std::size_t p = 1;
+    while (p * 2 <= buckets)
+        p *= 2;
+    table.assign(p * WAYS, Entry{});
+    bucketMask = p - 1;
+}
+
+void Solver::clear()
+{
+    std::fill(table.begin(), table.end(), Entry{});
+}
+
+std::uint64_t Solver::key_of(std::uint64_t hash, bool attackerToMove) const
+{
+    // the same stones are a different node per attacker colour and side to move
+    return hash ^ (attacker == Cell::O ? 0x3C6EF372FE94F82BULL : 0xA54FF53A5F1D36F1ULL) ^
+           (attackerToMove ? 0x510E527FADE682D1ULL : 0);
+}
+
+Solver::Entry Solver::lookup(std::uint64_t key) const
+{
+    const Entry *bucket = &table[(key & bucketMask) * WAYS];
+    for (int i = 0; i < WAYS; ++i)
+        if (bucket[i].key == key)
+            return bucket[i];
+    Entry e;
+    e.key = key;
+    return e;
+}
+
+void Solver::store(const Entry &e)
+{
+    // same key in place, otherwise evict the entry that cost the least to compute
+    Entry *bucket = &table[(e.key & bucketMask) * WAYS];
+    Entry *victim = bucket;
+    for (int i = 0; i < WAYS; ++i)
+    {
+        if (bucket[i].key == e.key)
+        {
+            victim = &bucket[i];
+            break;
+        }
+        if (bucket[i].work < victim->work)
+            victim = &bucket[i];
+    }
+    *victim = e;
+}
+
+void Solver::win_squares(const Board &b, Cell who, std::vector<Move> &out, std::size_t limit) const
+{
+    out.clear();
+    for (const UndoRecord &r : b.history())
+    {
+        if (r.who != who)
+            continue;
+        for (auto &d : DIRS)
+            for (int s = 0; s < 4; ++s)
+            {
+                int sx = r.x - s * d[0], sy = r.y - s * d[1];
+                int own = 0, empties = 0;
+                Move gap;
+                for (int k = 0; k < 4; ++k)
+                {
+                    Cell c = b.at(sx + k * d[0], sy + k * d[1]);
+                    if (c == who)
+                        ++own;
+                    else if (c == Cell::Empty)
+                    {
+                        ++empties;
+                        gap = Move{sx + k * d[0], sy + k * d[1]};
+                    }
+                }
+                if (own == 3 && empties == 1 && std::find(out.begin(), out.end(), gap) == out.end())
+                {
+                    out.push_back(gap);
+                    if (out.size() >= limit)
+                        return;
+                }
+            }
+    }
+}
+
+void Solver::threat_moves(const Board &b, Cell who, std::vector<Move> &out) const
+{
+    out.clear();
+    for (const UndoRecord &r : b.history())
+    {
+        if (r.who != who)
+            continue;
+        for (auto &d : DIRS)
+            for (int s = 0; s < 4; ++s)
+            {
+                int sx = r.x - s * d[0], sy = r.y - s * d[1];
+                int own = 0, empties = 0;
+                Move gaps[4];
+                for (int k = 0; k < 4; ++k)
+                {
+                    Cell c = b.at(sx + k * d[0], sy + k * d[1]);
+                    if (c == who)
+                        ++own;
+                    else if (c == Cell::Empty)
+                        gaps[empties++] = Move{sx + k * d[0], sy + k * d[1]};
+                }
+                if (own == 2 && empties == 2)
+                {
+                    out.push_back(gaps[0]);
+                    out.push_back(gaps[1]);
+                }
+            }
+    }
+    std::sort(out.begin(), out.end(), [](const Move &a, const Move &c)
+              { return a.x != c.x ? a.x < c.x : a.y < c.y; });
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+bool Solver::expand(Board &b, int ply, bool attackerToMove, Entry &e)
+{
+    Cell me = attackerToMove ? attacker : other(attacker);
+    std::vector<Move> &children = moves[ply];
+    children.clear();
+    e.size = 1;
+
+    win_squares(b, me, scratch, 1);
+    if (!scratch.empty())
+    {
+        e.phi = 0; // wins on the spot
+        e.delta = INF;
+        return true;
+    }
+    win_squares(b, other(me), scratch, 2);
+    if (scratch.size() >= 2)
+    {
+        e.phi = INF; // cannot block two fours
+        e.delta = 0;
+        return true;
+    }
+    if (scratch.size() == 1)
+        children.push_back(scratch[0]); // the only move that does not lose
+    else if (attackerToMove)
+        threat_moves(b, me, children);
+
+    if (children.empty() || ply >= lim.maxDepth)
+    {
+        // attacker out of threats, or the defender is free: not provable here
+        e.phi = attackerToMove ? INF : 0;
+        e.delta = attackerToMove ? 0 : INF;
+        return true;
+    }
+    return false;
+}
+
+Solver::Entry Solver::mid(Board &b, int ply, bool attackerToMove, std::uint32_t thPhi, std::uint32_t thDelta)
+{
+    Entry e = lookup(key_of(b.hash(), attackerToMove));
+    if (e.phi >= thPhi || e.delta >= thDelta)
+        return e;
+    if (++nodes > lim.maxNodes)
+    {
+        aborted = true;
+        return e;
+    }
+    if (expand(b, ply, attackerToMove, e))
+    {
+        e.work = 1;
+        store(e);
+        return e;
+    }
+
+    Cell me = attackerToMove ? attacker : other(attacker);
+    const std::vector<Move> &children = moves[ply];
+    const ZobristHash &z = ZobristHash::instance();
+    std::uint64_t startNodes = nodes;
+    while (true)
+    {
+        // phi = min child delta, delta = sum of child phi
+        std::uint64_t sumPhi = 0;
+        std::uint32_t d1 = INF, d2 = INF;
+        std::size_t best = 0;
+        for (std::size_t i = 0; i < children.size(); ++i)
+        {
+            const Move &m = children[i];
+            Entry c = lookup(key_of(b.hash() ^ z.key_for(Coord{m.x, m.y}, me), !attackerToMove));
+            sumPhi += c.phi;
+            if (c.delta < d1)
+            {
+                d2 = d1;
+                d1 = c.delta;
+                best = i;
+            }
+            else if (c.delta < d2)
+                d2 = c.delta;
+        }
+        e.phi = d1;
+        e.delta = clamp_inf(sumPhi);
+        if (e.phi >= thPhi || e.delta >= thDelta || aborted)
+            break;
+
+        const Move m = children[best];
+        Entry c = lookup(key_of(b.hash() ^ z.key_for(Coord{m.x, m.y}, me), !attackerToMove));
+        std::uint32_t childPhi = clamp_inf(static_cast<std::uint64_t>(thDelta) + c.phi - e.delta);
+        std::uint32_t childDelta = std::min(thPhi, clamp_inf(static_cast<std::uint64_t>(d2) + 1));
+        b.place(m.x, m.y, me);
+        mid(b, ply + 1, !attackerToMove, childPhi, childDelta);
+        b.undo(m.x, m.y);
+    }
+
+    // proof tree: one refuting child for a win, every child for a loss
+    if (e.phi == 0 || e.delta == 0)
+    {
+        std::uint64_t size = 1, minWin = INF;
+        for (const Move &m : children)
+        {
+            Entry c = lookup(key_of(b.hash() ^ z.key_for(Coord{m.x, m.y}, me), !attackerToMove));
+            if (c.delta == 0)
+                minWin = std::min<std::uint64_t>(minWin, c.size);
+            size += c.size;
+        }
+        e.size = clamp_inf(e.phi == 0 ? 1 + (minWin == INF ? 0 : minWin) : size);
+    }
+    e.work = clamp_inf(nodes - startNodes + 1);
+    store(e);
+    return e;
+}
+
+Solver::Entry Solver::run(Board &b, Cell att, bool attackerToMove)
+{
+    attacker = att;
+    aborted = false;
+    return mid(b, 0, attackerToMove, INF, INF);
+}
+
+SolveResult Solver::solve(Board &b, Cell toMove)
+{
+    SolveResult r;
+    nodes = 0;
+    if (moves.size() < static_cast<std::size_t>(lim.maxDepth) + 1)
+        moves.resize(lim.maxDepth + 1);
+
+    Entry win = run(b, toMove, true);
+    if (!aborted && win.phi == 0)
+    {
+        r.outcome = SolveResult::Win;
+        r.proofSize = win.size;
+    }
+    else if (!aborted)
+    {
+        // a loss needs the opponent to be threatening already: then every reply is forced
+        win_squares(b, other(toMove), scratch, 1);
+        if (!scratch.empty())
+        {
+            Entry loss = run(b, other(toMove), false);
+            if (!aborted && loss.delta == 0)
+            {
+                r.outcome = SolveResult::Loss;
+                r.proofSize = loss.size;
+            }
+        }
+    }
+    r.nodes = nodes;
+    return r;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "Board.hpp"
+#include <cstdint>
+#include <vector>
+
+// Depth-first proof-number search (df-pn) restricted to threat sequences.
+//
+// The attacker may only play moves that make a threat (three of a four-window with
+// the fourth cell empty) or answer the defender's single threat; the defender's
+// replies are complete (win now or block the one threat), so a proven win is a real
+// win. A position is a loss when the opponent already threatens and wins the same
+// way. Anything else — including budget or depth exhaustion — is Unknown.
+struct SolverLimits
+{
+    std::uint64_t maxNodes = 1000000;     // expanded nodes per solve()
+    std::size_t tableBytes = 16u << 20;   // transposition table size
+    int maxDepth = 80;                    // plies; deeper lines count as not proven
+};
+
+struct SolveResult
+{
+    enum Outcome
+    {
+        Unknown = 0,
+        Win = 1, // the side to move wins
+        Loss = 2
+    } outcome{Unknown};
+    std::uint64_t nodes{0};      // nodes expanded (both passes)
+    std::uint32_t proofSize{0};  // nodes in the proof tree (as far as the table still holds it), 0 when Unknown
+};
+
+class Solver
+{
+public:
+    explicit Solver(const SolverLimits &limits = SolverLimits{});
+
+    // Board is restored on return
+    SolveResult solve(Board &b, Cell toMove);
+    void clear();
+    const SolverLimits &limits() const { return lim; }
+
+private:
+    // phi/delta are the proof/disproof numbers for the side to move at the entry
+    struct Entry
+    {
+        std::uint64_t key{0};
+        std::uint32_t phi{1}, delta{1};
+        std::uint32_t work{0}; // nodes spent below, for replacement
+        std::uint32_t size{0}; // proof-tree size once phi or delta is 0
+    };
+    static constexpr int WAYS = 4;
+
+    SolverLimits lim;
+    std::vector<Entry> table; // buckets of WAYS entries
+    std::size_t bucketMask{0};
+
+    Cell attacker{Cell::O};
+    std::uint64_t nodes{0};
+    bool aborted{false};
+    std::vector<std::vector<Move>> moves; // ply-indexed children
+    std::vector<Move> scratch;
+
+    std::uint64_t key_of(std::uint64_t hash, bool attackerToMove) const;
+    Entry lookup(std::uint64_t key) const;
+    void store(const Entry &e);
+
+    // terminal check + children; returns true if the node is decided (phi/delta/size set)
+    bool expand(Board &b, int ply, bool attackerToMove, Entry &e);
+    Entry mid(Board &b, int ply, bool attackerToMove, std::uint32_t thPhi, std::uint32_t thDelta);
+    Entry run(Board &b, Cell att, bool attackerToMove);
+
+    // empty cells completing four for `who`; stops after `limit` distinct cells
+    void win_squares(const Board &b, Cell who, std::vector<Move> &out, std::size_t limit) const;
+    // empty cells that create at least one winning square for `who`
+    void threat_moves(const Board &b, Cell who, std::vector<Move> &out) const;
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Scoped trace points for a Chrome / Perfetto timeline (chrome://tracing, ui.perfetto.dev).
+//
+//   TTT_TRACE_SCOPE("Board::evaluate");   // one complete event for the enclosing scope
+//   trace::set_thread_name("ai");         // label for the calling thread's track
+//
+// Without -DTTT_TRACE the macro expands to nothing and the functions are empty, so trace
+// points cost nothing in normal builds. With it, each thread appends to its own ring of
+// BUFFER_EVENTS events (single writer, no locks; a full ring overwrites its oldest
+// events), and at exit every ring is written as trace-event JSON to $TTT_TRACE_FILE
+// (default ttt4_trace.json). write_json() can also be called directly; events a thread
+// records during the write may be missing or torn.
+//
+// Names must be string literals: only the pointer is stored.
+#ifdef TTT_TRACE
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace trace
+{
+#ifdef TTT_TRACE
+    constexpr std::size_t BUFFER_EVENTS = std::size_t(1) << 18;
+
+    struct Event
+    {
+        const char *name;
+        std::uint64_t startNs, durNs;
+    };
+
+    // one thread's ring; written only by its thread, read by the flusher
+    struct Buffer
+    {
+        std::vector<Event> ring = std::vector<Event>(BUFFER_EVENTS);
+        std::atomic<std::uint64_t> written{0};
+        std::atomic<const char *> threadName{nullptr};
+        std::uint32_t tid = 0;
+    };
+
+    inline std::uint64_t now_ns()
+    {
+        static const auto t0 = std::chrono::steady_clock::now();
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+    }
+
+    inline bool write_json(const std::string &path);
+
+    // every thread's buffer; the lock is taken once per thread, on its first event, and
+    // when writing. Buffers outlive their threads so the exit flush still sees them.
+    class Registry
+    {
+    public:
+        ~Registry()
+        {
+            const char *path = std::getenv("TTT_TRACE_FILE");
+            write_json(path && *path ? path : "ttt4_trace.json");
+        }
+        Buffer *add()
+        {
+            std::lock_guard<std::mutex> lk(mx);
+            buffers.push_back(std::make_unique<Buffer>());
+            buffers.back()->tid = static_cast<std::uint32_t>(buffers.size());
+            return buffers.back().get();
+        }
+        template <class F>
+        void each(F &&fn)
+        {
+            std::lock_guard<std::mutex> lk(mx);
+            for (auto &b : buffers)
+                fn(*b);
+        }
+
+    private:
+        std::mutex mx;
+        std::vector<std::unique_ptr<Buffer>> buffers;
+    };
+    inline Registry registry;
+
+    inline Buffer &local()
+    {
+        static thread_local Buffer *buf = registry.add();
+        return *buf;
+    }
+
+    inline void record(const char *name, std::uint64_t startNs, std::uint64_t endNs)
+    {
+        Buffer &b = local();
+        std::uint64_t n = b.written.load(std::memory_order_relaxed);
+        b.ring[n % BUFFER_EVENTS] = {name, startNs, endNs - startNs};
+        b.written.store(n + 1, std::memory_order_release);
+    }
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char *n) : name(n), start(now_ns()) {}
+        ~Scope() { record(name, start, now_ns()); }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name;
+        std::uint64_t start;
+    };
+
+    inline void set_thread_name(const char *name) { local().threadName.store(name, std::memory_order_relaxed); }
+
+    inline bool write_json(const std::string &path)
+    {
+        std::FILE *f = std::fopen(path.c_str(), "w");
+        if (!f)
+            return false;
+        std::fprintf(f, "{\"traceEvents\":[\n");
+        bool first = true;
+        registry.each([&](Buffer &b)
+                      {
+            std::uint64_t n = b.written.load(std::memory_order_acquire);
+            const char *tn = b.threadName.load(std::memory_order_relaxed);
+            std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                         first ? "" : ",\n", b.tid, tn ? tn : "thread");
+            first = false;
+            for (std::uint64_t i = n > BUFFER_EVENTS ? n - BUFFER_EVENTS : 0; i < n; ++i)
+            {
+                const Event &e = b.ring[i % BUFFER_EVENTS];
+                std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", e.name, b.tid,
+                             e.startNs / 1000.0, e.durNs / 1000.0);
+            } });
+        std::fprintf(f, "\n]}\n");
+        return std::fclose(f) == 0;
+    }
+#else
+    inline void set_thread_name(const char *) {}
+    inline bool write_json(const std::string &) { return false; }
+#endif
+}
+
+#ifdef TTT_TRACE
+#define TTT_TRACE_CAT2(a, b) a##b
+#define TTT_TRACE_CAT(a, b) TTT_TRACE_CAT2(a, b)
+#define TTT_TRACE_SCOPE(name) ::trace::Scope TTT_TRACE_CAT(tttTraceScope, __LINE__)(name)
+#else
+#define TTT_TRACE_SCOPE(name) ((void)0)
+#endif
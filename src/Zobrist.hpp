@@ -1,12 +1,13 @@
 #pragma once
-#include <unordered_map>
-#include <array>
 #include <cstdint>
 #include "Coord.hpp"
 #include "Utils.hpp"
 #include "Board.hpp"
 
-// Zobrist hashing for sparse infinite board
+// Zobrist hashing for sparse infinite board.
+// Keys are a fixed mix of the coordinate and the stone colour rather than lazily drawn
+// random numbers: no shared table to guard, so boards on different threads (and in
+// different processes) agree on every key.
 class ZobristHash
 {
 public:
@@ -15,21 +16,18 @@ public:
         static ZobristHash z;
         return z;
     }
-    std::uint64_t key_for(const Coord &c, Cell who)
+    std::uint64_t key_for(const Coord &c, Cell who) const
     {
-        auto it = table.find(c);
-        if (it == table.end())
-        {
-            std::array<std::uint64_t, 3> arr{};
-            arr[1] = dist(rng());
-            arr[2] = dist(rng());
-            it = table.emplace(c, arr).first;
-        }
-        return (who == Cell::X) ? it->second[1] : it->second[2];
+        std::uint64_t v = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(c.x)) << 32) |
+                          static_cast<std::uint32_t>(c.y);
+        v ^= (who == Cell::X) ? 0xA57F1234C0FFEEULL : 0x5D1E7C0FFEE4321ULL;
+        // splitmix64 finalizer
+        v += 0x9E3779B97F4A7C15ULL;
+        v = (v ^ (v >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        v = (v ^ (v >> 27)) * 0x94D049BB133111EBULL;
+        return v ^ (v >> 31);
     }
 
 private:
-    std::unordered_map<Coord, std::array<std::uint64_t, 3>, CoordHasher> table;
-    std::uniform_int_distribution<std::uint64_t> dist;
-    ZobristHash() : dist(0, ~0ULL) {}
+    ZobristHash() = default;
 };
@@ -0,0 +1,229 @@
+// Offline analysis of many positions.
+//
+//   ttt4_batch [-j THREADS] [--depth D] [--movetime MS] [--hash ENTRIES] [--solve NODES] <positions> [results]
+//
+// One position per line: the moves in order, X first ("0,0 1,0 0,1"), optionally followed
+// by "depth N" and/or "movetime MS" overriding the defaults for that line. Empty lines
+// and lines starting with '#' are skipped. For every position one line is written, in
+// input order, as soon as it and all earlier ones are done:
+//
+//   <line> bestmove x,y score S depth D nodes N time MS [solve win|loss|unknown proof P nodes N]
+//
+// --solve also runs the threat-space df-pn solver (Solver.hpp) with that node budget.
+//
+// Positions are handed out to a pool of workers; each owns its AI and TT, so nothing
+// is shared on the search path. The TT is cleared per position to keep results
+// independent of scheduling. TTT_METRICS_FILE / TTT_METRICS_PORT export per-position
+// latency histograms (MetricsExport.hpp).
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.hpp"
+#include "AI.hpp"
+#include "MetricsExport.hpp"
+#include "Notation.hpp"
+#include "Solver.hpp"
+#include "Trace.hpp"
+
+namespace
+{
+    struct Job
+    {
+        int line{};
+        std::string text;
+    };
+
+    struct Limits
+    {
+        int depth{4};
+        int moveTime{0}; // 0 = depth only
+    };
+
+    struct alignas(64) Stats // one cache line per worker
+    {
+        long long nodes{};
+    };
+
+    std::string analyse(AI &ai, Solver *solver, Board &board, const Job &job, Limits lim, long long &nodes)
+    {
+        std::istringstream ss(job.text);
+        std::vector<Move> moves;
+        std::string tok;
+        while (ss >> tok)
+        {
+            Move m;
+            if (tok == "depth")
+                ss >> lim.depth;
+            else if (tok == "movetime")
+                ss >> lim.moveTime;
+            else if (parse_move(tok, m))
+                moves.push_back(m);
+            else
+                return std::to_string(job.line) + " error bad token " + tok;
+        }
+        std::size_t n = load_game(board, moves);
+        if (n < moves.size())
+            return std::to_string(job.line) + " error illegal move " + format_move(moves[n]);
+
+        int score = 0, depth = 0;
+        ai.set_info_callback([&](const SearchInfo &i)
+                             {
+            score = i.score;
+            depth = i.depth; });
+        ai.set_mode(AI::ID_DEEPEN);
+        ai.set_depth(lim.depth);
+        ai.set_time_budget(lim.moveTime > 0 ? lim.moveTime : (1 << 30));
+        ai.clear_tt();
+        Timer t;
+        Move best = ai.choose_move(board);
+        nodes += ai.nodes();
+        std::string r = std::to_string(job.line) + " bestmove " + format_move(best) + " score " + std::to_string(score) +
+                        " depth " + std::to_string(depth) + " nodes " + std::to_string(ai.nodes()) +
+                        " time " + std::to_string(t.elapsed_ms());
+        if (solver)
+        {
+            static const char *names[] = {"unknown", "win", "loss"};
+            solver->clear();
+            SolveResult sr = solver->solve(board, Cell::O); // load_game gives the side to move O
+            nodes += static_cast<long long>(sr.nodes);
+            r += std::string(" solve ") + names[sr.outcome] + " proof " + std::to_string(sr.proofSize) +
+                 " nodes " + std::to_string(sr.nodes);
+        }
+        return r;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    Limits lim;
+    std::size_t hash = std::size_t(1) << 16;
+    long long solveNodes = 0;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        if (a == "-j" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (a == "--depth" && i + 1 < argc)
+            lim.depth = std::atoi(argv[++i]);
+        else if (a == "--movetime" && i + 1 < argc)
+            lim.moveTime = std::atoi(argv[++i]);
+        else if (a == "--hash" && i + 1 < argc)
+            hash = static_cast<std::size_t>(std::atoll(argv[++i]));
+        else if (a == "--solve" && i + 1 < argc)
+            solveNodes = std::atoll(argv[++i]);
+        else
+            files.push_back(a);
+    }
+    if (files.empty() || files.size() > 2)
+    {
+        std::cerr << "usage: ttt4_batch [-j THREADS] [--depth D] [--movetime MS] [--hash ENTRIES] [--solve NODES] <positions> [results]\n";
+        return 2;
+    }
+    if (threads < 1)
+        threads = 1;
+    metrics::Exporter exporter;
+    std::string err;
+    if (!exporter.start_from_env(&err) && !err.empty())
+        std::cerr << "metrics: " << err << '\n';
+
+    std::ifstream in(files[0]);
+    if (!in)
+    {
+        std::cerr << "cannot open " << files[0] << '\n';
+        return 1;
+    }
+    std::vector<Job> jobs;
+    std::string text;
+    for (int line = 1; std::getline(in, text); ++line)
+    {
+        std::size_t p = text.find_first_not_of(" \t\r");
+        if (p == std::string::npos || text[p] == '#')
+            continue;
+        jobs.push_back(Job{line, text});
+    }
+
+    std::ofstream outFile;
+    if (files.size() == 2)
+    {
+        outFile.open(files[1]);
+        if (!outFile)
+        {
+            std::cerr << "cannot open " << files[1] << '\n';
+            return 1;
+        }
+    }
+    std::ostream &out = files.size() == 2 ? static_cast<std::ostream &>(outFile) : std::cout;
+
+    std::vector<std::string> results(jobs.size());
+    std::vector<char> ready(jobs.size(), 0);
+    std::mutex mx;
+    std::condition_variable cv;
+    std::atomic<std::size_t> next{0};
+    std::vector<Stats> stats(threads);
+
+    Timer total;
+    std::vector<std::thread> pool;
+    for (int w = 0; w < threads; ++w)
+        pool.emplace_back([&, w]
+                          {
+            trace::set_thread_name("batch worker");
+            AI ai;
+            ai.set_tt_entries(hash);
+            ai.set_pattern_eval(pattern_eval::startup_weights()); // TTT_EVAL_WEIGHTS, if set
+            Board board;
+            std::unique_ptr<Solver> solver;
+            if (solveNodes > 0)
+            {
+                SolverLimits sl;
+                sl.maxNodes = static_cast<std::uint64_t>(solveNodes);
+                solver = std::make_unique<Solver>(sl);
+            }
+            for (std::size_t i; (i = next.fetch_add(1)) < jobs.size();)
+            {
+                std::string r = analyse(ai, solver.get(), board, jobs[i], lim, stats[w].nodes);
+                std::lock_guard<std::mutex> lk(mx);
+                results[i] = std::move(r);
+                ready[i] = 1;
+                cv.notify_one();
+            } });
+
+    // stream results in input order
+    for (std::size_t i = 0; i < jobs.size(); ++i)
+    {
+        std::string r;
+        bool more;
+        {
+            std::unique_lock<std::mutex> lk(mx);
+            cv.wait(lk, [&]
+                    { return ready[i] != 0; });
+            r.swap(results[i]);
+            more = i + 1 < jobs.size() && ready[i + 1];
+        }
+        out << r << '\n';
+        if (!more)
+            out.flush();
+    }
+    for (auto &t : pool)
+        t.join();
+
+    long long nodes = 0;
+    for (const Stats &s : stats)
+        nodes += s.nodes;
+    double sec = total.elapsed_ms() / 1000.0;
+    if (sec <= 0)
+        sec = 0.001;
+    std::cerr << jobs.size() << " positions in " << sec << " s with " << threads << " threads: "
+              << static_cast<long long>(jobs.size() / sec) << " positions/s, "
+              << static_cast<long long>(nodes / sec) << " nodes/s\n";
+    return 0;
+}
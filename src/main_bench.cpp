@@ -0,0 +1,177 @@
+// Coordinate-map benchmark: the node-based unordered_map the boards used to keep their
+// stones in against FlatMap, on a marathon-sized position.
+//
+//   ttt4_bench [--stones N] [--lookups M] [--map both|flat|node]
+//
+// The stones fill a square blob in random order, as a long game grows it. Per map the
+// bench reports build time, lookup time for occupied cells and for empty neighbours,
+// heap bytes per stone (counted by the allocator) and the process RSS after the build.
+// RSS is only meaningful for the first map built, so compare it with --map flat and
+// --map node in separate runs.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Board.hpp"
+#include "FlatMap.hpp"
+#include "Metrics.hpp"
+
+namespace
+{
+    std::size_t g_heapBytes = 0;
+
+    // counts what the node-based map asks for; FlatMap reports its own memory_bytes()
+    template <class T>
+    struct CountingAllocator
+    {
+        using value_type = T;
+        CountingAllocator() = default;
+        template <class U>
+        CountingAllocator(const CountingAllocator<U> &) noexcept {}
+        T *allocate(std::size_t n)
+        {
+            g_heapBytes += n * sizeof(T);
+            return std::allocator<T>().allocate(n);
+        }
+        void deallocate(T *p, std::size_t n) noexcept
+        {
+            g_heapBytes -= n * sizeof(T);
+            std::allocator<T>().deallocate(p, n);
+        }
+        template <class U>
+        bool operator==(const CountingAllocator<U> &) const noexcept { return true; }
+        template <class U>
+        bool operator!=(const CountingAllocator<U> &) const noexcept { return false; }
+    };
+    using NodeMap = std::unordered_map<Coord, Cell, CoordHasher, std::equal_to<Coord>,
+                                       CountingAllocator<std::pair<const Coord, Cell>>>;
+
+    double rss_mib()
+    {
+#ifdef __linux__
+        if (FILE *f = std::fopen("/proc/self/statm", "r"))
+        {
+            long pages = 0, resident = 0;
+            int ok = std::fscanf(f, "%ld %ld", &pages, &resident);
+            std::fclose(f);
+            if (ok == 2)
+                return resident * 4096.0 / (1024.0 * 1024.0);
+        }
+#endif
+        return 0.0;
+    }
+
+    struct Row
+    {
+        double buildMs, hitNs, missNs, bytesPerStone, rss;
+    };
+
+    template <class Insert, class Contains, class Bytes>
+    Row run(const std::vector<Move> &stones, const std::vector<Move> &hits, const std::vector<Move> &misses,
+            Insert &&insert, Contains &&contains, Bytes &&bytes)
+    {
+        Row r{};
+        metrics::Stopwatch sw;
+        for (std::size_t i = 0; i < stones.size(); ++i)
+            insert(stones[i].x, stones[i].y, i & 1 ? Cell::O : Cell::X);
+        r.buildMs = sw.ms();
+        std::size_t found = 0;
+        sw.restart();
+        for (const Move &m : hits)
+            found += contains(m.x, m.y);
+        r.hitNs = sw.ms() * 1e6 / hits.size();
+        sw.restart();
+        for (const Move &m : misses)
+            found += contains(m.x, m.y);
+        r.missNs = sw.ms() * 1e6 / misses.size();
+        if (found != hits.size())
+            std::fprintf(stderr, "lookup mismatch: %zu of %zu\n", found, hits.size());
+        r.bytesPerStone = static_cast<double>(bytes()) / stones.size();
+        r.rss = rss_mib();
+        return r;
+    }
+
+    void print(const char *name, const Row &r)
+    {
+        std::printf("%-10s %9.1f %8.1f %8.1f %12.1f %8.1f\n", name, r.buildMs, r.hitNs, r.missNs, r.bytesPerStone, r.rss);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t stones = 1000000, lookups = 4000000;
+    std::string which = "both";
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string a = argv[i];
+        if (a == "--stones")
+            stones = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (a == "--lookups")
+            lookups = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (a == "--map")
+            which = argv[i + 1];
+        else
+        {
+            std::fprintf(stderr, "usage: ttt4_bench [--stones N] [--lookups M] [--map both|flat|node]\n");
+            return 2;
+        }
+    }
+    stones = std::max<std::size_t>(stones, 1);
+    lookups = std::max<std::size_t>(lookups, 1);
+
+    // every other cell of a square blob, centred on the origin, in random order
+    int side = static_cast<int>(std::ceil(std::sqrt(2.0 * stones)));
+    std::vector<Move> all;
+    all.reserve(stones);
+    for (int y = 0; y < side && all.size() < stones; ++y)
+        for (int x = (y & 1); x < side && all.size() < stones; x += 2)
+            all.emplace_back(x - side / 2, y - side / 2);
+    std::shuffle(all.begin(), all.end(), rng());
+    std::vector<Move> hits(lookups), misses(lookups);
+    for (std::size_t i = 0; i < lookups; ++i)
+    {
+        hits[i] = all[rng()() % all.size()];
+        misses[i] = Move(hits[i].x + 1, hits[i].y); // the checkerboard leaves neighbours empty
+    }
+
+    std::printf("stones %zu, lookups %zu\n", all.size(), lookups);
+    std::printf("%-10s %9s %8s %8s %12s %8s\n", "map", "build ms", "hit ns", "miss ns", "bytes/stone", "rss MiB");
+    std::printf("%-10s %9s %8s %8s %12s %8.1f\n", "(start)", "", "", "", "", rss_mib());
+    if (which == "both" || which == "node")
+    {
+        NodeMap m;
+        print("unordered", run(all, hits, misses, [&](int x, int y, Cell c)
+                               { m.emplace(Coord{x, y}, c); },
+                               [&](int x, int y)
+                               { return m.find(Coord{x, y}) != m.end(); },
+                               []
+                               { return g_heapBytes; }));
+    }
+    if (which == "both" || which == "flat")
+    {
+        FlatMap<Cell> m;
+        print("flat", run(all, hits, misses, [&](int x, int y, Cell c)
+                          { m.insert(x, y, c); },
+                          [&](int x, int y)
+                          { return m.contains(x, y); },
+                          [&]
+                          { return m.memory_bytes(); }));
+    }
+
+    // the same position through Board, which also keeps an undo record per stone
+    Board b;
+    metrics::Stopwatch sw;
+    for (std::size_t i = 0; i < all.size(); ++i)
+        b.place(all[i].x, all[i].y, i & 1 ? Cell::O : Cell::X);
+    double placeMs = sw.ms();
+    sw.restart();
+    std::size_t occupied = 0;
+    for (const Move &m : hits)
+        occupied += b.at(m.x, m.y) != Cell::Empty;
+    std::printf("Board: place %.1f ms, at() %.1f ns, %.1f bytes/stone with history\n", placeMs,
+                sw.ms() * 1e6 / hits.size(), static_cast<double>(b.memory_bytes()) / b.size());
+    return occupied == hits.size() ? 0 : 1;
+}
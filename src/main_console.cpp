@@ -1,15 +1,26 @@
 #include <iostream>
 #include <sstream>
+#include <string>
 #include "Board.hpp"
 #include "AI.hpp"
+#include "GameRecord.hpp"
 
-int main(){
+int main(int argc, char** argv){
     std::cout << "TTT4Infinite (console). Human plays X, AI (O) needs 4 in a row.\n";
     std::cout << "Enter moves as: x y\n";
     Board board;
     AI ai;
     ai.set_mode(AI::ALPHABETA);
     ai.set_depth(4);
+    ai.set_pattern_eval(pattern_eval::startup_weights()); // TTT_EVAL_WEIGHTS, if set
+
+    // --log <file>: append the game to a binary game log
+    grec::Writer log;
+    for (int i=1; i+1<argc; ++i)
+        if (std::string(argv[i])=="--log" && !log.open(argv[i+1]))
+            std::cout << "cannot open game log " << argv[i+1] << '\n';
+    if (log.is_open())
+        log.begin_game({0, (std::uint32_t)ai.get_mode(), (std::uint32_t)ai.get_depth(), 0, 0}, (int)Cell::X);
 
     while (true){
         // print bbox
@@ -33,11 +44,13 @@ int main(){
         std::stringstream ss(line);
         int x,y; if (!(ss>>x>>y)){ std::cout<<"bad input\n"; continue;}
         if (!board.place(x,y, Cell::X)){ std::cout<<"occupied!\n"; continue; }
-        if (board.is_win_from(x,y, Cell::X, 4)){ std::cout<<"You (X) win!\n"; break; }
+        log.add_move(x,y);
+        if (board.is_win_from(x,y, Cell::X, 4)){ std::cout<<"You (X) win!\n"; log.end_game(grec::XWins); break; }
         Move m = ai.choose_move(board);
         board.place(m.x,m.y, Cell::O);
+        log.add_move(m.x,m.y);
         std::cout << "AI plays O at ("<<m.x<<","<<m.y<<")\n";
-        if (board.is_win_from(m.x,m.y, Cell::O, 4)){ std::cout<<"AI (O) wins!\n"; break; }
+        if (board.is_win_from(m.x,m.y, Cell::O, 4)){ std::cout<<"AI (O) wins!\n"; log.end_game(grec::OWins); break; }
     }
     return 0;
 }
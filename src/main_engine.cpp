@@ -0,0 +1,304 @@
+// Long-lived engine process with a UCI-style line protocol on stdin/stdout.
+//
+//   uci                          -> id ..., option ..., uciok
+//   isready                      -> readyok
+//   setoption name <N> value <V> Mode (1 greedy, 2 alphabeta, 3 id), Depth, MoveTime (ms), Hash (TT entries),
+//                                Eval (classic, pattern or a pattern weights file; TTT_EVAL_WEIGHTS sets the default),
+//                                NullMove, LMR (0 or 1: forward pruning, both on by default),
+//                                Quiescence (0 or 1: threat extension at the horizon, on by default),
+//                                ZoneCap (local moves searched in long games, 0 = all; see CandidateZone),
+//                                Regions (0 or 1: per-cluster evaluation and candidate caches, off by default)
+//   newgame                      clear the position and the transposition table
+//   position [empty] [moves x,y ...]
+//                                X moves first, colours alternate
+//   go [depth N] [movetime MS] [xtime MS] [otime MS] [xinc MS] [oinc MS] [infinite]
+//                                -> info depth .. score .. nodes .. nps .. time .. pv x,y ...
+//                                -> bestmove x,y
+//   stop                         finish the running search now
+//   save <path>                  snapshot the position and the TT (Snapshot.hpp)
+//   load <path>                  restore both; the TT is mapped, not read
+//   quit
+//
+// The search runs on its own thread so `stop` and `isready` are answered while it
+// thinks. One AI instance lives for the whole process: the TT stays warm between
+// positions of the same game and across games until `newgame`.
+//
+// TTT_METRICS_FILE / TTT_METRICS_PORT export move latency histograms in the Prometheus
+// text format (MetricsExport.hpp).
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.hpp"
+#include "AI.hpp"
+#include "MetricsExport.hpp"
+#include "Notation.hpp"
+#include "Snapshot.hpp"
+#include "Trace.hpp"
+
+namespace
+{
+    std::mutex outMx;
+
+    void say(const std::string &line)
+    {
+        std::lock_guard<std::mutex> lk(outMx);
+        std::cout << line << '\n'
+                  << std::flush;
+    }
+
+    struct Engine
+    {
+        AI ai;
+        Board board;
+        std::vector<Move> moves; // game record; the side to move plays O inside `board`
+        std::atomic<bool> stop{false};
+        std::thread worker;
+
+        AI::Mode mode{AI::ID_DEEPEN};
+        int depth{6};
+        int moveTime{800};
+        pattern_eval::Weights weights;
+
+        Engine()
+        {
+            ai.set_stop_flag(&stop);
+            ai.set_pattern_eval(pattern_eval::startup_weights()); // TTT_EVAL_WEIGHTS, if set
+            ai.set_info_callback([](const SearchInfo &i)
+                                 {
+                long long nps = i.timeMs > 0 ? i.nodes * 1000 / i.timeMs : i.nodes;
+                std::string line = "info depth " + std::to_string(i.depth) + " score " + std::to_string(i.score) +
+                                   " nodes " + std::to_string(i.nodes) + " nps " + std::to_string(nps) +
+                                   " time " + std::to_string(i.timeMs);
+                if (i.pvLength > 0)
+                {
+                    line += " pv";
+                    for (int k = 0; k < i.pvLength; ++k)
+                        line += " " + format_move(i.pv[k]);
+                }
+                say(line); });
+        }
+        ~Engine() { wait(); }
+
+        void wait()
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+
+        Cell side_to_move() const { return moves.size() % 2 == 0 ? Cell::X : Cell::O; }
+
+        void set_position(std::vector<Move> ms)
+        {
+            std::size_t n = load_game(board, ms);
+            if (n < ms.size())
+            {
+                say("info string illegal move " + format_move(ms[n]) + ", position truncated");
+                ms.resize(n);
+                load_game(board, ms);
+            }
+            moves = std::move(ms);
+        }
+
+        void go(std::istringstream &args)
+        {
+            int goDepth = 0, goTime = 0, left[2] = {-1, -1}, inc[2] = {0, 0};
+            bool infinite = false;
+            std::string k;
+            while (args >> k)
+            {
+                if (k == "depth")
+                    args >> goDepth;
+                else if (k == "movetime")
+                    args >> goTime;
+                else if (k == "xtime")
+                    args >> left[0];
+                else if (k == "otime")
+                    args >> left[1];
+                else if (k == "xinc")
+                    args >> inc[0];
+                else if (k == "oinc")
+                    args >> inc[1];
+                else if (k == "infinite")
+                    infinite = true;
+            }
+            int me = side_to_move() == Cell::X ? 0 : 1;
+            if (goTime == 0 && left[me] >= 0)
+            {
+                // clock: a slice of the remaining time plus most of the increment, never over half
+                goTime = left[me] / 20 + inc[me] * 3 / 4;
+                goTime = std::max(1, std::min(goTime, left[me] / 2));
+            }
+
+            ai.set_mode(mode);
+            ai.set_depth(depth);
+            ai.set_time_budget(moveTime);
+            if (infinite || goDepth > 0 || goTime > 0)
+            {
+                ai.set_mode(AI::ID_DEEPEN);
+                ai.set_depth(goDepth > 0 ? goDepth : SearchArena::MAX_PLY);
+                ai.set_time_budget(goTime > 0 && !infinite ? goTime : INT_MAX);
+            }
+
+            stop = false;
+            worker = std::thread([this]
+                                 {
+                trace::set_thread_name("search");
+                Move m = ai.choose_move(board);
+                say("bestmove " + format_move(m)); });
+        }
+
+        // returns false on quit
+        bool handle(const std::string &line)
+        {
+            std::istringstream ss(line);
+            std::string cmd;
+            if (!(ss >> cmd))
+                return true;
+            if (cmd == "stop")
+            {
+                stop = true;
+                return true;
+            }
+            if (cmd == "isready")
+            {
+                say("readyok");
+                return true;
+            }
+            if (cmd == "quit")
+            {
+                stop = true;
+                wait();
+                return false;
+            }
+            // everything else waits for the running search to finish
+            wait();
+            if (cmd == "uci")
+            {
+                say("id name TTT4Infinite");
+                say("option name Mode type spin default 3 min 1 max 3");
+                say("option name Depth type spin default 6 min 1 max " + std::to_string(SearchArena::MAX_PLY));
+                say("option name MoveTime type spin default 800 min 1 max 3600000");
+                say("option name Hash type spin default 524288 min 1024 max 67108864");
+                say("option name Eval type string default classic");
+                say("option name NullMove type check default true");
+                say("option name LMR type check default true");
+                say("option name Quiescence type check default true");
+                say("option name ZoneCap type spin default " + std::to_string(CandidateZone{}.cap) + " min 0 max 1000");
+                say("option name Regions type check default false");
+                say("uciok");
+            }
+            else if (cmd == "setoption")
+            {
+                std::string tok, name;
+                std::string text;
+                ss >> tok >> name >> tok >> text;
+                long long value = std::atoll(text.c_str());
+                if (name == "Mode" && value >= 1 && value <= 3)
+                    mode = static_cast<AI::Mode>(value);
+                else if (name == "Depth")
+                    depth = static_cast<int>(value);
+                else if (name == "MoveTime")
+                    moveTime = static_cast<int>(value);
+                else if (name == "Hash" && value > 0)
+                    ai.set_tt_entries(static_cast<size_t>(value));
+                else if (name == "NullMove" || name == "LMR")
+                {
+                    Pruning p = ai.pruning();
+                    bool on = text == "true" || value != 0;
+                    (name == "LMR" ? p.lmr : p.nullMove) = on;
+                    ai.set_pruning(p);
+                }
+                else if (name == "Quiescence")
+                {
+                    Quiescence q = ai.quiescence();
+                    q.enabled = text == "true" || value != 0;
+                    ai.set_quiescence(q);
+                }
+                else if (name == "ZoneCap" && value >= 0)
+                {
+                    CandidateZone z = ai.candidate_zone();
+                    z.cap = static_cast<int>(value);
+                    ai.set_zone(z);
+                }
+                else if (name == "Regions")
+                    ai.set_regions(text == "true" || value != 0);
+                else if (name == "Eval" && text == "classic")
+                    ai.set_pattern_eval(nullptr);
+                else if (name == "Eval" && text == "pattern")
+                    ai.set_pattern_eval(&pattern_eval::Weights::defaults());
+                else if (name == "Eval" && !text.empty())
+                {
+                    if (weights.load(text))
+                        ai.set_pattern_eval(&weights);
+                    else
+                        say("info string cannot load weights " + text);
+                }
+                else
+                    say("info string unknown option " + name);
+            }
+            else if (cmd == "newgame" || cmd == "ucinewgame")
+            {
+                set_position({});
+                ai.clear_tt();
+            }
+            else if (cmd == "position")
+            {
+                std::vector<Move> ms;
+                std::string tok;
+                while (ss >> tok)
+                {
+                    Move m;
+                    if (parse_move(tok, m))
+                        ms.push_back(m);
+                    else if (tok != "empty" && tok != "startpos" && tok != "moves")
+                        say("info string bad move " + tok);
+                }
+                set_position(std::move(ms));
+            }
+            else if (cmd == "go")
+                go(ss);
+            else if (cmd == "save" || cmd == "load")
+            {
+                std::string path, err;
+                std::getline(ss >> std::ws, path);
+                if (cmd == "save" && !snap::save(path, board, &ai, &err))
+                    say("info string cannot save " + path + ": " + err);
+                else if (cmd == "load" && !snap::load(path, board, &ai, &err))
+                    say("info string cannot load " + path + ": " + err);
+                else if (cmd == "load")
+                {
+                    // the record is the history; colours alternate from X as in set_position
+                    moves.clear();
+                    for (const UndoRecord &r : board.history())
+                        moves.emplace_back(r.x, r.y);
+                }
+            }
+            else
+                say("info string unknown command " + cmd);
+            return true;
+        }
+    };
+}
+
+int main()
+{
+    std::ios::sync_with_stdio(false);
+    metrics::Exporter exporter;
+    std::string err;
+    if (!exporter.start_from_env(&err) && !err.empty())
+        std::cerr << "metrics: " << err << '\n';
+    Engine engine;
+    std::string line;
+    while (std::getline(std::cin, line))
+        if (!engine.handle(line))
+            return 0;
+    engine.stop = true;
+    return 0;
+}
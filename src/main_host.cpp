@@ -0,0 +1,432 @@
+// Game host front end: many games, one pool of search threads (Host.hpp).
+//
+//   ttt4_host [-j THREADS] [--tt-mb MB] [--socket PATH] [metrics]
+//   ttt4_host [-j THREADS] [--tt-mb MB] --bench GAMES [--moves N] [--latency MS] [--depth D] [metrics]
+//
+//   metrics: [--metrics-file PATH] [--metrics-port PORT] [--metrics-interval MS]
+//            move latency histograms by mode, depth and board size in the Prometheus
+//            text format, rewritten every MS (default 5000) and/or served over HTTP on
+//            127.0.0.1 (MetricsExport.hpp); without these, TTT_METRICS_* as for ttt4_engine
+//
+// Serves a line protocol on a Unix socket (one thread per connection, POSIX only) or,
+// without --socket, on stdin/stdout:
+//
+//   open [mode M] [depth D] [latency MS] [hash ENTRIES] [eval classic|pattern]
+//                            -> session ID
+//   play ID x,y [x,y ...]    -> ok | error ...     X moves first, colours alternate
+//   go ID                    -> (when done) bestmove ID x,y depth D nodes N queued MS time MS [late]
+//                               | error ID busy | error ID cancelled
+//   reset ID | close ID      -> ok | error ...
+//   stats                    -> stats sessions .. queued .. running .. completed .. late .. tt .. p50 .. p99 .. max ..
+//   quit                     closes the connection and its sessions
+//
+// --bench opens GAMES sessions that play themselves N moves deep from a random 2-move
+// opening, over and over, for --moves total replies, and prints throughput and latency.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Host.hpp"
+#include "MetricsExport.hpp"
+#include "Notation.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define TTT_HOST_SOCKETS 1
+#endif
+
+namespace
+{
+    // one client: replies may come from worker threads, so writes are serialised
+    struct Connection
+    {
+        int fd = -1; // -1: stdout
+        bool gone = false; // socket closed; late replies are dropped
+        std::mutex mx;
+        std::set<GameHost::SessionId> owned;
+
+        void say(const std::string &line)
+        {
+            std::lock_guard<std::mutex> lk(mx);
+            if (gone)
+                return;
+#ifdef TTT_HOST_SOCKETS
+            if (fd >= 0)
+            {
+                std::string out = line + '\n';
+                for (std::size_t sent = 0; sent < out.size();)
+                {
+                    ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+                    if (n <= 0)
+                        return; // client went away; its sessions close on disconnect
+                    sent += static_cast<std::size_t>(n);
+                }
+                return;
+            }
+#endif
+            std::cout << line << '\n'
+                      << std::flush;
+        }
+    };
+
+    std::string format_result(const MoveResult &r)
+    {
+        return "bestmove " + std::to_string(r.session) + " " + format_move(r.move) + " depth " + std::to_string(r.depth) +
+               " nodes " + std::to_string(r.nodes) + " queued " + std::to_string(r.queuedMs) + " time " +
+               std::to_string(r.searchMs) + (r.late ? " late" : "");
+    }
+
+    // returns false on quit
+    bool handle(GameHost &host, const std::shared_ptr<Connection> &conn, const std::string &line)
+    {
+        std::istringstream ss(line);
+        std::string cmd;
+        if (!(ss >> cmd))
+            return true;
+        if (cmd == "quit")
+            return false;
+        if (cmd == "open")
+        {
+            SessionConfig cfg;
+            std::string k;
+            while (ss >> k)
+            {
+                if (k == "mode")
+                {
+                    int m = 0;
+                    ss >> m;
+                    if (m >= 1 && m <= 3)
+                        cfg.mode = static_cast<AI::Mode>(m);
+                }
+                else if (k == "depth")
+                    ss >> cfg.depth;
+                else if (k == "latency")
+                    ss >> cfg.latencyMs;
+                else if (k == "hash")
+                    ss >> cfg.ttEntries;
+                else if (k == "eval")
+                {
+                    std::string v;
+                    ss >> v;
+                    cfg.eval = v == "pattern" ? &pattern_eval::Weights::defaults() : nullptr;
+                }
+            }
+            GameHost::SessionId id = host.open(cfg);
+            if (id == 0)
+            {
+                conn->say("error too many sessions");
+                return true;
+            }
+            {
+                std::lock_guard<std::mutex> lk(conn->mx);
+                conn->owned.insert(id);
+            }
+            conn->say("session " + std::to_string(id));
+            return true;
+        }
+        if (cmd == "stats")
+        {
+            HostStats st = host.stats();
+            char buf[256];
+            std::snprintf(buf, sizeof(buf),
+                          "stats sessions %zu queued %zu running %zu completed %llu late %llu tt %zu p50 %.0f p99 %.0f max %.0f",
+                          st.sessions, st.queued, st.running, (unsigned long long)st.completed,
+                          (unsigned long long)st.late, st.ttEntriesPerSession, st.p50Ms, st.p99Ms, st.maxMs);
+            conn->say(buf);
+            return true;
+        }
+
+        GameHost::SessionId id = 0;
+        ss >> id;
+        {
+            std::lock_guard<std::mutex> lk(conn->mx);
+            if (!conn->owned.count(id))
+                id = 0; // only the connection that opened a session drives it
+        }
+        if (id == 0)
+        {
+            conn->say("error unknown session");
+            return true;
+        }
+        if (cmd == "play")
+        {
+            std::string tok;
+            while (ss >> tok)
+            {
+                Move m;
+                if (!parse_move(tok, m) || !host.play(id, m))
+                {
+                    conn->say("error illegal move " + tok);
+                    return true;
+                }
+            }
+            conn->say("ok");
+        }
+        else if (cmd == "go")
+        {
+            std::weak_ptr<Connection> weak = conn;
+            // no "ok": the reply may be ready before it could be written
+            if (!host.request_move(id, [weak](const MoveResult &r)
+                                   {
+                if (auto c = weak.lock())
+                    c->say(r.ok ? format_result(r) : "error " + std::to_string(r.session) + " cancelled"); }))
+                conn->say("error " + std::to_string(id) + " busy");
+        }
+        else if (cmd == "reset")
+            conn->say(host.reset(id) ? "ok" : "error busy");
+        else if (cmd == "close")
+        {
+            host.close(id);
+            {
+                std::lock_guard<std::mutex> lk(conn->mx);
+                conn->owned.erase(id);
+            }
+            conn->say("ok");
+        }
+        else
+            conn->say("error unknown command " + cmd);
+        return true;
+    }
+
+    void close_all(GameHost &host, Connection &conn)
+    {
+        std::lock_guard<std::mutex> lk(conn.mx);
+        for (GameHost::SessionId id : conn.owned)
+            host.close(id);
+        conn.owned.clear();
+    }
+
+#ifdef TTT_HOST_SOCKETS
+    void serve_client(GameHost &host, int fd)
+    {
+        auto conn = std::make_shared<Connection>();
+        conn->fd = fd;
+        std::string buf;
+        char chunk[4096];
+        bool open = true;
+        while (open)
+        {
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                break;
+            buf.append(chunk, static_cast<std::size_t>(n));
+            std::size_t nl;
+            while (open && (nl = buf.find('\n')) != std::string::npos)
+            {
+                std::string line = buf.substr(0, nl);
+                buf.erase(0, nl + 1);
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                open = handle(host, conn, line);
+            }
+        }
+        close_all(host, *conn);
+        std::lock_guard<std::mutex> lk(conn->mx);
+        conn->gone = true;
+        ::close(fd);
+    }
+
+    int serve_socket(GameHost &host, const std::string &path)
+    {
+        int srv = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (srv < 0 || path.size() >= sizeof(addr.sun_path))
+        {
+            std::cerr << "cannot create socket " << path << '\n';
+            return 1;
+        }
+        std::copy(path.begin(), path.end(), addr.sun_path);
+        ::unlink(path.c_str());
+        if (::bind(srv, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(srv, 64) != 0)
+        {
+            std::cerr << "cannot listen on " << path << '\n';
+            return 1;
+        }
+        std::cerr << "ttt4_host: " << host.threads() << " workers, listening on " << path << '\n';
+        while (true)
+        {
+            int fd = ::accept(srv, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            std::thread([&host, fd]
+                        { serve_client(host, fd); })
+                .detach();
+        }
+    }
+#endif
+
+    int serve_stdio(GameHost &host)
+    {
+        auto conn = std::make_shared<Connection>();
+        std::string line;
+        while (std::getline(std::cin, line) && handle(host, conn, line))
+        {
+        }
+        close_all(host, *conn);
+        return 0;
+    }
+
+    // GAMES self-playing sessions keep the pool busy until `total` replies have come back
+    int bench(GameHost &host, int games, long long total, const SessionConfig &cfg, int maxPlies)
+    {
+        std::mutex mx;
+        std::condition_variable cv;
+        long long issued = 0, done = 0;
+        std::vector<GameHost::SessionId> ids;
+        std::mt19937 gen(7);
+
+        auto opening = [&](GameHost::SessionId id)
+        {
+            std::uniform_int_distribution<int> c(-3, 3);
+            host.reset(id);
+            host.play(id, Move(0, 0));
+            Move m(c(gen), c(gen));
+            if (m.x == 0 && m.y == 0)
+                m.x = 1;
+            host.play(id, m);
+        };
+        std::function<void(const MoveResult &)> onReply;
+        auto next = [&](GameHost::SessionId id)
+        {
+            {
+                std::lock_guard<std::mutex> lk(mx);
+                if (issued >= total)
+                    return;
+                ++issued;
+            }
+            if (!host.request_move(id, onReply))
+            {
+                std::lock_guard<std::mutex> lk(mx);
+                ++done;
+                cv.notify_all();
+            }
+        };
+        // counting the reply is the callback's last step, under the lock: once done catches up
+        // with issued, bench may return and take mx, cv and the counters with it
+        onReply = [&](const MoveResult &r)
+        {
+            bool over = !r.ok || !host.play(r.session, r.move) || host.winner(r.session) != Cell::Empty ||
+                        static_cast<int>(host.moves(r.session).size()) >= maxPlies;
+            if (over)
+            {
+                std::lock_guard<std::mutex> lk(mx);
+                opening(r.session);
+            }
+            next(r.session);
+            std::lock_guard<std::mutex> lk(mx);
+            ++done;
+            cv.notify_all();
+        };
+
+        for (int g = 0; g < games; ++g)
+        {
+            GameHost::SessionId id = host.open(cfg);
+            if (id == 0)
+                break;
+            ids.push_back(id);
+            opening(id);
+        }
+        metrics::Stopwatch sw;
+        for (GameHost::SessionId id : ids)
+            next(id);
+        {
+            std::unique_lock<std::mutex> lk(mx);
+            cv.wait(lk, [&]
+                    { return done >= std::min<long long>(total, issued) && issued >= std::min<long long>(total, ids.size()); });
+        }
+        while (host.stats().running != 0) // nothing of ours left in a worker either
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double secs = sw.ms() / 1000.0;
+        HostStats st = host.stats();
+        std::printf("%zu games, %d workers, latency target %d ms: %llu replies in %.1f s = %.0f moves/s\n", ids.size(),
+                    host.threads(), cfg.latencyMs, (unsigned long long)st.completed, secs, st.completed / secs);
+        std::printf("latency p50 %.0f ms, p99 %.0f ms, max %.0f ms; late %llu (%.1f%%); TT %zu entries per session\n",
+                    st.p50Ms, st.p99Ms, st.maxMs, (unsigned long long)st.late,
+                    st.completed ? 100.0 * st.late / st.completed : 0.0, st.ttEntriesPerSession);
+        for (GameHost::SessionId id : ids)
+            host.close(id);
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    HostLimits lim;
+    std::string socketPath;
+    int benchGames = 0, maxPlies = 40;
+    long long benchMoves = 0;
+    SessionConfig cfg;
+    metrics::Exporter::Options metricsOpt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "-j" && hasValue)
+            lim.threads = std::atoi(argv[++i]);
+        else if (a == "--tt-mb" && hasValue)
+            lim.ttBytes = static_cast<std::size_t>(std::atoll(argv[++i])) << 20;
+        else if (a == "--socket" && hasValue)
+            socketPath = argv[++i];
+        else if (a == "--bench" && hasValue)
+            benchGames = std::atoi(argv[++i]);
+        else if (a == "--moves" && hasValue)
+            benchMoves = std::atoll(argv[++i]);
+        else if (a == "--latency" && hasValue)
+            cfg.latencyMs = std::atoi(argv[++i]);
+        else if (a == "--depth" && hasValue)
+            cfg.depth = std::atoi(argv[++i]);
+        else if (a == "--plies" && hasValue)
+            maxPlies = std::atoi(argv[++i]);
+        else if (a == "--metrics-file" && hasValue)
+            metricsOpt.file = argv[++i];
+        else if (a == "--metrics-port" && hasValue)
+            metricsOpt.port = std::atoi(argv[++i]);
+        else if (a == "--metrics-interval" && hasValue)
+            metricsOpt.intervalMs = std::atoi(argv[++i]);
+        else
+        {
+            std::cerr << "usage: ttt4_host [-j THREADS] [--tt-mb MB] [--socket PATH]\n"
+                         "       ttt4_host [-j THREADS] [--tt-mb MB] --bench GAMES [--moves N] [--latency MS] [--depth D] [--plies P]\n"
+                         "       [--metrics-file PATH] [--metrics-port PORT] [--metrics-interval MS]\n";
+            return 2;
+        }
+    }
+    metrics::Exporter exporter;
+    std::string err;
+    bool exporting = metricsOpt.file.empty() && metricsOpt.port < 0 ? exporter.start_from_env(&err) : exporter.start(metricsOpt, &err);
+    if (!exporting && !err.empty())
+    {
+        std::cerr << "metrics: " << err << '\n';
+        return 1;
+    }
+    if (exporter.port() >= 0)
+        std::cerr << "ttt4_host: metrics on http://127.0.0.1:" << exporter.port() << "/metrics\n";
+    lim.maxSessions = std::max<std::size_t>(lim.maxSessions, static_cast<std::size_t>(benchGames));
+    GameHost host(lim);
+    if (benchGames > 0)
+        return bench(host, benchGames, benchMoves > 0 ? benchMoves : 10LL * benchGames, cfg, maxPlies);
+    if (!socketPath.empty())
+    {
+#ifdef TTT_HOST_SOCKETS
+        ::signal(SIGPIPE, SIG_IGN);
+        return serve_socket(host, socketPath);
+#else
+        std::cerr << "Unix sockets are not available on this platform; serving stdin/stdout\n";
+#endif
+    }
+    return serve_stdio(host);
+}
@@ -0,0 +1,174 @@
+// Micro-benchmarks of the Board primitives the search is built from, on the corpus
+// positions (Corpus.hpp), each op cycling through all of them. See Micro.hpp for the
+// options; the Game.hpp counterparts are in ttt4_micro_game.
+//
+//   ttt4_micro --search MS    instead: iterative deepening with MS per position, with
+//                             and without forward pruning (Pruning in AI.hpp)
+//   ttt4_micro --zone MS      the same on growing late-game boards (corpus::long_game),
+//                             all candidates against the candidate zone (CandidateZone)
+#include <cstring>
+#include <vector>
+#include "AI.hpp"
+#include "Board.hpp"
+#include "Corpus.hpp"
+#include "Micro.hpp"
+#include "Notation.hpp"
+#include "Regions.hpp"
+
+namespace
+{
+    // depth reached and nodes spent per position in `ms`, pruning off and on
+    int search_depths(const std::vector<Board> &boards, int ms)
+    {
+        std::printf("%-12s %14s %14s\n", "position", "plain d/nodes", "pruned d/nodes");
+        int sum[2] = {0, 0}, open = 0;
+        for (std::size_t k = 0; k < boards.size(); ++k)
+        {
+            int depth[2];
+            long long nodes[2];
+            bool decided = false;
+            for (int on = 0; on < 2; ++on)
+            {
+                Pruning p;
+                p.nullMove = p.lmr = on != 0;
+                AI ai;
+                ai.set_mode(AI::ID_DEEPEN);
+                ai.set_depth(SearchArena::MAX_PLY);
+                ai.set_time_budget(ms);
+                ai.set_pruning(p);
+                depth[on] = 0;
+                ai.set_info_callback([&](const SearchInfo &i)
+                                     {
+                    depth[on] = i.depth;
+                    decided = decided || (on == 0 && (i.score >= 800000 || i.score <= -800000)); });
+                Board b = boards[k];
+                ai.choose_move(b);
+                nodes[on] = ai.nodes();
+            }
+            if (!decided)
+            {
+                sum[0] += depth[0];
+                sum[1] += depth[1];
+                ++open;
+            }
+            std::printf("%-12s %4d %9lld %4d %9lld%s\n", corpus::positions()[k].name, depth[0], nodes[0], depth[1], nodes[1],
+                        decided ? "  (won/lost)" : "");
+        }
+        // positions the plain search already sees to the end say nothing about depth
+        if (open)
+            std::printf("mean depth   %4.2f %14.2f  (%d open positions)\n", double(sum[0]) / open, double(sum[1]) / open, open);
+        return 0;
+    }
+
+    // root branching, depth reached and nodes in `ms` as the board grows, zone off and on
+    int zone_depths(int ms)
+    {
+        std::printf("%-8s %10s %16s %16s\n", "stones", "branching", "all d/nodes", "zone d/nodes");
+        for (int side : {6, 10, 14, 18})
+        {
+            std::vector<Move> moves;
+            for (auto &m : corpus::long_game(side))
+                moves.emplace_back(m.first, m.second);
+            Board b;
+            load_game(b, moves);
+            CandidateMarks marks;
+            std::vector<Move> buf(b.max_candidates(0));
+            std::size_t branch[2] = {b.candidates(2).size(), b.zone_candidates(buf.data(), buf.size(), marks, CandidateZone{})};
+            int depth[2];
+            long long nodes[2];
+            for (int on = 0; on < 2; ++on)
+            {
+                CandidateZone z;
+                z.cap = on ? z.cap : 0;
+                AI ai;
+                ai.set_mode(AI::ID_DEEPEN);
+                ai.set_depth(SearchArena::MAX_PLY);
+                ai.set_time_budget(ms);
+                ai.set_zone(z);
+                depth[on] = 0;
+                ai.set_info_callback([&](const SearchInfo &i)
+                                     { depth[on] = i.depth; });
+                ai.choose_move(b);
+                nodes[on] = ai.nodes();
+            }
+            std::printf("%-8zu %4zu/%-5zu %4d %11lld %4d %11lld\n", b.size(), branch[0], branch[1], depth[0], nodes[0], depth[1], nodes[1]);
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<Board> boards;
+    std::vector<std::vector<Move>> empties, stones;
+    for (const corpus::Position &p : corpus::positions())
+    {
+        std::vector<Move> ms;
+        for (auto &m : p.moves)
+            ms.emplace_back(m.first, m.second);
+        boards.emplace_back();
+        load_game(boards.back(), ms);
+        empties.push_back(boards.back().candidates(2));
+        stones.push_back(ms);
+    }
+    const std::size_t n = boards.size();
+    CandidateMarks marks;
+    std::vector<Move> buf(64 * 1024);
+
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], "--search") == 0)
+            return search_depths(boards, std::atoi(argv[i + 1]));
+        else if (std::strcmp(argv[i], "--zone") == 0)
+            return zone_depths(std::atoi(argv[i + 1]));
+
+    micro::Runner bench(argc, argv);
+    bench.run("Board::place+undo", 80.0, [&](std::uint64_t i)
+              {
+        Board &b = boards[i % n];
+        const std::vector<Move> &e = empties[i % n];
+        const Move &m = e[(i / n) % e.size()];
+        b.place(m.x, m.y, Cell::O);
+        b.undo(m.x, m.y);
+        return 1; });
+    bench.run("Board::is_win_from", 120.0, [&](std::uint64_t i)
+              {
+        const Board &b = boards[i % n];
+        const std::vector<Move> &s = stones[i % n];
+        const Move &m = s[(i / n) % s.size()];
+        return b.is_win_from(m.x, m.y, b.at(m.x, m.y)); });
+    bench.run("Board::candidates", 1600.0, [&](std::uint64_t i)
+              { return boards[i % n].candidates(buf.data(), buf.size(), marks, 2); });
+    bench.run("Board::evaluate", 900.0, [&](std::uint64_t i)
+              { return boards[i % n].evaluate(); });
+
+    // the corpus positions side by side, 40 cells apart: one move, then what the search
+    // asks of the board, without and with a RegionIndex
+    Board spread;
+    for (std::size_t k = 0; k < n; ++k)
+        for (const UndoRecord &r : boards[k].history())
+            if (r.x > -1000 && r.x < 1000)
+                spread.place(r.x + 40 * (int)k, r.y, r.who);
+    std::vector<Move> spreadMoves = spread.candidates(2);
+    RegionIndex regions;
+    for (int on = 0; on < 2; ++on)
+    {
+        regions.reset(spread);
+        spread.attach_regions(on ? &regions : nullptr);
+        bench.run(on ? "clusters move+eval (regions)" : "clusters move+eval", on ? 4500.0 : 14000.0, [&](std::uint64_t i)
+                  {
+            const Move &m = spreadMoves[i % spreadMoves.size()];
+            spread.place(m.x, m.y, Cell::O);
+            int v = spread.evaluate();
+            spread.undo(m.x, m.y);
+            return v; });
+        bench.run(on ? "clusters move+cands (regions)" : "clusters move+cands", on ? 10000.0 : 25000.0, [&](std::uint64_t i)
+                  {
+            const Move &m = spreadMoves[i % spreadMoves.size()];
+            spread.place(m.x, m.y, Cell::O);
+            std::size_t k = spread.candidates(buf.data(), buf.size(), marks, 2);
+            spread.undo(m.x, m.y);
+            return k; });
+    }
+    spread.attach_regions(nullptr);
+    return bench.exit_code();
+}
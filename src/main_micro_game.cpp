@@ -0,0 +1,142 @@
+// Micro-benchmarks of the Game.hpp primitives (MapBoard through IBoard, as the SFML
+// front end searches), on the corpus positions. Header-only like the SFML target, since
+// Game.hpp cannot share a translation unit with Board.hpp. Options in Micro.hpp.
+//
+//   ttt4_micro_game --search MS    instead: deepen a full-window negamax from each
+//                                  position while the total stays under MS, with and
+//                                  without forward pruning (NegamaxPruning)
+//   ttt4_micro_game --zone MS      the same on growing late-game boards (corpus::long_game),
+//                                  all candidates against the zone (NegamaxZone)
+#include <climits>
+#include <cstring>
+#include <vector>
+#include "Corpus.hpp"
+#include "Game.hpp"
+#include "Micro.hpp"
+
+namespace
+{
+    // deepest iteration finished within `ms` (an iteration cannot be interrupted, so the
+    // last one may overrun) and the nodes it took, pruning off and on
+    int search_depths(std::vector<MapBoard> &boards, const std::vector<Cell> &toMove, int ms)
+    {
+        std::printf("%-12s %14s %14s\n", "position", "plain d/nodes", "pruned d/nodes");
+        int sum[2] = {0, 0}, open = 0;
+        for (std::size_t k = 0; k < boards.size(); ++k)
+        {
+            int depth[2];
+            unsigned long long nodes[2];
+            bool decided = false;
+            for (int on = 0; on < 2; ++on)
+            {
+                NegamaxArena arena;
+                arena.prune.nullMove = arena.prune.lmr = on != 0;
+                depth[on] = 0;
+                nodes[on] = 0;
+                metrics::Stopwatch sw;
+                for (int d = 1; d <= 12 && sw.ms() < ms; ++d)
+                {
+                    arena.prepare(boards[k], d);
+                    arena.nodes = 0;
+                    int score = negamax(boards[k], d, -INF_SCORE, INF_SCORE, toMove[k], {INT_MIN, 0}, toMove[k], arena);
+                    if (sw.ms() > ms)
+                        break;
+                    depth[on] = d;
+                    nodes[on] = arena.nodes;
+                    decided = decided || (on == 0 && (score >= INF_SCORE / 2 || score <= -INF_SCORE / 2));
+                }
+            }
+            if (!decided)
+            {
+                sum[0] += depth[0];
+                sum[1] += depth[1];
+                ++open;
+            }
+            std::printf("%-12s %4d %9llu %4d %9llu%s\n", corpus::positions()[k].name, depth[0], nodes[0], depth[1], nodes[1],
+                        decided ? "  (won/lost)" : "");
+        }
+        // positions the plain search already sees to the end say nothing about depth
+        if (open)
+            std::printf("mean depth   %4.2f %14.2f  (%d open positions)\n", double(sum[0]) / open, double(sum[1]) / open, open);
+        return 0;
+    }
+
+    // root branching, depth reached within `ms` and its nodes as the board grows, zone off and on
+    int zone_depths(int ms)
+    {
+        std::printf("%-8s %10s %16s %16s\n", "stones", "branching", "all d/nodes", "zone d/nodes");
+        for (int side : {6, 10, 14, 18})
+        {
+            std::vector<std::pair<int, int>> moves = corpus::long_game(side);
+            MapBoard b;
+            for (std::size_t k = 0; k < moves.size(); ++k)
+                b.set(moves[k].first, moves[k].second, k % 2 ? Cell::O : Cell::X);
+            Cell toMove = moves.size() % 2 ? Cell::O : Cell::X;
+            std::vector<Pos> buf(genCandidatesCap(b));
+            std::size_t branch[2] = {genCandidates(b, buf.data(), buf.size()), genZoneCandidates(b, buf.data(), buf.size(), NegamaxZone{})};
+            int depth[2];
+            unsigned long long nodes[2];
+            for (int on = 0; on < 2; ++on)
+            {
+                NegamaxArena arena;
+                arena.zone.cap = on ? arena.zone.cap : 0;
+                depth[on] = 0;
+                nodes[on] = 0;
+                metrics::Stopwatch sw;
+                for (int d = 1; d <= 12 && sw.ms() < ms; ++d)
+                {
+                    arena.prepare(b, d);
+                    arena.nodes = 0;
+                    negamax(b, d, -INF_SCORE, INF_SCORE, toMove, {INT_MIN, 0}, toMove, arena);
+                    if (sw.ms() > ms)
+                        break;
+                    depth[on] = d;
+                    nodes[on] = arena.nodes;
+                }
+            }
+            std::printf("%-8zu %4zu/%-5zu %4d %11llu %4d %11llu\n", b.count(), branch[0], branch[1], depth[0], nodes[0], depth[1], nodes[1]);
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<MapBoard> boards;
+    std::vector<Cell> toMove;
+    std::vector<std::vector<Pos>> stones;
+    for (const corpus::Position &p : corpus::positions())
+    {
+        boards.emplace_back();
+        stones.emplace_back();
+        for (std::size_t k = 0; k < p.moves.size(); ++k)
+        {
+            boards.back().set(p.moves[k].first, p.moves[k].second, k % 2 ? Cell::O : Cell::X);
+            stones.back().push_back({p.moves[k].first, p.moves[k].second});
+        }
+        toMove.push_back(p.moves.size() % 2 ? Cell::O : Cell::X);
+    }
+    const std::size_t n = boards.size();
+    std::vector<Pos> buf(64 * 1024);
+
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], "--search") == 0)
+            return search_depths(boards, toMove, std::atoi(argv[i + 1]));
+        else if (std::strcmp(argv[i], "--zone") == 0)
+            return zone_depths(std::atoi(argv[i + 1]));
+
+    micro::Runner bench(argc, argv);
+    bench.run("genCandidates", 87000.0, [&](std::uint64_t i)
+              { return genCandidates(boards[i % n], buf.data(), buf.size()); });
+    bench.run("immediateWinningMoves", 46000.0, [&](std::uint64_t i)
+              { return immediateWinningMoves(boards[i % n], toMove[i % n]).size(); });
+    bench.run("checkWinFrom", 120.0, [&](std::uint64_t i)
+              {
+        const MapBoard &b = boards[i % n];
+        const std::vector<Pos> &s = stones[i % n];
+        const Pos &p = s[(i / n) % s.size()];
+        return checkWinFrom(b, p.x, p.y, b.get(p.x, p.y)); });
+    bench.run("evaluate", 38000.0, [&](std::uint64_t i)
+              { return evaluate(boards[i % n], toMove[i % n]); });
+    return bench.exit_code();
+}
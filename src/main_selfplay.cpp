@@ -0,0 +1,194 @@
+// Engine-vs-engine matches for measuring changes at equal time.
+//
+//   ttt4_selfplay [--games N] [--movetime MS] [--depth D] [--max-moves M] [--seed S]
+//                 [--a EVAL] [--b EVAL] [--a-depth D] [--b-depth D] [--a-qs 0|1] [--b-qs 0|1]
+//                 [--log games.tlog]
+//
+// EVAL is "classic" (Board::evaluate) or "pattern[:weights.txt]" (Eval.hpp; built-in
+// weights without a file). --a-depth/--b-depth override --depth for one side and --a-qs/
+// --b-qs switch its quiescence search; the summary gives each side's thinking time. Every random opening is played twice with colours swapped;
+// X moves first. Games longer than --max-moves count as draws. With --log the games are
+// appended to a binary game log (GameRecord.hpp).
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Board.hpp"
+#include "AI.hpp"
+#include "Eval.hpp"
+#include "GameRecord.hpp"
+#include "Metrics.hpp"
+
+namespace
+{
+    struct Player
+    {
+        std::string spec;
+        std::unique_ptr<pattern_eval::Weights> weights;
+        AI ai;
+        Board board; // own stones are O
+        double thinkMs{0};
+        long long searches{0};
+    };
+
+    bool configure(Player &p, const std::string &spec)
+    {
+        p.spec = spec;
+        if (spec == "classic")
+            return true;
+        if (spec.compare(0, 7, "pattern") != 0)
+            return false;
+        p.weights = std::make_unique<pattern_eval::Weights>(pattern_eval::Weights::defaults());
+        if (spec.size() > 8 && spec[7] == ':' && !p.weights->load(spec.substr(8)))
+        {
+            std::cerr << "cannot load weights " << spec.substr(8) << '\n';
+            return false;
+        }
+        p.ai.set_pattern_eval(p.weights.get());
+        return true;
+    }
+
+    // returns +1 if `first` (playing X) wins, -1 if `second` wins, 0 for a draw
+    int play(Player &first, Player &second, const std::vector<Move> &opening, int maxMoves, grec::Writer &log, int mode, int depth, int ms)
+    {
+        Player *side[2] = {&first, &second};
+        first.board = Board();
+        second.board = Board();
+        if (log.is_open())
+            log.begin_game({0, static_cast<std::uint32_t>(mode), static_cast<std::uint32_t>(depth), 0, static_cast<std::uint32_t>(ms)}, int(Cell::X));
+        for (int ply = 0; ply < maxMoves; ++ply)
+        {
+            Player &me = *side[ply % 2];
+            Player &opp = *side[1 - ply % 2];
+            Move m;
+            if (ply < static_cast<int>(opening.size()))
+                m = opening[ply];
+            else
+            {
+                metrics::Stopwatch sw;
+                m = me.ai.choose_move(me.board);
+                me.thinkMs += sw.ms();
+                ++me.searches;
+            }
+            if (!me.board.place(m.x, m.y, Cell::O))
+            {
+                log.end_game(ply % 2 ? grec::XWins : grec::OWins); // illegal move loses
+                return ply % 2 ? 1 : -1;
+            }
+            opp.board.place(m.x, m.y, Cell::X);
+            log.add_move(m.x, m.y);
+            if (me.board.is_win_from(m.x, m.y, Cell::O, 4))
+            {
+                log.end_game(ply % 2 == 0 ? grec::XWins : grec::OWins);
+                return ply % 2 == 0 ? 1 : -1;
+            }
+        }
+        log.end_game(grec::Draw);
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int games = 20, moveTime = 100, depth = SearchArena::MAX_PLY, maxMoves = 120;
+    int sideDepth[2] = {0, 0}, sideQs[2] = {-1, -1};
+    unsigned seed = 1;
+    std::string specA = "pattern", specB = "classic", logPath;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string a = argv[i], v = argv[i + 1];
+        if (a == "--games")
+            games = std::atoi(v.c_str());
+        else if (a == "--movetime")
+            moveTime = std::atoi(v.c_str());
+        else if (a == "--depth")
+            depth = std::atoi(v.c_str());
+        else if (a == "--max-moves")
+            maxMoves = std::atoi(v.c_str());
+        else if (a == "--seed")
+            seed = static_cast<unsigned>(std::atoi(v.c_str()));
+        else if (a == "--a")
+            specA = v;
+        else if (a == "--b")
+            specB = v;
+        else if (a == "--a-depth" || a == "--b-depth")
+            sideDepth[a[2] == 'b'] = std::atoi(v.c_str());
+        else if (a == "--a-qs" || a == "--b-qs")
+            sideQs[a[2] == 'b'] = std::atoi(v.c_str());
+        else if (a == "--log")
+            logPath = v;
+        else
+        {
+            std::cerr << "unknown option " << a << '\n';
+            return 2;
+        }
+    }
+
+    Player a, b;
+    if (!configure(a, specA) || !configure(b, specB))
+    {
+        std::cerr << "EVAL must be classic or pattern[:file]\n";
+        return 2;
+    }
+    Player *players[2] = {&a, &b};
+    for (int i = 0; i < 2; ++i)
+    {
+        Player *p = players[i];
+        p->ai.set_mode(AI::ID_DEEPEN);
+        p->ai.set_depth(sideDepth[i] > 0 ? sideDepth[i] : depth);
+        p->ai.set_time_budget(moveTime);
+        if (sideQs[i] >= 0)
+        {
+            Quiescence q = p->ai.quiescence();
+            q.enabled = sideQs[i] != 0;
+            p->ai.set_quiescence(q);
+        }
+    }
+    grec::Writer log;
+    if (!logPath.empty() && !log.open(logPath))
+    {
+        std::cerr << "cannot open game log " << logPath << '\n';
+        return 1;
+    }
+
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> coord(-2, 2);
+    int winsA = 0, winsB = 0, draws = 0;
+    std::vector<Move> opening;
+    for (int g = 0; g < games; ++g)
+    {
+        // a short random opening, replayed with colours swapped on odd games
+        if (g % 2 == 0)
+        {
+            opening.clear();
+            while (opening.size() < 3)
+            {
+                Move m{coord(gen), coord(gen)};
+                bool dup = false;
+                for (const Move &o : opening)
+                    dup = dup || o == m;
+                if (!dup)
+                    opening.push_back(m);
+            }
+        }
+        bool aFirst = g % 2 == 0;
+        int r = aFirst ? play(a, b, opening, maxMoves, log, AI::ID_DEEPEN, depth, moveTime)
+                       : play(b, a, opening, maxMoves, log, AI::ID_DEEPEN, depth, moveTime);
+        int forA = aFirst ? r : -r;
+        winsA += forA > 0;
+        winsB += forA < 0;
+        draws += forA == 0;
+        std::cout << "game " << g + 1 << ": " << (forA > 0 ? specA : forA < 0 ? specB : std::string("draw"))
+                  << (forA != 0 ? " wins" : "") << '\n';
+    }
+    double score = games > 0 ? (winsA + 0.5 * draws) / games : 0.0;
+    std::cout << specA << " vs " << specB << ": +" << winsA << " -" << winsB << " =" << draws
+              << "  score " << score * 100 << "%\n";
+    for (Player *p : players)
+        std::cout << p->spec << " (depth " << p->ai.get_depth() << (p->ai.quiescence().enabled ? ", quiescence" : "")
+                  << "): " << p->thinkMs / 1000.0 << " s thinking, " << (p->searches ? p->thinkMs / p->searches : 0.0)
+                  << " ms per move\n";
+    return 0;
+}
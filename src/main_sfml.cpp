@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <cstdio>
 
 // ======== Camera / coords =========
 static sf::Vector2f worldToScreen(float wx, float wy, float cell, sf::Vector2f center, sf::Vector2f cam)
@@ -80,41 +81,181 @@ static std::optional<std::pair<Pos, Pos>> winningSegment(const IBoard &b, int x,
     return std::nullopt;
 }
 
-// рисуем O как кольцо
-static void drawO(sf::RenderTarget &win, sf::Vector2f center, float cell, sf::Color colorOutline)
+// Глифы камней в мировых координатах (клетка = 1), треугольниками в общий VertexArray.
+// O — кольцо из RING_SEGMENTS трапеций
+static constexpr int RING_SEGMENTS = 24;
+static void appendO(sf::VertexArray &va, float cx, float cy, sf::Color color)
 {
-    float rOuter = cell * 0.38f;
-    float rInner = cell * 0.24f;
-    sf::CircleShape ring(rOuter);
-    ring.setOrigin(rOuter, rOuter);
-    ring.setPosition(center);
-    ring.setFillColor(sf::Color::Transparent);
-    ring.setOutlineThickness(rOuter - rInner);
-    ring.setOutlineColor(colorOutline);
-    win.draw(ring);
+    const float rOuter = 0.38f, rInner = 0.24f;
+    static const auto unit = []
+    {
+        std::vector<sf::Vector2f> u(RING_SEGMENTS + 1);
+        for (int i = 0; i <= RING_SEGMENTS; ++i)
+        {
+            float a = 2.f * 3.14159265f * i / RING_SEGMENTS;
+            u[i] = {std::cos(a), std::sin(a)};
+        }
+        return u;
+    }();
+    for (int i = 0; i < RING_SEGMENTS; ++i)
+    {
+        sf::Vector2f o0(cx + unit[i].x * rOuter, cy + unit[i].y * rOuter);
+        sf::Vector2f o1(cx + unit[i + 1].x * rOuter, cy + unit[i + 1].y * rOuter);
+        sf::Vector2f i0(cx + unit[i].x * rInner, cy + unit[i].y * rInner);
+        sf::Vector2f i1(cx + unit[i + 1].x * rInner, cy + unit[i + 1].y * rInner);
+        va.append(sf::Vertex(o0, color));
+        va.append(sf::Vertex(o1, color));
+        va.append(sf::Vertex(i1, color));
+        va.append(sf::Vertex(o0, color));
+        va.append(sf::Vertex(i1, color));
+        va.append(sf::Vertex(i0, color));
+    }
 }
 
-// рисуем X двумя диагональными полосами
-static void drawX(sf::RenderTarget &win, sf::Vector2f center, float cell, sf::Color color)
+// X — две диагональные полосы
+static void appendX(sf::VertexArray &va, float cx, float cy, sf::Color color)
 {
-    float len = cell * 0.62f;
-    float thick = cell * 0.16f;
-    sf::RectangleShape bar(sf::Vector2f(len, thick));
-    bar.setOrigin(len / 2.f, thick / 2.f);
-    bar.setFillColor(color);
-    bar.setPosition(center);
-    bar.setRotation(45.f);
-    win.draw(bar);
-    bar.setRotation(-45.f);
-    win.draw(bar);
+    const float halfLen = 0.31f * 0.70710678f, halfThick = 0.08f * 0.70710678f;
+    for (float s : {1.f, -1.f})
+    {
+        // полоса вдоль (1, s), толщина вдоль (-s, 1)
+        sf::Vector2f along(halfLen, s * halfLen), across(-s * halfThick, halfThick);
+        sf::Vector2f c(cx, cy);
+        sf::Vector2f a = c - along - across, b = c + along - across;
+        sf::Vector2f d = c - along + across, e = c + along + across;
+        va.append(sf::Vertex(a, color));
+        va.append(sf::Vertex(b, color));
+        va.append(sf::Vertex(e, color));
+        va.append(sf::Vertex(a, color));
+        va.append(sf::Vertex(e, color));
+        va.append(sf::Vertex(d, color));
+    }
 }
 
+// Камни видимой области: по VertexArray на цвет, два draw call на кадр.
+// Массивы строятся из StoneIndex для прямоугольника с запасом вокруг экрана и
+// перестраиваются, только когда меняется позиция или экран выходит за этот прямоугольник;
+// сдвиг камеры и зум — это лишь трансформация при отрисовке.
+struct StoneLayer
+{
+    sf::VertexArray xs{sf::Triangles}, os{sf::Triangles};
+    uint64_t revision = ~0ull;
+    int x0 = 1, y0 = 1, x1 = 0, y1 = 0; // закэшированный прямоугольник клеток
+
+    // true, если массивы перестроены
+    bool update(const Game &g, int vx0, int vy0, int vx1, int vy1)
+    {
+        int w = vx1 - vx0 + 1, h = vy1 - vy0 + 1;
+        bool inside = vx0 >= x0 && vy0 >= y0 && vx1 <= x1 && vy1 <= y1;
+        bool tooBig = (x1 - x0 + 1) > 4 * w || (y1 - y0 + 1) > 4 * h; // после сильного приближения
+        if (revision == g.revision && inside && !tooBig)
+            return false;
+        // запас в половину экрана: перетаскивание не перестраивает массивы каждый кадр
+        x0 = vx0 - w / 2;
+        x1 = vx1 + w / 2;
+        y0 = vy0 - h / 2;
+        y1 = vy1 + h / 2;
+        xs.clear();
+        os.clear();
+        g.stones.query(x0, y0, x1, y1, [&](const StoneIndex::Stone &s)
+                       {
+            if (s.c == Cell::X)
+                appendX(xs, s.x + 0.5f, s.y + 0.5f, sf::Color(220, 80, 80));
+            else
+                appendO(os, s.x + 0.5f, s.y + 0.5f, sf::Color(80, 140, 220)); });
+        revision = g.revision;
+        return true;
+    }
+
+    void draw(sf::RenderTarget &win, float cell, sf::Vector2f center, sf::Vector2f cam, metrics::FrameCounters &fc) const
+    {
+        sf::RenderStates st;
+        st.transform.translate(center).scale(cell, cell).translate(-cam.x, -cam.y);
+        win.draw(xs, st);
+        win.draw(os, st);
+        fc.draw(xs.getVertexCount());
+        fc.draw(os.getVertexCount());
+    }
+};
+
+// Оверлей производительности (F3): график времени кадра с перцентилями, draw calls и
+// вершины прошлого кадра, время сборки сетки и камней, память доски, ход поиска ИИ
+struct PerfOverlay
+{
+    bool visible = false;
+    metrics::Series frameMs{240}, gridMs{240}, stonesMs{240};
+    metrics::FrameCounters last; // счётчики предыдущего кадра (текущий ещё рисуется)
+    // память доски, снятая, пока ИИ её не трогает: поток ИИ меняет g.board через
+    // TempPlace, и FlatMap может перевыделить массивы прямо под чтением
+    size_t boardBytes = 0;
+
+    void draw(sf::RenderTarget &win, const sf::Font *font, const Game &g, const metrics::SearchProgress &ai) const
+    {
+        const float W = 360.f, H = 110.f, graphH = 60.f;
+        const float left = (float)win.getSize().x - W - 8.f, top = 34.f;
+        sf::RectangleShape panel(sf::Vector2f(W, H + 96.f));
+        panel.setPosition(left, top);
+        panel.setFillColor(sf::Color(0, 0, 0, 170));
+        win.draw(panel);
+
+        // график: полоса на 33 мс, линия бюджета 60 fps
+        const float scaleMs = 33.3f;
+        sf::VertexArray graph(sf::LineStrip);
+        size_t n = frameMs.size();
+        for (size_t i = 0; i < n; ++i)
+        {
+            float v = std::min(frameMs.at(i), scaleMs);
+            float x = left + 4.f + (W - 8.f) * i / std::max<size_t>(1, frameMs.capacity() - 1);
+            sf::Color c = frameMs.at(i) > 16.7f * 1.5f ? sf::Color(240, 90, 70) : sf::Color(120, 220, 120);
+            graph.append(sf::Vertex(sf::Vector2f(x, top + 4.f + graphH * (1.f - v / scaleMs)), c));
+        }
+        sf::VertexArray budget(sf::Lines);
+        float by = top + 4.f + graphH * (1.f - 16.7f / scaleMs);
+        budget.append(sf::Vertex(sf::Vector2f(left + 4.f, by), sf::Color(250, 200, 60, 120)));
+        budget.append(sf::Vertex(sf::Vector2f(left + W - 4.f, by), sf::Color(250, 200, 60, 120)));
+        win.draw(budget);
+        win.draw(graph);
+        if (!font)
+            return;
+
+        char buf[160];
+        std::string text;
+        auto line = [&](const char *fmt, auto... args)
+        {
+            std::snprintf(buf, sizeof(buf), fmt, args...);
+            text += buf;
+            text += '\n';
+        };
+        line("frame %.1f ms  p50 %.1f  p95 %.1f  p99 %.1f  max %.1f", frameMs.last(), frameMs.percentile(0.50f),
+             frameMs.percentile(0.95f), frameMs.percentile(0.99f), frameMs.max());
+        line("grid %.2f ms   stones %.2f ms (max %.2f)", gridMs.mean(), stonesMs.mean(), stonesMs.max());
+        line("draw calls %u   vertices %llu", last.drawCalls, (unsigned long long)last.vertices);
+        line("board %zu stones, %.1f KiB (+ render index %.1f KiB)", g.stones.count, boardBytes / 1024.0,
+             g.stones.memoryBytes() / 1024.0);
+        auto s = ai.snapshot();
+        const char *unit = g.algo == Algo::MCTS ? "playouts" : "nodes";
+        if (s.running)
+            line("AI: %llu %s, %.0f/s, depth %d, %.1f s", (unsigned long long)s.nodes, unit, s.nodes_per_sec(), s.depth, s.ms / 1000.0);
+        else if (s.ms > 0)
+            line("AI idle; last move %llu %s, %.0f/s, %.2f s", (unsigned long long)s.nodes, unit, s.nodes_per_sec(), s.ms / 1000.0);
+        else
+            line("AI idle");
+        sf::Text t(text, *font, 13);
+        t.setFillColor(sf::Color(200, 210, 220));
+        t.setPosition(left + 6.f, top + graphH + 10.f);
+        win.draw(t);
+    }
+};
+
 int main()
 {
     sf::RenderWindow win(sf::VideoMode(1280, 800), "TTT4Infinite - 4-in-a-row (SFML)");
     win.setFramerateLimit(60);
+    trace::set_thread_name("main");
 
     Game g; // поле на хэш-таблице
+    if (const char *path = std::getenv("TTT_GAME_LOG"))
+        g.log.open(path); // партии дописываются в бинарный журнал
     float cell = 40.f;
     sf::Vector2f cam(0.f, 0.f);
     sf::Vector2f center(win.getSize().x / 2.f, win.getSize().y / 2.f);
@@ -129,43 +270,88 @@ int main()
         hud.setFillColor(sf::Color(160, 170, 180));
     }
 
+    metrics::SearchProgress aiProgress; // пишет поток ИИ, читает оверлей
     auto aiMove = [&](Cell who) -> Pos
     {
-        if (g.algo == Algo::Greedy)
-            return ai_greedy(g.board, who);
-        if (g.algo == Algo::Negamax)
-            return ai_negamax(g.board, who, g.depth);
-        return ai_mcts(g.board, who, g.mcts);
+        trace::set_thread_name("ai");
+        aiProgress.begin(g.algo == Algo::Negamax ? g.depth : g.algo == Algo::MCTS ? g.mcts.playoutDepth : 1);
+        Pos p = g.algo == Algo::Greedy    ? ai_greedy(g.board, who)
+                : g.algo == Algo::Negamax ? ai_negamax(g.board, who, g.depth, &aiProgress, g.pruning, g.quiescence, g.zone)
+                                          : ai_mcts(g.board, who, g.mcts, &aiProgress);
+        aiProgress.end();
+        return p;
     };
 
+    // TTT_AI_SLICE_MS=N: negamax считается в главном потоке, не дольше N мс за кадр
+    // (NegamaxTask), а не в потоке std::async — на одноядерных устройствах поток ИИ
+    // отнимает процессор у отрисовки. Ход тот же; жадный ИИ и MCTS остаются в потоке.
+    int aiSliceMs = 0;
+    if (const char *env = std::getenv("TTT_AI_SLICE_MS"))
+        aiSliceMs = std::max(0, std::atoi(env));
+    const uint64_t AI_STEP_WORK = 4; // между проверками часов: узел или оценка хода — до сотен мкс
+    NegamaxTask aiTask;
+    bool aiStepped = false;
+
     std::atomic<bool> aiThinking{false};
     std::future<Pos> aiFuture;
     auto startAI = [&]
     {
         aiThinking = true;
-        aiFuture = std::async(std::launch::async, aiMove, Cell::O);
+        aiStepped = aiSliceMs > 0 && g.algo == Algo::Negamax;
+        if (aiStepped)
+        {
+            aiProgress.begin(g.depth);
+            aiTask.start(g.board, Cell::O, g.depth, &aiProgress, g.pruning, g.quiescence, g.zone);
+        }
+        else
+            aiFuture = std::async(std::launch::async, aiMove, Cell::O);
+    };
+    auto cancelAI = [&]
+    {
+        if (aiStepped)
+        {
+            aiTask.cancel();
+            aiProgress.end();
+            aiStepped = false;
+        }
+        aiThinking = false;
     };
     std::optional<std::pair<Pos, Pos>> lastWinSeg;
     Cell winner = Cell::Empty;
+    auto playAI = [&](Pos p)
+    {
+        aiThinking = false;
+        if (g.placeIfEmpty(p.x, p.y, Cell::O))
+        {
+            auto seg = winningSegment(g.board, p.x, p.y, Cell::O);
+            if (seg)
+            {
+                lastWinSeg = seg;
+                winner = Cell::O;
+                g.finish(Cell::O);
+            }
+        }
+    };
     auto finishAIIfReady = [&]
     {
-        if (aiThinking)
+        if (aiThinking && aiStepped)
         {
-            using namespace std::chrono_literals;
-            if (aiFuture.wait_for(0ms) == std::future_status::ready)
+            sf::Clock slice;
+            while (!aiTask.step(AI_STEP_WORK) && slice.getElapsedTime().asMilliseconds() < aiSliceMs)
             {
-                Pos p = aiFuture.get();
-                aiThinking = false;
-                if (g.placeIfEmpty(p.x, p.y, Cell::O))
-                {
-                    auto seg = winningSegment(g.board, p.x, p.y, Cell::O);
-                    if (seg)
-                    {
-                        lastWinSeg = seg;
-                        winner = Cell::O;
-                    }
-                }
             }
+            if (aiTask.done())
+            {
+                aiProgress.end();
+                aiStepped = false;
+                playAI(aiTask.result());
+            }
+        }
+        else if (aiThinking)
+        {
+            using namespace std::chrono_literals;
+            if (aiFuture.wait_for(0ms) == std::future_status::ready)
+                playAI(aiFuture.get());
         }
     };
 
@@ -193,12 +379,17 @@ int main()
         cam += (wBefore - wAfter);
     };
 
+    StoneLayer stoneLayer;
+    PerfOverlay perf;
+    metrics::FrameCounters frame;
+    sf::Clock frameClock;
     bool flashWin = false;
     int flashFrames = 0;
     float spinnerAngle = 0.f;
 
     while (win.isOpen())
     {
+        TTT_TRACE_SCOPE("frame"); // события — время до «frame: ai»
         sf::Event ev;
         while (win.pollEvent(ev))
         {
@@ -220,6 +411,8 @@ int main()
             {
                 if (ev.key.code == sf::Keyboard::Escape)
                     win.close();
+                if (ev.key.code == sf::Keyboard::F3)
+                    perf.visible = !perf.visible;
                 if (ev.key.code == sf::Keyboard::Num1)
                     g.algo = Algo::Greedy;
                 if (ev.key.code == sf::Keyboard::Num2)
@@ -243,7 +436,7 @@ int main()
                 if (ev.key.code == sf::Keyboard::R)
                 {
                     g.reset();
-                    aiThinking = false;
+                    cancelAI();
                     winner = Cell::Empty;
                     lastWinSeg.reset();
                 }
@@ -255,14 +448,14 @@ int main()
                 if (!aiThinking && winner == Cell::Empty)
                 {
                     Pos p = screenToCell({ev.mouseButton.x, ev.mouseButton.y}, cell, center, cam);
-                    if (g.board.get(p.x, p.y) == Cell::Empty)
+                    if (g.placeIfEmpty(p.x, p.y, Cell::X))
                     {
-                        g.board.set(p.x, p.y, Cell::X);
                         auto seg = winningSegment(g.board, p.x, p.y, Cell::X);
                         if (seg)
                         {
                             lastWinSeg = seg;
                             winner = Cell::X;
+                            g.finish(Cell::X);
                             flashWin = true;
                             flashFrames = 60;
                         }
@@ -275,40 +468,45 @@ int main()
             }
         }
 
-        finishAIIfReady();
+        {
+            TTT_TRACE_SCOPE("frame: ai");
+            finishAIIfReady();
+        }
 
         win.clear(sf::Color(25, 25, 28));
+        frame.reset();
 
         // сетка
+        metrics::Stopwatch section;
         int halfCols = (int)std::ceil(win.getSize().x / (2 * cell)) + 2;
         int halfRows = (int)std::ceil(win.getSize().y / (2 * cell)) + 2;
         int minx = (int)std::floor(cam.x) - halfCols, maxx = (int)std::floor(cam.x) + halfCols;
         int miny = (int)std::floor(cam.y) - halfRows, maxy = (int)std::floor(cam.y) + halfRows;
         sf::VertexArray va(sf::Lines);
-        for (int x = minx; x <= maxx; ++x)
         {
-            va.append(sf::Vertex(worldToScreen((float)x, (float)miny, cell, center, cam), sf::Color(60, 60, 70)));
-            va.append(sf::Vertex(worldToScreen((float)x, (float)maxy, cell, center, cam), sf::Color(60, 60, 70)));
-        }
-        for (int y = miny; y <= maxy; ++y)
-        {
-            va.append(sf::Vertex(worldToScreen((float)minx, (float)y, cell, center, cam), sf::Color(60, 60, 70)));
-            va.append(sf::Vertex(worldToScreen((float)maxx, (float)y, cell, center, cam), sf::Color(60, 60, 70)));
+            TTT_TRACE_SCOPE("frame: grid");
+            for (int x = minx; x <= maxx; ++x)
+            {
+                va.append(sf::Vertex(worldToScreen((float)x, (float)miny, cell, center, cam), sf::Color(60, 60, 70)));
+                va.append(sf::Vertex(worldToScreen((float)x, (float)maxy, cell, center, cam), sf::Color(60, 60, 70)));
+            }
+            for (int y = miny; y <= maxy; ++y)
+            {
+                va.append(sf::Vertex(worldToScreen((float)minx, (float)y, cell, center, cam), sf::Color(60, 60, 70)));
+                va.append(sf::Vertex(worldToScreen((float)maxx, (float)y, cell, center, cam), sf::Color(60, 60, 70)));
+            }
+            perf.gridMs.add(section.ms());
+            win.draw(va);
+            frame.draw(va.getVertexCount());
         }
-        win.draw(va);
 
-        // фигуры
-        for (auto &kv : g.board.cells)
+        // фигуры: только камни вокруг экрана, из кэша
+        section.restart();
         {
-            int x = kv.first.first, y = kv.first.second;
-            Cell c = kv.second;
-            if (c == Cell::Empty)
-                continue;
-            auto cc = worldCellCenterToScreen(x, y, cell, center, cam);
-            if (c == Cell::X)
-                drawX(win, cc, cell, sf::Color(220, 80, 80));
-            else
-                drawO(win, cc, cell, sf::Color(80, 140, 220));
+            TTT_TRACE_SCOPE("frame: stones");
+            stoneLayer.update(g, minx, miny, maxx, maxy);
+            perf.stonesMs.add(section.ms());
+            stoneLayer.draw(win, cell, center, cam, frame);
         }
 
         // зачёркивание победной линии + баннер
@@ -325,6 +523,7 @@ int main()
             strike.setRotation(angle);
             strike.setFillColor(sf::Color(250, 200, 60, 230));
             win.draw(strike);
+            frame.draw();
 
             if (haveFont)
             {
@@ -333,6 +532,7 @@ int main()
                 t.setFillColor(sf::Color(240, 240, 240));
                 t.setPosition(16.f, (float)win.getSize().y - 40.f);
                 win.draw(t);
+                frame.draw();
             }
         }
 
@@ -344,6 +544,7 @@ int main()
             hud.setString(mode + "    " + depthStr + "   [1/2/3 switch, [/] depth/iters, R reset]");
             hud.setPosition(8.f, 6.f);
             win.draw(hud);
+            frame.draw();
         }
 
         // панель «AI is thinking...»
@@ -359,6 +560,7 @@ int main()
             ring.setOutlineColor(sf::Color(80, 140, 220, 200));
             ring.setPosition(c);
             win.draw(ring);
+            frame.draw();
 
             sf::RectangleShape tick(sf::Vector2f(rr, 3.f));
             tick.setOrigin(0, 1.5f);
@@ -366,6 +568,7 @@ int main()
             tick.setPosition(c);
             tick.setRotation(spinnerAngle);
             win.draw(tick);
+            frame.draw();
 
             sf::RectangleShape panel(sf::Vector2f(200.f, 50.f));
             panel.setOrigin(panel.getSize().x / 2.f, panel.getSize().y / 2.f);
@@ -374,6 +577,7 @@ int main()
             panel.setOutlineThickness(1.f);
             panel.setOutlineColor(sf::Color(80, 140, 220, 150));
             win.draw(panel);
+            frame.draw();
 
             if (haveFont)
             {
@@ -381,6 +585,7 @@ int main()
                 t.setFillColor(sf::Color(160, 170, 180));
                 t.setPosition(c.x - 80.f, c.y + 58.f);
                 win.draw(t);
+                frame.draw();
             }
         }
 
@@ -393,11 +598,25 @@ int main()
             border.setOutlineThickness(4);
             border.setOutlineColor(sf::Color(250, 200, 60, 180));
             win.draw(border);
+            frame.draw();
             if (--flashFrames <= 0)
                 flashWin = false;
         }
 
-        win.display();
+        if (perf.visible)
+        {
+            TTT_TRACE_SCOPE("frame: overlay");
+            if (!aiThinking && !aiFuture.valid()) // поток ИИ завершён (после R он может ещё считать)
+                perf.boardBytes = g.board.memoryBytes();
+            perf.draw(win, haveFont ? &font : nullptr, g, aiProgress);
+        }
+        perf.last = frame;
+
+        {
+            TTT_TRACE_SCOPE("frame: display"); // с ожиданием лимита кадров
+            win.display();
+        }
+        perf.frameMs.add(frameClock.restart().asSeconds() * 1000.f);
     }
     return 0;
 }
@@ -0,0 +1,253 @@
+// Texel tuning of the pattern evaluator's output layer against game results.
+//
+//   ttt4_tune [-j THREADS] [--init weights.txt] [--out tuned.txt] [--iters N] [--skip PLIES]
+//             [--rate R] games.tlog [more.tlog ...]
+//
+// Every finished game in the logs is replayed on a Board with a PatternAccumulator
+// attached, so each position costs one incremental update; the clipped hidden
+// activations of each position are kept as its features. The output weights w2/b2 are
+// then fitted so that sigmoid(K * eval) predicts the result for O (1 win, 0.5 draw,
+// 0 loss): K is fitted first with the initial weights, then Adam minimises the mean
+// squared error. The first layer (--init, default Weights::defaults()) stays fixed.
+//
+// Positions in the first --skip plies, and positions where the side to move can win at
+// once, are left out. The result is a weights file for TTT_EVAL_WEIGHTS, ttt4_engine's
+// Eval option or ttt4_selfplay's pattern:FILE.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.hpp"
+#include "Eval.hpp"
+#include "GameRecord.hpp"
+
+using namespace pattern_eval;
+
+namespace
+{
+    struct Sample
+    {
+        std::uint16_t f[HIDDEN];
+        float result; // for O
+    };
+
+    // runs fn(begin, end, worker) over [0, n) split into contiguous shards
+    template <class F>
+    void parallel_for(std::size_t n, int threads, F &&fn)
+    {
+        std::vector<std::thread> pool;
+        std::size_t chunk = (n + threads - 1) / threads;
+        for (int t = 0; t < threads; ++t)
+        {
+            std::size_t b = t * chunk, e = std::min(n, b + chunk);
+            if (b >= e)
+                break;
+            pool.emplace_back([&fn, b, e, t]
+                              { fn(b, e, t); });
+        }
+        for (auto &th : pool)
+            th.join();
+    }
+
+    // features of every usable position of one game
+    void extract(const grec::GameView &g, const Weights &w, int skip, std::vector<Sample> &out)
+    {
+        float result = g.result == grec::OWins ? 1.0f : g.result == grec::XWins ? 0.0f : 0.5f;
+        Board b;
+        PatternAccumulator acc(w);
+        // default shapes alongside, to spot positions where the side to move wins at once
+        PatternAccumulator shapes(Weights::defaults());
+        acc.reset(b);
+        shapes.reset(b);
+        b.attach(&acc);
+        Cell who = g.first == int(Cell::O) ? Cell::O : Cell::X;
+        auto cur = g.moves();
+        int x, y;
+        for (std::uint32_t ply = 0; ply < g.nmoves && cur.next(x, y); ++ply)
+        {
+            if (!b.place(x, y, who))
+                break;
+            shapes.on_change(b, x, y, who, true);
+            who = who == Cell::X ? Cell::O : Cell::X;
+            if (static_cast<int>(ply) + 1 < skip || ply + 1 == g.nmoves)
+                continue;
+            int own = who == Cell::O ? 0 : SHAPES;
+            if (shapes.values()[own + 4] > 0 || shapes.values()[own + 5] > 0)
+                continue; // a three with an empty fourth cell: not a quiet position
+            Sample s;
+            for (int h = 0; h < HIDDEN; ++h)
+                s.f[h] = static_cast<std::uint16_t>(std::min<int>(std::max<int>(acc.values()[h], 0), CLIP));
+            s.result = result;
+            out.push_back(s);
+        }
+        b.attach(nullptr);
+    }
+
+    double sigmoid(double v) { return 1.0 / (1.0 + std::exp(-v)); }
+
+    struct Model
+    {
+        double w[HIDDEN];
+        double b;
+        double eval(const Sample &s) const
+        {
+            double e = b;
+            for (int h = 0; h < HIDDEN; ++h)
+                e += w[h] * s.f[h];
+            return e;
+        }
+    };
+
+    double loss(const std::vector<Sample> &data, const Model &m, double K, int threads)
+    {
+        std::vector<double> part(threads, 0.0);
+        parallel_for(data.size(), threads, [&](std::size_t b, std::size_t e, int t)
+                     {
+            double s = 0;
+            for (std::size_t i = b; i < e; ++i)
+            {
+                double d = sigmoid(K * m.eval(data[i])) - data[i].result;
+                s += d * d;
+            }
+            part[t] = s; });
+        double s = 0;
+        for (double v : part)
+            s += v;
+        return data.empty() ? 0.0 : s / data.size();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    int iters = 300, skip = 4;
+    double rate = 2.0;
+    std::string initPath, outPath = "tuned_weights.txt";
+    std::vector<std::string> logs;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        if (a == "-j" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (a == "--init" && i + 1 < argc)
+            initPath = argv[++i];
+        else if (a == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else if (a == "--iters" && i + 1 < argc)
+            iters = std::atoi(argv[++i]);
+        else if (a == "--skip" && i + 1 < argc)
+            skip = std::atoi(argv[++i]);
+        else if (a == "--rate" && i + 1 < argc)
+            rate = std::atof(argv[++i]);
+        else
+            logs.push_back(a);
+    }
+    if (logs.empty())
+    {
+        std::cerr << "usage: ttt4_tune [-j THREADS] [--init weights.txt] [--out tuned.txt] [--iters N] [--skip PLIES] [--rate R] games.tlog ...\n";
+        return 2;
+    }
+    threads = std::max(1, threads);
+
+    Weights w = Weights::defaults();
+    if (!initPath.empty() && !w.load(initPath))
+    {
+        std::cerr << "cannot load " << initPath << '\n';
+        return 1;
+    }
+
+    // ---- features, one shard of games per thread ----
+    Timer timer;
+    std::vector<Sample> data;
+    for (const std::string &path : logs)
+    {
+        grec::Reader r;
+        if (!r.open(path))
+        {
+            std::cerr << "cannot open " << path << '\n';
+            return 1;
+        }
+        std::vector<std::vector<Sample>> part(threads);
+        parallel_for(r.size(), threads, [&](std::size_t b, std::size_t e, int t)
+                     {
+            grec::GameView g;
+            for (std::size_t i = b; i < e; ++i)
+                if (r.game(i, g) && g.result != grec::Unfinished)
+                    extract(g, w, skip, part[t]); });
+        for (auto &p : part)
+            data.insert(data.end(), p.begin(), p.end());
+    }
+    std::cerr << data.size() << " positions in " << timer.elapsed_ms() << " ms\n";
+    if (data.empty())
+        return 1;
+
+    Model m;
+    for (int h = 0; h < HIDDEN; ++h)
+        m.w[h] = w.w2[h];
+    m.b = w.b2;
+
+    // ---- K: golden-section search on log10(K) with the initial weights ----
+    double lo = -6, hi = 0;
+    const double phi = (std::sqrt(5.0) - 1) / 2;
+    for (int it = 0; it < 40; ++it)
+    {
+        double a = hi - phi * (hi - lo), c = lo + phi * (hi - lo);
+        if (loss(data, m, std::pow(10.0, a), threads) < loss(data, m, std::pow(10.0, c), threads))
+            hi = c;
+        else
+            lo = a;
+    }
+    const double K = std::pow(10.0, (lo + hi) / 2);
+    std::cerr << "K = " << K << ", initial error " << loss(data, m, K, threads) << '\n';
+
+    // ---- Adam on w2 and b2 ----
+    double mom[HIDDEN + 1] = {}, var[HIDDEN + 1] = {};
+    const double b1 = 0.9, b2 = 0.999;
+    for (int it = 1; it <= iters; ++it)
+    {
+        std::vector<std::vector<double>> part(threads, std::vector<double>(HIDDEN + 1, 0.0));
+        parallel_for(data.size(), threads, [&](std::size_t b, std::size_t e, int t)
+                     {
+            std::vector<double> &g = part[t];
+            for (std::size_t i = b; i < e; ++i)
+            {
+                const Sample &s = data[i];
+                double p = sigmoid(K * m.eval(s));
+                double d = 2 * (p - s.result) * p * (1 - p) * K;
+                for (int h = 0; h < HIDDEN; ++h)
+                    g[h] += d * s.f[h];
+                g[HIDDEN] += d;
+            } });
+        for (int k = 0; k <= HIDDEN; ++k)
+        {
+            double g = 0;
+            for (auto &p : part)
+                g += p[k];
+            g /= data.size();
+            mom[k] = b1 * mom[k] + (1 - b1) * g;
+            var[k] = b2 * var[k] + (1 - b2) * g * g;
+            double step = rate * (mom[k] / (1 - std::pow(b1, it))) / (std::sqrt(var[k] / (1 - std::pow(b2, it))) + 1e-12);
+            if (k < HIDDEN)
+                m.w[k] -= step;
+            else
+                m.b -= step;
+        }
+        if (it % 50 == 0 || it == iters)
+            std::cerr << "iter " << it << ": error " << loss(data, m, K, threads) << '\n';
+    }
+
+    for (int h = 0; h < HIDDEN; ++h)
+        w.w2[h] = static_cast<std::int16_t>(std::clamp(std::lround(m.w[h]), -long(MAX_W2), long(MAX_W2)));
+    w.b2 = static_cast<std::int32_t>(std::lround(m.b));
+    if (!w.save(outPath))
+    {
+        std::cerr << "cannot write " << outPath << '\n';
+        return 1;
+    }
+    std::cerr << "wrote " << outPath << " in " << timer.elapsed_ms() << " ms\n";
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include <cassert>
+#include <map>
 #include "Board.hpp"
+#include "AI.hpp"
 
 int main(){
     Board b;
@@ -13,5 +15,114 @@ int main(){
     // undo and check non-win
     b.undo(3,0);
     assert(!b.is_win_from(2,0, Cell::X, 4));
+
+    // undo restores the exact bbox and hash, in and out of LIFO order
+    Board c;
+    c.place(0,0, Cell::X);
+    auto h0 = c.hash();
+    c.place(5,-3, Cell::O);
+    c.place(-2,4, Cell::X);
+    c.undo(-2,4);
+    assert(c.min_x()==0 && c.max_x()==5 && c.min_y()==-3 && c.max_y()==0);
+    c.place(-2,4, Cell::X);
+    c.undo(5,-3);
+    assert(c.min_x()==-2 && c.max_x()==0 && c.min_y()==0 && c.max_y()==4);
+    c.undo(-2,4);
+    assert(c.min_x()==0 && c.max_x()==0 && c.min_y()==0 && c.max_y()==0);
+    assert(c.hash()==h0 && c.history().size()==1);
+
+    // FlatMap agrees with std::map through growth and backward-shift erases
+    {
+        FlatMap<Cell> fm;
+        std::map<std::pair<int,int>, Cell> ref;
+        std::uint64_t r = 12345;
+        for (int i = 0; i < 20000; ++i){
+            r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+            int x = int(r >> 59) - 16, y = int((r >> 54) & 31) - 16; // dense: long probe runs
+            Cell v = (r >> 40) & 1 ? Cell::X : Cell::O;
+            if ((r >> 33) % 3 == 0){
+                assert(fm.erase(x, y) == (ref.erase({x, y}) == 1));
+            } else {
+                bool fresh = ref.emplace(std::make_pair(x, y), v).second;
+                assert(fm.insert(x, y, v) == fresh);
+            }
+            assert(fm.size() == ref.size());
+        }
+        for (auto &kv : ref)
+            assert(fm.find(kv.first.first, kv.first.second) && *fm.find(kv.first.first, kv.first.second) == kv.second);
+        std::size_t seen = 0;
+        fm.for_each([&](int x, int y, Cell v){ assert(ref.at({x, y}) == v); ++seen; });
+        assert(seen == ref.size() && !fm.contains(100, 100));
+    }
+
+    // iterative deepening reports every finished depth; a raised stop flag still yields a move
+    Board d;
+    d.place(0,0, Cell::X); d.place(1,0, Cell::O); d.place(0,1, Cell::X);
+    AI ai;
+    ai.set_mode(AI::ID_DEEPEN);
+    ai.set_depth(3);
+    ai.set_time_budget(1 << 30);
+    int lastDepth = 0;
+    ai.set_info_callback([&](const SearchInfo& i){
+        assert(i.depth == lastDepth + 1 && i.pvLength >= 1 && i.nodes > 0);
+        lastDepth = i.depth;
+    });
+    Move m = ai.choose_move(d);
+    assert(lastDepth == 3 && d.is_empty(m.x, m.y) && d.history().size() == 3);
+    std::atomic<bool> stop{true};
+    ai.set_stop_flag(&stop);
+    lastDepth = 0;
+    m = ai.choose_move(d);
+    assert(lastDepth == 0 && d.is_empty(m.x, m.y));
+
+    // forward pruning never skips the only block: X threatens (3,0) with O to move
+    Board t;
+    t.place(0,0, Cell::X); t.place(1,0, Cell::X); t.place(2,0, Cell::X);
+    t.place(-1,0, Cell::O); t.place(5,5, Cell::O);
+    for (bool on : {false, true}){
+        Pruning p;
+        p.nullMove = p.lmr = on;
+        AI deep;
+        deep.set_mode(AI::ID_DEEPEN);
+        deep.set_depth(4);
+        deep.set_time_budget(1 << 30);
+        deep.set_pruning(p);
+        assert(deep.choose_move(t) == Move(3,0));
+    }
+
+    // LMR leaves a lost root alone: after X's open three every O move lets X complete a
+    // line, and at depth 3 only the root is deep enough to reduce
+    Board o3;
+    o3.place(0,0, Cell::X); o3.place(1,0, Cell::X); o3.place(2,0, Cell::X);
+    o3.place(5,5, Cell::O); o3.place(-4,3, Cell::O);
+    AI lmr;
+    lmr.set_mode(AI::ID_DEEPEN);
+    lmr.set_depth(3);
+    lmr.set_time_budget(1 << 30);
+    Pruning lp;
+    lp.nullMove = false;
+    lmr.set_pruning(lp);
+    lmr.choose_move(o3);
+    assert(lmr.reductions() == 0);
+    lmr.choose_move(d); // a quiet root is reduced
+    assert(lmr.reductions() > 0);
+
+    // a long game: the zone keeps its cap plus the old threat, far from the recent moves
+    Board lg;
+    lg.place(-21,0, Cell::O); lg.place(-20,0, Cell::X); lg.place(-19,0, Cell::X); lg.place(-18,0, Cell::X);
+    for (int i = 0; i < 64; ++i)
+        lg.place(3 * (i % 8), 10 + 3 * (i / 8), i % 2 ? Cell::X : Cell::O);
+    CandidateZone zone;
+    CandidateMarks zm;
+    std::vector<Move> zb(lg.max_candidates(0));
+    std::size_t zn = lg.zone_candidates(zb.data(), zb.size(), zm, zone);
+    assert(zn == 1 + (std::size_t)zone.cap && zb[0] == Move(-17,0));
+    for (std::size_t i = 0; i < zn; ++i)
+        assert(lg.is_empty(zb[i].x, zb[i].y));
+    zone.cap = 0;
+    assert(lg.zone_candidates(zb.data(), zb.size(), zm, zone) == lg.candidates(2).size());
+    AI lai;
+    lai.set_depth(2);
+    assert(lai.choose_move(lg) == Move(-17,0));
     return 0;
 }
@@ -0,0 +1,113 @@
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+#include "Board.hpp"
+#include "AI.hpp"
+#include "Eval.hpp"
+
+using namespace pattern_eval;
+
+// reference: the same window scores computed by brute force over the bbox
+static int window_score(const Board& b){
+    static const int score[4] = {15, 120, 1200, 16000};
+    static const int dirs[4][2] = {{1,0},{0,1},{1,1},{1,-1}};
+    int s = 0;
+    for (int y = b.min_y()-4; y <= b.max_y()+4; ++y)
+        for (int x = b.min_x()-4; x <= b.max_x()+4; ++x)
+            for (auto& d : dirs){
+                int o = 0, xs = 0;
+                for (int k = 0; k < 4; ++k){
+                    Cell c = b.at(x + k*d[0], y + k*d[1]);
+                    o += c == Cell::O; xs += c == Cell::X;
+                }
+                if (o && !xs) s += score[o-1];
+                if (xs && !o) s -= score[xs-1];
+            }
+    return s;
+}
+
+static int net_output(const PatternAccumulator& acc){
+    int s = acc.weights().b2;
+    for (int h = 0; h < HIDDEN; ++h)
+        s += std::min(std::max<int>(acc.values()[h], 0), CLIP) * acc.weights().w2[h];
+    return s;
+}
+
+int main(){
+    // incremental updates match a rebuild, including out-of-order undo
+    Board b;
+    PatternAccumulator inc, ref;
+    inc.reset(b);
+    b.attach(&inc);
+    int moves[][2] = {{0,0},{1,0},{1,1},{2,2},{-1,1},{0,3},{3,0},{2,1},{-2,2},{0,1}};
+    for (int i = 0; i < 10; ++i){
+        b.place(moves[i][0], moves[i][1], i % 2 ? Cell::O : Cell::X);
+        ref.reset(b);
+        assert(std::equal(inc.values(), inc.values() + HIDDEN, ref.values()));
+        assert(inc.evaluate() == window_score(b));
+        assert(inc.evaluate() == net_output(inc));
+    }
+    b.undo(1,1);
+    b.undo(0,1);
+    ref.reset(b);
+    assert(std::equal(inc.values(), inc.values() + HIDDEN, ref.values()));
+    assert(inc.evaluate() == window_score(b));
+    b.attach(nullptr);
+
+    // the default net stays exact on crowded boards: lone stones alone give 16 windows
+    // each, far more than one clipped neuron of the old 127 range could count
+    {
+        Board big;
+        PatternAccumulator acc;
+        acc.reset(big);
+        big.attach(&acc);
+        for (int i = 0; i < 40; ++i) // spread-out O stones, one-stone windows only
+        {
+            big.place(5 * (i % 8), 5 * (i / 8), Cell::O);
+            assert(acc.evaluate() == window_score(big));
+        }
+        std::uint32_t seed = 12345;
+        for (int i = 0; i < 120; ++i) // then a crowded middle game, 60 more stones a side
+        {
+            int x, y;
+            do
+            {
+                seed = seed * 1664525u + 1013904223u;
+                x = int(seed >> 8) % 36 - 2;
+                seed = seed * 1664525u + 1013904223u;
+                y = int(seed >> 8) % 26 - 2;
+            } while (!big.is_empty(x, y));
+            big.place(x, y, i % 2 ? Cell::O : Cell::X);
+            assert(acc.evaluate() == window_score(big));
+        }
+        ref.reset(big);
+        assert(std::equal(acc.values(), acc.values() + HIDDEN, ref.values()));
+        big.attach(nullptr);
+    }
+
+    // weights survive a save/load round trip; malformed files are rejected
+    Weights w = Weights::defaults();
+    w.w1[5][7] = -3; w.b1[2] = 40; w.w2[9] = 77; w.b2 = -12;
+    const char* path = "test_eval_weights.txt";
+    assert(w.save(path));
+    Weights back;
+    assert(back.load(path));
+    assert(back.w1[5][7] == -3 && back.b1[2] == 40 && back.w2[9] == 77 && back.b2 == -12);
+    assert(std::equal(&w.w1[0][0], &w.w1[0][0] + PATTERNS*HIDDEN, &back.w1[0][0]));
+    if (FILE* f = std::fopen(path, "w")){ std::fputs("ttt4-pattern-eval 1 81 16\n", f); std::fclose(f); }
+    assert(!back.load(path));
+    std::remove(path);
+
+    // the AI with the pattern evaluator blocks a three and leaves the board as it was
+    Board c;
+    c.place(0,0, Cell::X); c.place(1,0, Cell::X); c.place(2,0, Cell::X);
+    c.place(-1,0, Cell::O); c.place(5,5, Cell::O);
+    auto h = c.hash();
+    AI ai;
+    ai.set_pattern_eval(&Weights::defaults());
+    ai.set_depth(2);
+    Move m = ai.choose_move(c);
+    assert((m == Move{3,0}));
+    assert(c.hash() == h && c.attached() == nullptr);
+    return 0;
+}
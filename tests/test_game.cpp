@@ -0,0 +1,222 @@
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include "Game.hpp"
+
+static long g_allocs = 0;
+void *operator new(std::size_t n)
+{
+    ++g_allocs;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+int main(){
+    MapBoard b;
+    b.set(0,0, Cell::O);
+    b.set(1,0, Cell::O);
+    b.set(2,0, Cell::O);
+    b.set(0,1, Cell::X);
+    b.set(1,1, Cell::X);
+
+    // playout engine: first move completes the line -> immediate win
+    PlayoutEngine e;
+    e.load(b, 12);
+    FastRng rng(7);
+    assert(e.run({3,0}, Cell::O, rng) == +1);
+    assert(e.run({-1,0}, Cell::O, rng) == +1);
+    // window is restored after every playout
+    size_t before = e.candidateCount();
+    for (int i = 0; i < 1000; ++i){
+        int r = e.run({0,2}, Cell::X, rng);
+        assert(r >= -1 && r <= 1);
+    }
+    assert(e.candidateCount() == before);
+    assert(before == genCandidates(b).size());
+
+    // lane kernels agree with the scalar reference
+    {
+        FastRng r(99);
+        std::vector<uint64_t> rows(16 * lanes::LANES);
+        for (int t = 0; t < 200; ++t){
+            for (auto &w : rows) w = r.next() & r.next() & r.next();
+            const auto &K = lanes::kernels();
+            assert(K.win4(rows.data(), 0, 13) == lanes::win4_scalar(rows.data(), 0, 13));
+            std::vector<uint8_t> a(rows.size()), c(rows.size());
+            K.popcount(rows.data(), 0, 16, a.data());
+            lanes::popcount_scalar(rows.data(), 0, 16, c.data());
+            assert(a == c);
+        }
+    }
+
+    // batched playouts are statistically equivalent to the scalar playout()
+    {
+        MapBoard m;
+        int pts[][3] = {{0,0,2},{1,0,2},{1,1,1},{2,2,2},{-1,1,1},{0,2,2},{3,1,1},{2,-1,2},{-2,0,1},{0,-2,2}};
+        for (auto &q : pts) m.set(q[0], q[1], (Cell)q[2]);
+        Pos start{-1,-1};
+        std::mt19937 ref(5);
+        int n1 = 1500, w1 = 0, l1 = 0;
+        for (int i = 0; i < n1; ++i){ int v = playout(m, start, Cell::O, 12, ref); w1 += v > 0; l1 += v < 0; }
+        BatchPlayoutEngine be;
+        assert(be.load(m, 12));
+        FastRng r(5);
+        int n2 = 64000, w2 = 0, l2 = 0, res[BatchPlayoutEngine::LANES];
+        for (int i = 0; i < n2; i += BatchPlayoutEngine::LANES){
+            be.run(start, Cell::O, r, res);
+            for (int v : res){ w2 += v > 0; l2 += v < 0; }
+        }
+        assert(std::fabs((double)w1 / n1 - (double)w2 / n2) < 0.02);
+        assert(std::fabs((double)l1 / n1 - (double)l2 / n2) < 0.02);
+        assert(m.count() == 10);
+        MCTSParams P; P.backend = PlayoutBackend::Batched;
+        Pos q = ai_mcts(m, Cell::O, P);
+        assert(m.get(q.x, q.y) == Cell::Empty);
+
+        // RAVE reads the playouts' moves: distinct cells, the start first
+        PlayoutEngine pe;
+        pe.load(m, 12);
+        pe.run(start, Cell::O, r);
+        std::vector<int> mv = pe.lastMoves();
+        assert(!mv.empty() && mv.size() <= 13 && mv[0] == pe.cellOf(start) && pe.cellOf({1000, 0}) == -1);
+        std::sort(mv.begin(), mv.end());
+        assert(std::adjacent_find(mv.begin(), mv.end()) == mv.end());
+        be.run(start, Cell::O, r, res);
+        for (int l = 0; l < BatchPlayoutEngine::LANES; ++l)
+            assert(be.lastMoves(l)[0] == be.cellOf(start) && be.lastMoves(l).size() <= 13);
+        // and every playout is counted once, with either backend (a quiet position: no
+        // win or fork to answer before the playouts)
+        MapBoard quiet;
+        quiet.set(0, 0, Cell::X);
+        quiet.set(3, 3, Cell::O);
+        for (PlayoutBackend backend : {PlayoutBackend::Scalar, PlayoutBackend::Batched}){
+            MCTSParams R; R.backend = backend; R.iters = 300;
+            metrics::SearchProgress sp;
+            sp.begin(0);
+            Pos q2 = ai_mcts(quiet, Cell::O, R, &sp);
+            assert(quiet.get(q2.x, q2.y) == Cell::Empty && sp.snapshot().nodes == 300 && quiet.count() == 2);
+        }
+    }
+
+    // playouts and negamax nodes stay off the heap after warm-up
+    {
+        long before = g_allocs;
+        for (int i = 0; i < 1000; ++i)
+            e.run({0,2}, Cell::X, rng);
+        assert(g_allocs == before);
+
+        NegamaxArena arena;
+        arena.prepare(b, 3);
+        int warm = negamax(b, 3, -INF_SCORE, INF_SCORE, Cell::X, {std::numeric_limits<int>::min(), 0}, Cell::O, arena);
+        before = g_allocs;
+        int again = negamax(b, 3, -INF_SCORE, INF_SCORE, Cell::X, {std::numeric_limits<int>::min(), 0}, Cell::O, arena);
+        assert(g_allocs == before);
+        assert(warm == again);
+        assert(b.count() == 5);
+    }
+
+    // MapBoard bounds stay exact after undo
+    {
+        MapBoard m;
+        m.set(0,0, Cell::X);
+        m.set(7,2, Cell::O);
+        m.set(-3,-1, Cell::X);
+        m.set(-3,-1, Cell::Empty);
+        Bounds bb = m.bounds();
+        assert(bb.minx==0 && bb.miny==0 && bb.maxx==7 && bb.maxy==2);
+        m.set(-3,-1, Cell::X);
+        m.set(7,2, Cell::Empty);
+        bb = m.bounds();
+        assert(bb.minx==-3 && bb.miny==-1 && bb.maxx==0 && bb.maxy==0);
+        m.set(0,0, Cell::Empty);
+        m.set(-3,-1, Cell::Empty);
+        assert(m.count()==0 && m.history.empty());
+    }
+
+    // StoneIndex returns exactly the stones inside the query rectangle, across tile borders
+    {
+        StoneIndex si;
+        si.add(0, 0, Cell::X);
+        si.add(-1, -1, Cell::O);
+        si.add(15, 16, Cell::X);
+        si.add(-17, 3, Cell::O);
+        si.add(400, 0, Cell::X);
+        int n = 0, xs = 0;
+        si.query(-17, -1, 15, 16, [&](const StoneIndex::Stone &s) { ++n; xs += s.c == Cell::X; });
+        assert(n == 4 && xs == 2);
+        n = 0;
+        si.query(-16, 0, 14, 100, [&](const StoneIndex::Stone &) { ++n; });
+        assert(n == 1);
+    }
+
+    // metrics: window percentiles, and the search publishes its node count
+    {
+        metrics::Series fs(4);
+        for (float v : {9.f, 1.f, 2.f, 3.f, 4.f})
+            fs.add(v); // 9 falls out of the window
+        assert(fs.size() == 4 && fs.at(0) == 1.f && fs.last() == 4.f);
+        assert(fs.percentile(0.5f) == 3.f && fs.percentile(1.f) == 4.f && fs.max() == 4.f);
+
+        MapBoard m;
+        m.set(0, 0, Cell::X);
+        m.set(1, 1, Cell::O);
+        metrics::SearchProgress sp;
+        metrics::Registry::Series &calls = metrics::registry().series("ai_negamax", 2, m.count());
+        std::uint64_t before = calls.latencyUs.count();
+        sp.begin(2);
+        ai_negamax(m, Cell::O, 2, &sp);
+        sp.end();
+        auto snap = sp.snapshot();
+        assert(!snap.running && snap.depth == 2 && snap.nodes > 0);
+        assert(m.count() == 2);
+        // and every call lands in the latency registry
+        assert(calls.latencyUs.count() == before + 1 && calls.nodes.load() >= snap.nodes);
+    }
+
+    // candidate zone: cap cells near the recent moves plus a threat anywhere on the board
+    {
+        MapBoard m;
+        m.set(-21, 0, Cell::O);
+        for (int x = -20; x <= -18; ++x)
+            m.set(x, 0, Cell::X);
+        for (int i = 0; i < 64; ++i)
+            m.set(3 * (i % 8), 10 + 3 * (i / 8), i % 2 ? Cell::X : Cell::O);
+        NegamaxZone z;
+        std::vector<Pos> buf(genCandidatesCap(m));
+        size_t n = genZoneCandidates(m, buf.data(), buf.size(), z);
+        assert(n == 1 + (size_t)z.cap && (buf[0] == Pos{-17, 0}));
+        z.cap = 0;
+        assert(genZoneCandidates(m, buf.data(), buf.size(), z) == genCandidates(m).size());
+        assert((ai_negamax(m, Cell::O, 2) == Pos{-17, 0}) && m.count() == 68);
+    }
+
+    // the stepped search plays the recursive one's move with the same node count
+    {
+        int moves[6][2] = {{0,0},{5,0},{0,5},{5,5},{2,2},{-3,3}};
+        for (int depth : {3, 4}){
+            MapBoard m;
+            for (int k = 0; k < 6; ++k)
+                m.set(moves[k][0], moves[k][1], k % 2 ? Cell::O : Cell::X);
+            metrics::SearchProgress sp;
+            sp.begin(depth);
+            Pos want = ai_negamax(m, Cell::X, depth, &sp);
+            NegamaxTask task;
+            task.start(m, Cell::X, depth);
+            int steps = 0;
+            while (!task.step(100))
+                ++steps;
+            assert(task.done() && task.result() == want && task.nodes() == sp.snapshot().nodes);
+            assert(steps > 0 && m.count() == 6);
+        }
+    }
+
+    // mcts finds the win and leaves the board untouched
+    Pos p = ai_mcts(b, Cell::O);
+    assert((p == Pos{3,0}) || (p == Pos{-1,0}));
+    assert(b.count() == 5);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include "Corpus.hpp"
+#include "Game.hpp"
+
+// Determinism oracle for the Game.hpp search: ai_negamax's node count and move (zero
+// nodes when a tactical shortcut answers), and the node count and score of a full-window
+// negamax from the root, at a fixed depth on every corpus position.
+// If a change is meant to alter them, run `test_game_oracle --print` and paste.
+static const int DEPTH = 2;
+
+struct Expected
+{
+    const char *name;
+    unsigned long long nodes;
+    int x, y;
+    unsigned long long rootNodes;
+    int score;
+};
+
+static const Expected expected[] = {
+    {"first", 5651, -2, 2, 5752, -240},
+    {"opening", 0, -1, 1, 74, 1000000000},
+    {"open_three", 0, 3, 0, 161, -1000000000},
+    {"diagonal", 0, 3, 3, 2, 1000000000},
+    {"cluster", 0, -1, 3, 91, -1000000000},
+    {"fork", 0, -1, -1, 134, 1000000000},
+    {"two_fronts", 0, 1, -1, 148, 1000000000},
+    {"far_away", 0, -999997, 498, 145, -1000000000},
+    {"middlegame", 0, 2, -1, 2, 1000000000},
+};
+
+int main(int argc, char **argv){
+    bool print = argc > 1 && std::strcmp(argv[1], "--print") == 0;
+    bool ok = true;
+    std::size_t i = 0;
+    for (const corpus::Position &p : corpus::positions()){
+        MapBoard b;
+        for (std::size_t k = 0; k < p.moves.size(); ++k){
+            assert(b.get(p.moves[k].first, p.moves[k].second) == Cell::Empty);
+            b.set(p.moves[k].first, p.moves[k].second, k % 2 ? Cell::O : Cell::X);
+        }
+        Cell me = p.moves.size() % 2 ? Cell::O : Cell::X;
+        metrics::SearchProgress progress;
+        progress.begin(DEPTH);
+        Pos best = ai_negamax(b, me, DEPTH, &progress);
+        progress.end();
+        unsigned long long nodes = progress.snapshot().nodes;
+        NegamaxArena arena;
+        arena.prepare(b, DEPTH);
+        int score = negamax(b, DEPTH, -INF_SCORE, INF_SCORE, me, {INT_MIN, INT_MIN}, me, arena);
+        if (print){
+            std::printf("    {\"%s\", %llu, %d, %d, %llu, %d},\n", p.name, nodes, best.x, best.y,
+                        (unsigned long long)arena.nodes, score);
+            continue;
+        }
+        assert(i < sizeof(expected) / sizeof(expected[0]));
+        const Expected &e = expected[i++];
+        assert(std::strcmp(e.name, p.name) == 0);
+        if (nodes != e.nodes || best.x != e.x || best.y != e.y || arena.nodes != e.rootNodes || score != e.score){
+            std::fprintf(stderr, "%s: nodes %llu best %d,%d root %llu score %d, recorded %llu %d,%d %llu %d\n", p.name,
+                         nodes, best.x, best.y, (unsigned long long)arena.nodes, score, e.nodes, e.x, e.y, e.rootNodes, e.score);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
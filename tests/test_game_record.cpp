@@ -0,0 +1,97 @@
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include "GameRecord.hpp"
+
+int main(){
+    std::string path = "test_game_record.tlog";
+    std::remove(path.c_str());
+    int moves[][2] = {{0,0},{1,1},{-70,3},{100000,-100000},{5,5}};
+    {
+        grec::Writer w;
+        assert(w.open(path));
+        for (int g = 0; g < 3; ++g){
+            w.begin_game({0, 2, (std::uint32_t)(4 + g), 0, 800}, 1);
+            for (auto &m : moves) w.add_move(m[0] + g, m[1]);
+            w.end_game(g == 2 ? grec::OWins : grec::XWins);
+        }
+    }
+    // append one more game to the closed log
+    {
+        grec::Writer w;
+        assert(w.open(path));
+        w.begin_game({1, 3, 0, 1200, 0}, 2);
+        w.add_move(7, -7);
+    } // destructor stores it as unfinished
+
+    grec::Reader r;
+    assert(r.open(path));
+    assert(r.size() == 4);
+    grec::GameView g;
+    assert(r.game(2, g));
+    assert(g.config.depth == 6 && g.config.timeMs == 800 && g.result == grec::OWins && g.nmoves == 5);
+    auto c = g.moves();
+    int x, y, i = 0;
+    while (c.next(x, y)){
+        assert(x == moves[i][0] + 2 && y == moves[i][1]);
+        ++i;
+    }
+    assert(i == 5);
+    assert(r.game(3, g) && g.config.engine == 1 && g.config.iters == 1200 && g.first == 2 && g.result == grec::Unfinished);
+    int total = 0;
+    r.for_each([&](const grec::GameView &v){ total += v.nmoves; });
+    assert(total == 16);
+    r.close();
+
+    // a log cut before its index is rebuilt by scanning
+    {
+        std::FILE *f = std::fopen(path.c_str(), "rb");
+        std::fseek(f, 0, SEEK_END);
+        long n = std::ftell(f);
+        std::string bytes(n, '\0');
+        std::fseek(f, 0, SEEK_SET);
+        assert(std::fread(&bytes[0], 1, n, f) == (size_t)n);
+        std::fclose(f);
+        f = std::fopen(path.c_str(), "wb");
+        std::fwrite(bytes.data(), 1, n - 20, f); // drops trailer and part of the index
+        std::fclose(f);
+    }
+    assert(r.open(path) && r.size() == 4 && r.game(3, g) && g.nmoves == 1);
+    r.close();
+    {
+        grec::Writer w; // appending after a crash keeps the old games
+        assert(w.open(path));
+    }
+    assert(r.open(path) && r.size() == 4);
+    r.close();
+    std::remove(path.c_str());
+
+    // reopening an indexed log and crashing before close() leaves no stale index behind
+    {
+        grec::Writer w;
+        assert(w.open(path));
+        for (int g = 0; g < 40; ++g){
+            w.begin_game({0, 2, 4, 0, 800}, 1);
+            for (auto &m : moves) w.add_move(m[0] + g, m[1]);
+            w.end_game(grec::XWins);
+        }
+    }
+    auto *crashed = new grec::Writer; // never closed or destroyed, like a killed process
+    assert(crashed->open(path));
+    crashed->begin_game({0, 2, 4, 0, 800}, 1);
+    crashed->add_move(1, 2);
+    crashed->end_game(grec::OWins);
+    {
+        grec::Writer w;
+        assert(w.open(path));
+        w.begin_game({0, 2, 4, 0, 800}, 2);
+        w.add_move(3, 4);
+        w.end_game(grec::XWins);
+    }
+    assert(r.open(path) && r.size() == 42);
+    assert(r.game(40, g) && g.result == grec::OWins && g.nmoves == 1);
+    assert(r.game(41, g) && g.first == 2 && g.nmoves == 1);
+    r.close();
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <cassert>
+#include <atomic>
+#include <thread>
+#include "Host.hpp"
+
+int main(){
+    HostLimits lim;
+    lim.threads = 2;
+    lim.ttBytes = 64 * 1024 * sizeof(TTEntry);
+    lim.maxSessions = 3;
+    GameHost host(lim);
+
+    SessionConfig cfg;
+    cfg.depth = 2;
+    cfg.latencyMs = 50;
+    GameHost::SessionId a = host.open(cfg), b = host.open(cfg), c = host.open(cfg);
+    assert(a && b && c && a != b && b != c);
+    assert(host.open(cfg) == 0); // over maxSessions
+    assert(host.stats().ttEntriesPerSession == 64 * 1024 / 3);
+
+    // O to move must block X's open three
+    assert(host.play(a, Move(0,0)) && host.play(a, Move(0,5)) && host.play(a, Move(1,0)) &&
+           host.play(a, Move(5,5)) && host.play(a, Move(2,0)));
+    assert(!host.play(a, Move(0,0))); // occupied
+    MoveResult r = host.think(a);
+    assert(r.ok && r.session == a);
+    assert((r.move == Move(3,0)) || (r.move == Move(-1,0)));
+    assert(host.play(a, r.move) && host.moves(a).size() == 6);
+
+    // the reply frees the session, so the callback can play the move
+    std::atomic<int> replies{0};
+    assert(host.play(b, Move(0,0)));
+    assert(host.request_move(b, [&](const MoveResult &m){
+        assert(m.ok && !(m.move == Move(0,0)));
+        assert(host.play(m.session, m.move)); // callbacks may drive the session
+        ++replies;
+    }));
+    while (replies == 0)
+        std::this_thread::yield();
+    assert(host.moves(b).size() == 2);
+
+    // a win ends the game
+    for (int x = 0; x < 3; ++x){
+        assert(host.play(c, Move(x,0)));
+        assert(host.play(c, Move(x,9)));
+    }
+    assert(host.play(c, Move(3,0)) && host.winner(c) == Cell::X);
+    assert(!host.play(c, Move(7,7)) && !host.request_move(c, nullptr));
+    assert(host.reset(c) && host.winner(c) == Cell::Empty && host.moves(c).empty());
+
+    assert(host.close(c) && !host.close(c));
+    assert(host.stats().sessions == 2 && host.stats().completed == 2);
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AI.hpp"
+#include "MetricsExport.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// GET / from the loopback endpoint, the whole reply
+static std::string http_get(int port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<std::uint16_t>(port));
+    assert(fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+    const char req[] = "GET /metrics HTTP/1.0\r\n\r\n";
+    assert(::send(fd, req, sizeof(req) - 1, 0) == (ssize_t)(sizeof(req) - 1));
+    std::string reply;
+    char buf[4096];
+    for (ssize_t n; (n = ::recv(fd, buf, sizeof(buf), 0)) > 0;)
+        reply.append(buf, static_cast<std::size_t>(n));
+    ::close(fd);
+    return reply;
+}
+#endif
+
+static std::string read_file(const std::string &path)
+{
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+int main(){
+    using metrics::Histogram;
+
+    // every value lies in its bucket, and a bucket is at most 1/SUB of its values wide
+    for (std::uint64_t v : {0ull, 1ull, 31ull, 32ull, 63ull, 64ull, 65ull, 1000ull, 123456789ull, (1ull << 36) - 1})
+    {
+        int i = Histogram::bucket_of(v);
+        assert(Histogram::bucket_low(i) <= v && v <= Histogram::bucket_high(i));
+        assert((Histogram::bucket_high(i) - Histogram::bucket_low(i)) * Histogram::SUB <= v);
+    }
+    for (int i = 0; i + 1 < Histogram::BUCKETS; ++i)
+        assert(Histogram::bucket_high(i) + 1 == Histogram::bucket_low(i + 1));
+    assert(Histogram::bucket_of(std::uint64_t(1) << 50) == Histogram::BUCKETS - 1);
+
+    // quantiles within the bucket resolution
+    {
+        Histogram h;
+        for (std::uint64_t v = 1; v <= 10000; ++v)
+            h.record(v);
+        assert(h.count() == 10000 && h.sum() == 10000ull * 10001 / 2 && h.max() == 10000);
+        for (double q : {0.5, 0.9, 0.99, 0.999})
+        {
+            double want = q * 10000, got = static_cast<double>(h.quantile(q));
+            assert(got >= want && got <= want * (1 + 1.0 / Histogram::SUB));
+        }
+        assert(h.quantile(1.0) == 10000 && h.quantile(0.0) == 1);
+        assert(h.count_at_or_below(31) == 31 && h.count_at_or_below(100000) == 10000);
+    }
+
+    // series by labels: the same mode text shares a series, sizes fall in classes of x4
+    {
+        metrics::Registry r;
+        static const char mode[] = "alphabeta";
+        std::string copy = mode;
+        assert(&r.series(mode, 4, 10) == &r.series(copy.c_str(), 4, 15));
+        assert(&r.series(mode, 4, 10) != &r.series(mode, 4, 16) && &r.series(mode, 4, 10) != &r.series(mode, 5, 10));
+        assert(metrics::Registry::size_class(0) == 0 && metrics::Registry::size_class(255) == 2 &&
+               metrics::Registry::size_class(256) == 3 && metrics::Registry::size_class(1 << 20) == 5);
+
+        // concurrent writers lose nothing
+        std::vector<std::thread> ts;
+        for (int t = 0; t < 4; ++t)
+            ts.emplace_back([&r, t]
+                            {
+                for (int i = 0; i < 20000; ++i)
+                    r.record(t % 2 ? "id_deepen" : "greedy_1ply", 3, 40, 100 + i % 900, 7); });
+        for (auto &t : ts)
+            t.join();
+        metrics::Registry::Series &id = r.series("id_deepen", 3, 40);
+        assert(id.latencyUs.count() == 40000 && id.nodes.load() == 280000 && id.stones.load() == 1600000);
+
+        // the text: cumulative buckets up to +Inf == _count, then quantiles and counters
+        std::string text = r.prometheus();
+        const std::string l = "{mode=\"id_deepen\",depth=\"3\",stones=\"16-63\"";
+        assert(text.find("# HELP ttt4_move_seconds ") == 0 && text.find("# TYPE ttt4_move_seconds histogram\n") != std::string::npos);
+        assert(text.find("ttt4_move_seconds_bucket" + l + ",le=\"0.0001\"} 0\n") != std::string::npos);
+        assert(text.find("ttt4_move_seconds_bucket" + l + ",le=\"0.0025\"} 40000\n") != std::string::npos);
+        assert(text.find("ttt4_move_seconds_bucket" + l + ",le=\"+Inf\"} 40000\n") != std::string::npos);
+        assert(text.find("ttt4_move_seconds_count" + l + "} 40000\n") != std::string::npos);
+        assert(text.find("ttt4_move_seconds_quantile" + l + ",quantile=\"1\"} 0.000999\n") != std::string::npos);
+        assert(text.find("ttt4_search_nodes_total" + l + "} 280000\n") != std::string::npos);
+        assert(text.find("ttt4_board_stones_total" + l + "} 1600000\n") != std::string::npos);
+    }
+
+    // AI::choose_move records itself: mode, depth and board size, with its node count
+    Board b;
+    b.place(0, 0, Cell::X);
+    b.place(1, 1, Cell::O);
+    b.place(2, 0, Cell::X);
+    metrics::Registry::Series &ab = metrics::registry().series("alphabeta", 3, b.size());
+    AI ai;
+    ai.set_depth(3);
+    ai.choose_move(b);
+    assert(ab.latencyUs.count() == 1 && ab.nodes.load() == (std::uint64_t)ai.nodes() && ab.stones.load() == 3);
+    ai.set_mode(AI::ID_DEEPEN);
+    ai.set_depth(2);
+    ai.choose_move(b);
+    assert(metrics::registry().series("id_deepen", 2, b.size()).latencyUs.count() == 1);
+
+    // export: a file written whole, and the loopback endpoint
+    const std::string path = "test_metrics.prom";
+    std::remove(path.c_str());
+    assert(metrics::write_prometheus(path));
+    assert(read_file(path) == metrics::registry().prometheus());
+    std::remove(path.c_str());
+    {
+        metrics::Exporter ex;
+        std::string err;
+        metrics::Exporter::Options o;
+        o.file = path;
+        o.intervalMs = 20;
+#if defined(__unix__) || defined(__APPLE__)
+        o.port = 0;
+#endif
+        assert(ex.start(o, &err) && ex.running());
+        assert(!ex.start(o, &err) && err == "metrics export already running");
+#if defined(__unix__) || defined(__APPLE__)
+        assert(ex.port() > 0);
+        std::string reply = http_get(ex.port());
+        assert(reply.find("HTTP/1.0 200 OK\r\n") == 0);
+        assert(reply.find("ttt4_move_seconds_bucket{mode=\"alphabeta\",depth=\"3\",stones=\"0-15\",le=\"+Inf\"} 1\n") != std::string::npos);
+#endif
+        ai.choose_move(b);
+        ex.stop(); // writes the file once more, with the last call
+        assert(!ex.running() && ex.port() == -1);
+        assert(read_file(path).find("ttt4_move_seconds_count{mode=\"id_deepen\",depth=\"2\",stones=\"0-15\"} 2\n") != std::string::npos);
+    }
+    std::remove(path.c_str());
+    metrics::Exporter none;
+    std::string err = "x";
+    assert(!none.start_from_env(&err) && err.empty()); // no TTT_METRICS_* in the test environment
+    return 0;
+}
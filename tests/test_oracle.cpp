@@ -0,0 +1,62 @@
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include "AI.hpp"
+#include "Corpus.hpp"
+#include "Notation.hpp"
+
+// Determinism oracle for AI::alphabeta_root: exact node count, best move and score of a
+// fixed-depth search on every corpus position. A change that alters any of them changes
+// what the engine searches; if that is intended, run `test_oracle --print` and paste.
+static const int DEPTH = 3;
+
+struct Expected
+{
+    const char *name;
+    long long nodes;
+    int x, y, score;
+};
+
+static const Expected expected[] = {
+    {"first", 58795, -1, -1, -230},
+    {"opening", 4455, -1, 0, 899980},
+    {"open_three", 80, 2, 2, -899990},
+    {"diagonal", 47, 3, 3, 0},
+    {"cluster", 45, -1, 0, -899990},
+    {"fork", 25750, 4, 5, 899980},
+    {"two_fronts", 28910, 30, 29, 899980},
+    {"far_away", 35573, -1000000, 501, -899950},
+    {"middlegame", 5, 2, -1, 0},
+};
+
+int main(int argc, char **argv){
+    bool print = argc > 1 && std::strcmp(argv[1], "--print") == 0;
+    bool ok = true;
+    std::size_t i = 0;
+    for (const corpus::Position &p : corpus::positions()){
+        std::vector<Move> ms;
+        for (auto &m : p.moves)
+            ms.emplace_back(m.first, m.second);
+        Board b;
+        assert(load_game(b, ms) == ms.size());
+        AI ai;
+        ai.set_mode(AI::ALPHABETA);
+        ai.set_depth(DEPTH);
+        int score = 0;
+        ai.set_info_callback([&](const SearchInfo &info){ score = info.score; });
+        Move best = ai.choose_move(b);
+        if (print){
+            std::printf("    {\"%s\", %lld, %d, %d, %d},\n", p.name, ai.nodes(), best.x, best.y, score);
+            continue;
+        }
+        assert(i < sizeof(expected) / sizeof(expected[0]));
+        const Expected &e = expected[i++];
+        assert(std::strcmp(e.name, p.name) == 0);
+        if (ai.nodes() != e.nodes || best.x != e.x || best.y != e.y || score != e.score){
+            std::fprintf(stderr, "%s: nodes %lld best %d,%d score %d, recorded %lld %d,%d %d\n", p.name,
+                         ai.nodes(), best.x, best.y, score, e.nodes, e.x, e.y, e.score);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
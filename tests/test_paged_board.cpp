@@ -0,0 +1,127 @@
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "PagedBoard.hpp"
+
+int main(){
+    std::string path = "test_paged_board.world";
+    std::remove(path.c_str());
+    std::string err;
+
+    // stones on both sides of the origin, across tiles; LIFO undo restores exact bounds
+    {
+        PagedBoard w;
+        assert(w.open(path, {}, &err) && w.count() == 0 && w.tileCount() == 0);
+        Bounds e = w.bounds();
+        assert(e.minx > e.maxx);
+        w.set(0, 0, Cell::X);
+        w.set(-1, 63, Cell::O);
+        w.set(64, -65, Cell::X);
+        assert(w.count() == 3 && w.tileCount() == 3);
+        assert(w.get(0, 0) == Cell::X && w.get(-1, 63) == Cell::O && w.get(64, -65) == Cell::X);
+        assert(w.get(1, 0) == Cell::Empty && w.get(-64, 0) == Cell::Empty && !w.exists(63, -65));
+        Bounds b = w.bounds();
+        assert(b.minx == -1 && b.miny == -65 && b.maxx == 64 && b.maxy == 63);
+        w.set(1000, 1000, Cell::O);
+        w.set(1000, 1000, Cell::Empty);
+        b = w.bounds();
+        assert(b.maxx == 64 && b.maxy == 63 && w.count() == 3 && w.tileCount() == 4);
+        Pos rec[8];
+        assert(w.recent(rec, 8) == 3 && (rec[0] == Pos{64, -65}) && (rec[2] == Pos{0, 0}));
+        assert(w.sync() && !w.failed());
+    }
+
+    // reopening finds the same world
+    {
+        PagedBoard w;
+        assert(w.open(path, {}, &err));
+        assert(w.count() == 3 && w.tileCount() == 4 && w.residentTiles() == 0);
+        assert(w.get(0, 0) == Cell::X && w.get(-1, 63) == Cell::O && w.get(64, -65) == Cell::X);
+        Bounds b = w.bounds();
+        assert(b.minx == -1 && b.miny == -65 && b.maxx == 64 && b.maxy == 63);
+        Pos rec[8];
+        assert(w.recent(rec, 8) == 0);
+    }
+    std::remove(path.c_str());
+
+    // a world far larger than the resident set: at most residentTiles pages stay mapped,
+    // cold tiles load again on access, and the directories span several groups
+    {
+        PagedBoard w;
+        assert(w.open(path, {4, 4096}, &err));
+        const int n = 1200;
+        for (int i = 0; i < n; ++i)
+            w.set(i * 100, -i * 70, i % 2 ? Cell::O : Cell::X);
+        assert(w.tileCount() == (size_t)n && w.residentTiles() == 4);
+        for (int i = 0; i < n; ++i)
+            assert(w.get(i * 100, -i * 70) == (i % 2 ? Cell::O : Cell::X) && w.get(i * 100 + 1, -i * 70) == Cell::Empty);
+        assert(w.residentTiles() == 4 && w.tileLoads() >= 2 * (size_t)n);
+        assert(w.memoryBytes() < n * PagedBoard::PAGE / 8); // all tiles mapped would be n pages
+    }
+    {
+        PagedBoard w;
+        assert(w.open(path, {4, 4096}, &err) && w.count() == 1200 && w.tileCount() == 1200);
+        assert(w.get(1199 * 100, -1199 * 70) == Cell::O);
+
+        // drawing a viewport maps only the tiles it crosses that hold stones
+        std::uint64_t before = w.tileLoads();
+        std::vector<Pos> seen;
+        w.query(-10, -200, 250, 10, [&](int x, int y, Cell c)
+                {
+            assert(c == w.get(x, y)); // reading inside the callback is allowed
+            seen.push_back({x, y}); });
+        assert(seen.size() == 3 && (seen[0] == Pos{200, -140}) && (seen[2] == Pos{0, 0}));
+        assert(w.tileLoads() - before <= 3);
+    }
+    std::remove(path.c_str());
+
+    // search: the world itself and a local extract play like a MapBoard with the same moves
+    {
+        const int moves[][2] = {{0, 0}, {5, 0}, {0, 5}, {5, 5}, {2, 2}, {-3, 3}, {1, 1}, {3, 3}};
+        MapBoard ref;
+        PagedBoard w;
+        assert(w.open(path, {8, 4096}, &err));
+        for (int i = 0; i < 8; ++i)
+        {
+            ref.set(moves[i][0], moves[i][1], i % 2 ? Cell::O : Cell::X);
+            w.set(moves[i][0], moves[i][1], i % 2 ? Cell::O : Cell::X);
+        }
+        Pos want = ai_negamax(ref, Cell::X, 2);
+        assert(ai_negamax(w, Cell::X, 2) == want && w.count() == 8);
+
+        // far stones played first stay out of a local extract
+        PagedBoard big;
+        std::string bigPath = path + ".big";
+        std::remove(bigPath.c_str());
+        assert(big.open(bigPath, {8, 4096}, &err));
+        for (int i = 0; i < 40; ++i)
+            big.set(100000 + 7 * i, -50000, Cell::O);
+        for (int i = 0; i < 8; ++i)
+            big.set(moves[i][0], moves[i][1], i % 2 ? Cell::O : Cell::X);
+        MapBoard local;
+        big.extract({-20, -20, 20, 20}, local);
+        assert(local.count() == 8 && ai_negamax(local, Cell::X, 2) == want);
+        Pos rec[4], rref[4];
+        assert(local.recent(rec, 4) == 4 && ref.recent(rref, 4) == 4);
+        for (int i = 0; i < 4; ++i)
+            assert(rec[i] == rref[i]);
+        big.close();
+        std::remove(bigPath.c_str());
+    }
+    std::remove(path.c_str());
+
+    // files that are not worlds are refused and the board stays closed
+    {
+        std::FILE *f = std::fopen(path.c_str(), "wb");
+        std::vector<char> junk(PagedBoard::PAGE, 'z');
+        std::fwrite(junk.data(), 1, junk.size(), f);
+        std::fclose(f);
+        PagedBoard w;
+        assert(!w.open(path, {}, &err) && err == "not a paged board" && !w.isOpen());
+        w.set(0, 0, Cell::X);
+        assert(w.get(0, 0) == Cell::Empty && w.failed());
+    }
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <vector>
+#include "AI.hpp"
+#include "Regions.hpp"
+
+// what the board answers without the index: plain evaluate and the sorted candidate set
+static int plain_eval(Board &b)
+{
+    RegionIndex *r = b.regions_attached();
+    b.attach_regions(nullptr);
+    int v = b.evaluate();
+    b.attach_regions(r);
+    return v;
+}
+static std::vector<std::pair<int, int>> sorted_candidates(Board &b, bool useIndex)
+{
+    RegionIndex *r = b.regions_attached();
+    if (!useIndex)
+        b.attach_regions(nullptr);
+    std::vector<std::pair<int, int>> out;
+    for (const Move &m : b.candidates(2))
+        out.push_back({m.x, m.y});
+    b.attach_regions(r);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+int main(){
+    // three clusters far apart
+    Board b;
+    const int start[][2] = {{0, 0}, {1, 0}, {0, 1}, {40, 40}, {41, 41}, {42, 40}, {-30, 25}, {-31, 26}};
+    for (int i = 0; i < 8; ++i)
+        b.place(start[i][0], start[i][1], i % 2 ? Cell::O : Cell::X);
+    RegionIndex idx;
+    idx.reset(b);
+    b.attach_regions(&idx);
+    assert(idx.regions() == 3 && idx.region_size(41, 41) == 3 && idx.region_size(-31, 26) == 2 && idx.region_size(5, 5) == 0);
+    assert(b.evaluate() == plain_eval(b) && sorted_candidates(b, true) == sorted_candidates(b, false));
+
+    // LINK cells apart still link, one more and the stones stay apart
+    b.place(-26, 26, Cell::X);
+    assert(idx.regions() == 3 && idx.region_size(-26, 26) == 3);
+    b.place(-36, 25, Cell::O);
+    assert(idx.regions() == 4);
+    b.undo(-36, 25);
+    b.undo(-26, 26);
+    assert(idx.regions() == 3 && idx.region_size(-31, 26) == 2);
+
+    // a move rescores only its own cluster, and undo brings the old caches back
+    b.evaluate();
+    std::uint64_t before = idx.rescanned();
+    b.place(2, 0, Cell::X);
+    assert(b.evaluate() == plain_eval(b) && idx.rescanned() - before == 4);
+    b.undo(2, 0);
+    before = idx.rescanned();
+    assert(b.evaluate() == plain_eval(b) && idx.rescanned() == before);
+
+    // bridging two clusters merges them; undoing the bridge splits them again
+    b.place(20, 20, Cell::O);
+    for (int k = 1; k <= 4; ++k)
+        b.place(20 + 4 * k, 20 + 4 * k, Cell::O);
+    assert(idx.regions() == 3 && idx.region_size(0, 0) == 3 && idx.region_size(40, 40) == 8);
+    b.place(16, 16, Cell::X);
+    b.place(12, 12, Cell::X);
+    b.place(8, 8, Cell::X);
+    b.place(4, 4, Cell::X);
+    assert(idx.regions() == 2 && idx.region_size(0, 0) == 15);
+    assert(b.evaluate() == plain_eval(b) && sorted_candidates(b, true) == sorted_candidates(b, false));
+    for (int k : {4, 8, 12, 16})
+        b.undo(k, k);
+    assert(idx.regions() == 3 && idx.region_size(0, 0) == 3 && idx.region_size(20, 20) == 8);
+
+    // random play and LIFO undo, with an occasional out-of-order removal
+    std::mt19937 rng(5);
+    for (int round = 0; round < 200; ++round)
+    {
+        std::vector<Move> c = b.candidates(2);
+        Move m = c[rng() % c.size()];
+        b.place(m.x, m.y, rng() % 2 ? Cell::O : Cell::X);
+        assert(b.evaluate() == plain_eval(b));
+        if (round % 7 == 0)
+            assert(sorted_candidates(b, true) == sorted_candidates(b, false));
+        if (round % 3 == 0)
+            b.undo(m.x, m.y);
+        if (round % 50 == 49)
+        {
+            const UndoRecord &old = b.history()[b.history().size() / 2];
+            b.undo(old.x, old.y);
+            assert(b.evaluate() == plain_eval(b) && sorted_candidates(b, true) == sorted_candidates(b, false));
+        }
+    }
+
+    // the search sees the same values: fixed-depth alpha-beta without forward pruning
+    // scores the root the same with and without the index
+    b.attach_regions(nullptr);
+    Board q;
+    for (int i = 0; i < 8; ++i)
+        q.place(start[i][0], start[i][1], i % 2 ? Cell::O : Cell::X);
+    int score[2];
+    for (int on = 0; on < 2; ++on)
+    {
+        AI ai;
+        ai.set_mode(AI::ALPHABETA);
+        ai.set_depth(2);
+        Pruning p;
+        p.nullMove = p.lmr = false;
+        ai.set_pruning(p);
+        Quiescence qs;
+        qs.enabled = false;
+        ai.set_quiescence(qs);
+        ai.set_regions(on != 0);
+        ai.set_info_callback([&](const SearchInfo &i)
+                             { score[on] = i.score; });
+        Board w = q;
+        ai.choose_move(w);
+        assert(w.history().size() == q.history().size() && w.regions_attached() == nullptr);
+    }
+    assert(score[0] == score[1]);
+    return 0;
+}
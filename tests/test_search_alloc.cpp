@@ -0,0 +1,48 @@
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include "Board.hpp"
+#include "AI.hpp"
+
+// counting global allocator: the search hot path must not touch the heap after warm-up
+static long g_allocs = 0;
+void *operator new(std::size_t n)
+{
+    ++g_allocs;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+int main(){
+    Board b;
+    int xs[][2] = {{0,0},{1,1},{2,0},{0,2}};
+    int os[][2] = {{1,0},{0,1},{-1,-1}};
+    for (auto &m : xs) b.place(m[0], m[1], Cell::X);
+    for (auto &m : os) b.place(m[0], m[1], Cell::O);
+
+    for (AI::Mode mode : {AI::GREEDY_1PLY, AI::ALPHABETA, AI::ID_DEEPEN}){
+        AI ai;
+        ai.set_mode(mode);
+        ai.set_depth(3);
+        Move warm = ai.choose_move(b); // sizes arena, TT, node pool and Zobrist keys
+        long before = g_allocs;
+        Move again = ai.choose_move(b);
+        assert(g_allocs == before);
+        assert(b.is_empty(again.x, again.y));
+        if (mode != AI::ID_DEEPEN)
+            assert(warm == again);
+    }
+
+    // span API yields the same moves as the vector API
+    CandidateMarks marks;
+    std::vector<Move> buf(b.max_candidates(0));
+    auto ref = b.candidates(2);
+    std::size_t n = b.candidates(buf.data(), buf.size(), marks, 2);
+    assert(n == ref.size());
+    for (std::size_t i = 0; i < n; ++i)
+        assert(buf[i] == ref[i]);
+    return 0;
+}
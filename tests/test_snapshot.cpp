@@ -0,0 +1,80 @@
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include "Snapshot.hpp"
+
+static Board position(){
+    Board b;
+    int xs[][2] = {{0,0},{1,0},{0,1},{2,2},{-1,-1},{3,1},{1,2}};
+    for (int i = 0; i < 7; ++i)
+        b.place(xs[i][0], xs[i][1], i % 2 ? Cell::O : Cell::X);
+    b.undo(0, 1); // out of order: the history is rewritten
+    return b;
+}
+
+int main(){
+    std::string path = "test_snapshot.snap";
+    Board b = position();
+    AI ai;
+    ai.set_mode(AI::ALPHABETA);
+    ai.set_depth(3);
+    ai.set_tt_entries(1 << 12);
+    Board work = b;
+    ai.choose_move(work);
+    assert(snap::save(path, b, &ai));
+
+    Board r;
+    r.place(9, 9, Cell::X);
+    AI warm;
+    warm.set_mode(AI::ALPHABETA);
+    warm.set_depth(3);
+    std::string err;
+    assert(snap::load(path, r, &warm, &err));
+    assert(r.hash() == b.hash() && r.size() == b.size() && r.history().size() == b.history().size());
+    for (std::size_t i = 0; i < b.history().size(); ++i)
+        assert(r.history()[i].x == b.history()[i].x && r.history()[i].zkey == b.history()[i].zkey);
+    assert(r.at(0, 1) == Cell::Empty && r.at(9, 9) == Cell::Empty);
+    assert(warm.tt_size() == ai.tt_size());
+    for (std::size_t i = 0; i < ai.tt_size(); ++i)
+        assert(warm.tt_data()[i].key == ai.tt_data()[i].key && warm.tt_data()[i].best == ai.tt_data()[i].best);
+
+    // the restored table saves work: the same search needs fewer nodes than from cold
+    AI cold;
+    cold.set_mode(AI::ALPHABETA);
+    cold.set_depth(3);
+    cold.set_tt_entries(1 << 12);
+    Board c = b;
+    cold.choose_move(c);
+    warm.choose_move(r);
+    assert(warm.nodes() < cold.nodes());
+
+    // writes to the adopted table stay private; clear_tt goes back to an owned one
+    warm.clear_tt();
+    assert(warm.tt_data() == nullptr);
+    Board again;
+    AI check;
+    assert(snap::load(path, again, &check));
+    for (std::size_t i = 0; i < ai.tt_size(); ++i)
+        assert(check.tt_data()[i].key == ai.tt_data()[i].key);
+
+    // a damaged history is refused and leaves the board alone
+    {
+        std::FILE *f = std::fopen(path.c_str(), "r+b");
+        assert(f);
+        std::fseek(f, snap::HEADER_SIZE + 32, SEEK_SET); // first record's key
+        std::fputc(0x5A, f);
+        std::fclose(f);
+    }
+    Board keep;
+    keep.place(4, 4, Cell::O);
+    assert(!snap::load(path, keep, nullptr, &err) && err == "history mismatch");
+    assert(keep.size() == 1 && keep.at(4, 4) == Cell::O);
+    assert(!snap::load("no_such_file.snap", keep, nullptr));
+
+    // a board without a searched AI has no table
+    assert(snap::save(path, b, nullptr));
+    AI none;
+    assert(snap::load(path, r, &none) && none.tt_data() == nullptr);
+    std::remove(path.c_str());
+    return 0;
+}
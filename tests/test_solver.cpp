@@ -0,0 +1,54 @@
+#include <cassert>
+#include "Board.hpp"
+#include "Solver.hpp"
+
+int main(){
+    Solver solver;
+
+    // open two: O makes an open three, X cannot block both ends
+    Board a;
+    a.place(0,0, Cell::O); a.place(1,0, Cell::O);
+    a.place(5,5, Cell::X); a.place(6,7, Cell::X);
+    SolveResult r = solver.solve(a, Cell::O);
+    assert(r.outcome == SolveResult::Win && r.proofSize >= 2);
+
+    // two-step threat sequence: (2,0) forces (3,0), then a vertical open three
+    Board b;
+    b.place(0,0, Cell::O); b.place(1,0, Cell::O); b.place(2,1, Cell::O);
+    b.place(-1,0, Cell::X); b.place(7,7, Cell::X); b.place(-6,4, Cell::X);
+    auto h = b.hash();
+    r = solver.solve(b, Cell::O);
+    assert(r.outcome == SolveResult::Win && r.proofSize >= 4);
+    assert(b.hash() == h && b.history().size() == 6);
+
+    // same stones, colours swapped: X wins, and O to move facing it is lost only once X threatens
+    Board c;
+    for (auto &rec : b.history())
+        c.place(rec.x, rec.y, rec.who == Cell::O ? Cell::X : Cell::O);
+    assert(solver.solve(c, Cell::X).outcome == SolveResult::Win);
+    assert(solver.solve(c, Cell::O).outcome == SolveResult::Unknown);
+
+    // X already has an open three: O to move is lost
+    Board d;
+    d.place(0,5, Cell::X); d.place(1,5, Cell::X); d.place(2,5, Cell::X);
+    d.place(0,0, Cell::O); d.place(4,0, Cell::O);
+    r = solver.solve(d, Cell::O);
+    assert(r.outcome == SolveResult::Loss && r.proofSize >= 1);
+
+    // quiet position
+    Board e;
+    e.place(0,0, Cell::O); e.place(1,1, Cell::X);
+    assert(solver.solve(e, Cell::O).outcome == SolveResult::Unknown);
+
+    // budgets: too few nodes gives up, a tiny table still proves
+    SolverLimits tight;
+    tight.maxNodes = 1;
+    Solver starved(tight);
+    r = starved.solve(b, Cell::O);
+    assert(r.outcome == SolveResult::Unknown && b.hash() == h);
+    SolverLimits small;
+    small.tableBytes = 1024;
+    Solver tiny(small);
+    assert(tiny.solve(b, Cell::O).outcome == SolveResult::Win);
+    return 0;
+}